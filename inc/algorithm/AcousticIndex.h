@@ -0,0 +1,129 @@
+#ifndef ACOUSTIC_INDEX_H
+#define ACOUSTIC_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Values in a song's acoustic feature vector (see AudioFeatures.h) */
+static constexpr size_t ACOUSTIC_DIMENSIONS = 16;
+
+using FeatureVector = std::array<float, ACOUSTIC_DIMENSIONS>;
+
+/*
+ * AcousticIndex
+ * -------------
+ * Feature vectors of analysed songs and k-nearest-neighbour queries
+ * over them, by Euclidean distance.
+ *
+ * Vectors are stored column by column (all songs' first value, then
+ * all second values, ...), so the exact search adds one dimension at a
+ * time to a distance array in branch-free loops the compiler can
+ * vectorize. It is O(n x DIMENSIONS) per query.
+ *
+ * For large catalogs an approximate index can be built on top: k-means
+ * splits the songs into about sqrt(n) lists, each stored contiguously
+ * with its own columns, and a query only scans the lists of its
+ * `probes` nearest centroids - roughly O(sqrt(n) x probes) songs.
+ * Songs added after the build are scanned in full by every query
+ * until the index is rebuilt.
+ */
+class AcousticIndex
+{
+public:
+    /* Lists scanned by an approximate query */
+    static constexpr size_t DEFAULT_PROBES = 8;
+
+    /* Below this many songs the exact search is fast enough */
+    static constexpr size_t APPROXIMATE_THRESHOLD = 20000;
+
+    struct Match
+    {
+        int songID;
+        float distance;
+    };
+
+private:
+    std::vector<int> songIDs;
+    std::unordered_map<int, std::uint32_t> positionOf;
+
+    /* Dimension d of song i is columns[d * capacity + i] */
+    std::vector<float> columns;
+    size_t capacity = 0;
+
+    /*
+     * Approximate index: centroids column by column (dimension d of list
+     * l at centroids[d * listCount + l]), and the songs of list l at
+     * [listOffsets[l], listOffsets[l + 1]) of listSongs, whose vectors
+     * are copied column by column into listColumns.
+     */
+    std::vector<float> centroids;
+    std::vector<std::uint32_t> listOffsets;
+    std::vector<std::uint32_t> listSongs;
+    std::vector<float> listColumns;
+    size_t listCount = 0;
+    size_t indexedSongs = 0;
+
+    /* Grows every column to hold at least count songs */
+    void reserveColumns(size_t count);
+
+    /*
+     * Scans rows [first, last) of a column block (dimension d of row i
+     * at block[d * stride + i]), keeping the k closest in the max-heap
+     * best. Row i is song position rows[i], or i if rows is null.
+     */
+    static void scan(const float* block, size_t stride, const std::uint32_t* rows,
+                     const std::vector<int>& ids, size_t first, size_t last,
+                     const FeatureVector& query, size_t k, std::vector<Match>& best);
+
+public:
+    void clear();
+
+    /*
+     * Adds or replaces the vector of a song. Replacing a song already in
+     * the approximate index drops that index.
+     */
+    void add(int songID, const FeatureVector& features);
+
+    size_t size() const;
+
+    /*
+     * Copies the vector of a song into features; false if not analysed.
+     */
+    bool featuresOf(int songID, FeatureVector& features) const;
+
+    /*
+     * Exact k nearest songs to query, closest first.
+     */
+    void nearest(const FeatureVector& query, size_t k, std::vector<Match>& result) const;
+
+    /*
+     * Clusters the current songs into lists (0 = about sqrt(n)) with
+     * the given number of k-means iterations.
+     */
+    void buildApproximate(size_t lists = 0, size_t iterations = 8, std::uint64_t seed = 1);
+
+    bool hasApproximate() const;
+
+    /*
+     * Approximate k nearest songs, closest first: the songs of the
+     * probes lists nearest to the query, plus any added since the
+     * build. Exact if no approximate index was built.
+     */
+    void nearestApproximate(const FeatureVector& query, size_t k, std::vector<Match>& result,
+                            size_t probes = DEFAULT_PROBES) const;
+
+    /*
+     * Writes / reads every vector (not the approximate index).
+     * Returns false on I/O errors or a file that is not an index.
+     */
+    bool save(const std::string& filePath) const;
+    bool load(const std::string& filePath);
+
+    /* Approximate heap memory held by the index, in bytes */
+    size_t memoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef BATCH_PLAYLIST_H
+#define BATCH_PLAYLIST_H
+
+#include <cstdint>
+#include <vector>
+#include "SmartPlaylist.h"
+
+/*
+ * One playlist of a batch: up to size songs from a seed song, in the
+ * given mode, then optionally shuffled.
+ */
+struct PlaylistJob
+{
+    int seedID = 0;
+    int size = 0;
+    SmartPlaylistMode mode = SmartPlaylistMode::BestFirst;
+    std::uint64_t shuffleSeed = 0;      /* 0 = keep the generated order */
+};
+
+/*
+ * What a batch did and how fast.
+ */
+struct BatchReport
+{
+    size_t jobs = 0;
+    size_t failed = 0;                  /* unknown seed, bad size, or no harmonic index */
+    size_t songs = 0;
+    size_t threads = 0;
+    double seconds = 0.0;
+    double jobsPerSecond = 0.0;
+};
+
+/*
+ * Generates the playlist of every job on the pool, against one shared
+ * library. playlists[i] receives the library indices of jobs[i] (empty
+ * if it failed).
+ *
+ * Each worker claims jobs a few at a time from a shared counter and
+ * keeps one generator per mode, restarted for every job, plus a
+ * shuffle buffer, so once warmed up it allocates little beyond the
+ * results. The library, graph, scorer and indices are only read, so
+ * nothing is locked; they must be current and stay unchanged until the
+ * call returns. harmonic may be null if no job is Harmonic.
+ */
+BatchReport generatePlaylistBatch(
+    const std::vector<PlaylistJob>& jobs,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    WorkStealingPool& pool,
+    std::vector<std::vector<std::uint32_t>>& playlists,
+    const CoPlayIndex* coPlays = nullptr,
+    const HarmonicIndex* harmonic = nullptr
+);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef HARMONIC_INDEX_H
+#define HARMONIC_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "MusicLibrary.h"
+
+/*
+ * HarmonicIndex
+ * -------------
+ * Songs with a known tempo and key, grouped by (Camelot key, BPM
+ * bucket). Buckets are tolerance BPM wide, so every song within
+ * tolerance of a tempo lies in that tempo's bucket or one of its two
+ * neighbours, and the songs that can follow a song in a harmonic mix
+ * are found in 4 keys x 3 buckets = 12 cells.
+ *
+ * Cells are stored as compressed sparse rows of library indices, each
+ * sorted by tempo, and built by counting sort in O(n). Like the
+ * similarity graph, the index is rebuilt when the library changes.
+ */
+class HarmonicIndex
+{
+public:
+    /* Positions on the Camelot wheel: 12 numbers x A/B */
+    static constexpr size_t KEYS = 24;
+
+    static constexpr int DEFAULT_TOLERANCE = 4;
+
+private:
+    int tolerance = DEFAULT_TOLERANCE;
+    size_t bucketCount = 0;
+
+    /* Songs of cell c are members[offsets[c], offsets[c + 1]) */
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> members;
+
+    /* Library version and size the index was built from */
+    std::uint64_t builtVersion = 0;
+    size_t librarySize = 0;
+    bool built = false;
+
+public:
+    /*
+     * Indexes every song of the library that has both a tempo and a
+     * key. tolerance is the widest tempo jump between neighbours.
+     */
+    void build(const MusicLibrary& library, int tolerance = DEFAULT_TOLERANCE);
+
+    /*
+     * Checks whether the index matches the library's current version
+     * and the given tolerance.
+     */
+    bool isCurrent(const MusicLibrary& library, int tolerance = DEFAULT_TOLERANCE) const;
+
+    int getTolerance() const;
+
+    /* Number of songs in the library indexed from (indexed or not) */
+    size_t songCount() const;
+
+    size_t getBucketCount() const;
+    size_t cellCount() const;
+
+    /* Position of a key on the wheel, 0-23, or KEYS if unknown */
+    static size_t keyIndex(const CamelotKey& key);
+
+    /* Key one step clockwise, one step back, and across (A <-> B) */
+    static size_t clockwise(size_t keyIndex);
+    static size_t counterClockwise(size_t keyIndex);
+    static size_t relative(size_t keyIndex);
+
+    /* Bucket of a tempo */
+    size_t bucketOf(int bpm) const;
+
+    /* Cell of a key position and bucket */
+    size_t cellOf(size_t keyIndex, size_t bucket) const;
+
+    /* Songs of a cell, slowest first */
+    const std::uint32_t* cellBegin(size_t cell) const;
+    const std::uint32_t* cellEnd(size_t cell) const;
+};
+
+#endif
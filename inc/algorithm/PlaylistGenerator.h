@@ -0,0 +1,305 @@
+#ifndef PLAYLIST_GENERATOR_H
+#define PLAYLIST_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+#include "HarmonicIndex.h"
+#include "MusicLibrary.h"
+#include "RecentPlays.h"
+#include "SimilarityGraph.h"
+#include "SongScorer.h"
+
+/* Default size of the best-first frontier */
+static constexpr size_t SMART_FRONTIER_SIZE = 256;
+
+/* Default number of songs a harmonic mix plays in one key before moving on */
+static constexpr size_t HARMONIC_SONGS_PER_KEY = 4;
+
+/*
+ * PlaylistGenerator
+ * -----------------
+ * Pull-based smart playlist: each call to next() yields one more song,
+ * so a playlist can be grown on demand and resumed where it stopped.
+ * Songs are library indices. A generator keeps pointers into the
+ * library and the similarity graph, so neither may change while it is
+ * in use.
+ */
+class PlaylistGenerator
+{
+public:
+    virtual ~PlaylistGenerator() = default;
+
+    /*
+     * Stores the next song in song. Returns false once every song
+     * reachable from the start has been produced.
+     */
+    virtual bool next(std::uint32_t& song) = 0;
+
+    /*
+     * Starts over from another song, with the same library, graph and
+     * settings. Buffers of the previous run are kept, so a generator
+     * reused for many playlists stops allocating once warmed up.
+     */
+    virtual void restart(const Song& startSong) = 0;
+
+    /* Approximate heap memory held by the generator, in bytes */
+    virtual size_t memoryUsage() const = 0;
+};
+
+/*
+ * BreadthFirstGenerator
+ * ---------------------
+ * BFS over shared artists and albums, in discovery order; the songs of
+ * generateSmartPlaylist one at a time. Each group is expanded once and
+ * visits are tracked in a bitset, so producing k songs costs
+ * O(k + songs in the expanded groups).
+ */
+class BreadthFirstGenerator : public PlaylistGenerator
+{
+private:
+    const MusicLibrary& library;
+    const SimilarityGraph& graph;
+    const Song* songs = nullptr;
+
+    /* Optional; recent songs are traversed but not produced */
+    const RecentPlays* recent;
+    std::int64_t now;
+
+    /* Bitsets of songs already reached and groups already expanded */
+    std::vector<std::uint64_t> visitedSongs;
+    std::vector<std::uint64_t> expandedGroups;
+
+    /* BFS order doubles as the queue: bfsOrder[head, end) is pending */
+    std::vector<std::uint32_t> bfsOrder;
+    size_t head = 0;
+
+    /* Groups of the song being expanded, and the group being scanned */
+    std::uint32_t groups[2] = { 0, 0 };
+    size_t groupIndex = 2;
+    const std::uint32_t* cursor = nullptr;
+    const std::uint32_t* end = nullptr;
+
+    /* The start song is produced before any expansion */
+    bool startPending = false;
+
+public:
+    /*
+     * Starts at startSong; a song outside the library produces nothing.
+     */
+    BreadthFirstGenerator(
+        const Song& startSong,
+        const MusicLibrary& library,
+        const SimilarityGraph& graph,
+        const RecentPlays* recent = nullptr,
+        std::int64_t now = 0
+    );
+
+    bool next(std::uint32_t& song) override;
+
+    void restart(const Song& startSong) override;
+
+    size_t memoryUsage() const override;
+};
+
+/*
+ * BestFirstGenerator
+ * ------------------
+ * Always produces the highest-scoring song of a frontier bounded to
+ * frontierSize songs, then scores up to frontierSize unread songs from
+ * each of its artist and album groups, plus its co-play partners,
+ * against it. The frontier is an indexed min-max heap, so inserting,
+ * evicting the worst and re-scoring a member are O(log frontierSize)
+ * and each step is O(frontierSize log frontierSize) however large the
+ * groups are. Nothing is allocated once warmed up.
+ */
+class BestFirstGenerator : public PlaylistGenerator
+{
+private:
+    /* Frontier entry, ordered best first (ties in library order) */
+    struct Candidate
+    {
+        double score;
+        std::uint32_t song;
+
+        bool operator<(const Candidate& other) const
+        {
+            return (score != other.score) ? score > other.score : song < other.song;
+        }
+    };
+
+    /* Next unread member of a group, and the song that last read from it */
+    struct GroupState
+    {
+        std::uint32_t group;
+        const std::uint32_t* cursor;
+        std::uint32_t anchor;
+    };
+
+    /* groupSlot value of a group not read since the last restart */
+    static constexpr std::uint32_t NO_GROUP_STATE = 0xFFFFFFFF;
+
+    /* frontierSlot value of a song outside the frontier */
+    static constexpr std::uint32_t NOT_IN_FRONTIER = 0xFFFFFFFF;
+
+    const MusicLibrary& library;
+    const SimilarityGraph& graph;
+    const SongScorer& scorer;
+    const Song* songs = nullptr;
+
+    /* Optional; not owned */
+    const CoPlayIndex* coPlays;
+    const RecentPlays* recent;
+    std::int64_t now;
+
+    size_t frontierSize;
+
+    /*
+     * Bitset of songs already produced. produced lists its set bits,
+     * so restart() clears only those words.
+     */
+    std::vector<std::uint64_t> emitted;
+    std::vector<std::uint32_t> produced;
+
+    /*
+     * Frontier as a min-max heap: slots at even depths rank ahead of
+     * their subtree and slots at odd depths behind it, so the best
+     * member is at slot 0 and the worst at slot 1 or 2. frontierSlot
+     * holds the slot of every song in it.
+     */
+    std::vector<Candidate> frontier;
+    std::vector<std::uint32_t> frontierSlot;
+
+    /*
+     * Songs that did not fit in the frontier. They are only read once
+     * the frontier and every group run dry, so nothing reachable is lost.
+     */
+    std::vector<std::uint32_t> spill;
+
+    /* States of the groups read since the last restart, and where each group's state is */
+    std::vector<GroupState> groupStates;
+    std::vector<std::uint32_t> groupSlot;
+    std::vector<std::uint32_t> openGroups;
+
+    /* Last song produced; expanded on the next call */
+    std::uint32_t current = 0;
+    bool started = false;
+    bool valid = false;
+
+    bool isEmitted(std::uint32_t song) const;
+    void markEmitted(std::uint32_t song);
+
+    /* Frontier heap maintenance, keeping frontierSlot in step */
+    void place(size_t slot, const Candidate& candidate);
+    void swapSlots(size_t a, size_t b);
+    bool ranksBefore(size_t a, size_t b, bool best) const;
+    void siftUp(size_t slot);
+    void siftDown(size_t slot);
+
+    /* Restores heap order around a slot whose entry changed */
+    void repair(size_t slot);
+
+    void insertFrontier(const Candidate& candidate);
+    void eraseAt(size_t slot);
+    size_t worstSlot() const;
+
+    /* Scores a candidate against anchor and keeps it if it fits */
+    void consider(std::uint32_t candidate, std::uint32_t anchor);
+
+    /* Scores the next frontierSize unread songs of a group */
+    void readGroup(std::uint32_t group, std::uint32_t anchor);
+
+public:
+    /*
+     * Starts at startSong; a song outside the library produces nothing.
+     * Songs inside the recent window are never produced (apart from
+     * the start song).
+     */
+    BestFirstGenerator(
+        const Song& startSong,
+        const MusicLibrary& library,
+        const SimilarityGraph& graph,
+        const SongScorer& scorer,
+        const CoPlayIndex* coPlays = nullptr,
+        const RecentPlays* recent = nullptr,
+        std::int64_t now = 0,
+        size_t frontierSize = SMART_FRONTIER_SIZE
+    );
+
+    bool next(std::uint32_t& song) override;
+
+    void restart(const Song& startSong) override;
+
+    size_t memoryUsage() const override;
+};
+
+/*
+ * HarmonicGenerator
+ * -----------------
+ * DJ-style mix: every song is followed by a close tempo match (within
+ * the index tolerance) in a compatible key on the Camelot wheel - the
+ * same key, one step either way, or its relative major / minor.
+ *
+ * Each step reads the unplayed end facing the current tempo of 12
+ * index cells (4 keys x 3 buckets) and takes the smallest tempo jump.
+ * After songsPerKey songs in one key, other keys are preferred, so the
+ * mix travels around the wheel. Cells keep cursors past their played
+ * ends, so every step is O(1) amortized. The mix ends when no
+ * compatible song is left; songs without a tempo or key are never
+ * reached.
+ */
+class HarmonicGenerator : public PlaylistGenerator
+{
+private:
+    const MusicLibrary& library;
+    const HarmonicIndex& index;
+
+    /* Optional; recent songs are skipped */
+    const RecentPlays* recent;
+    std::int64_t now;
+
+    size_t songsPerKey;
+
+    /* Bitset of songs produced or skipped */
+    std::vector<std::uint64_t> used;
+
+    /* Unused songs of each cell lie within [low, high) */
+    std::vector<const std::uint32_t*> low;
+    std::vector<const std::uint32_t*> high;
+
+    /* Last song produced, and how many in a row share its key */
+    std::uint32_t current = 0;
+    size_t run = 0;
+    bool started = false;
+    bool valid = false;
+
+    bool isUsed(std::uint32_t song) const;
+    void markUsed(std::uint32_t song);
+
+    /*
+     * Finds the unused song of a cell at the end facing the current
+     * tempo: the fastest of a slower bucket, the slowest of a faster one.
+     */
+    bool facingEnd(size_t cell, int bucketStep, int bpm, std::uint32_t& song);
+
+public:
+    /*
+     * Starts at startSong; a song outside the library produces nothing,
+     * and one without tempo or key only itself.
+     */
+    HarmonicGenerator(
+        const Song& startSong,
+        const MusicLibrary& library,
+        const HarmonicIndex& index,
+        size_t songsPerKey = HARMONIC_SONGS_PER_KEY,
+        const RecentPlays* recent = nullptr,
+        std::int64_t now = 0
+    );
+
+    bool next(std::uint32_t& song) override;
+
+    void restart(const Song& startSong) override;
+
+    size_t memoryUsage() const override;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SIMILARITY_GRAPH_H
+#define SIMILARITY_GRAPH_H
+
+#include <cstdint>
+#include <vector>
+#include "MusicLibrary.h"
+
+/*
+ * SimilarityGraph
+ * ---------------
+ * Songs are similar when they share an artist or an album. Linking
+ * every such pair directly would need m^2 edges for an artist with m
+ * songs, so the graph is stored factored through its groups instead:
+ *
+ *   song  -> its artist group and album group     (two arrays)
+ *   group -> its songs in library order           (compressed sparse row)
+ *
+ * Nodes are library indices, and the whole graph takes O(n) memory.
+ * It is built once per library version; a traversal that marks groups
+ * as visited scans each artist or album bucket at most once.
+ */
+class SimilarityGraph
+{
+private:
+    /* Library index -> group number */
+    std::vector<std::uint32_t> artistOf;
+    std::vector<std::uint32_t> albumOf;
+
+    /* Songs of group g are members[offsets[g], offsets[g + 1]) */
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> members;
+
+    /* Library version the graph was built from */
+    std::uint64_t builtVersion = 0;
+    bool built = false;
+
+public:
+    /*
+     * Builds the graph from every song of the library. O(n).
+     */
+    void build(const MusicLibrary& library);
+
+    /*
+     * Checks whether the graph matches the library's current version.
+     */
+    bool isCurrent(const MusicLibrary& library) const;
+
+    /* Number of song nodes */
+    size_t songCount() const;
+
+    /* Number of artist and album groups together */
+    size_t groupCount() const;
+
+    /* Artist and album group of a song */
+    std::uint32_t artistGroup(size_t song) const;
+    std::uint32_t albumGroup(size_t song) const;
+
+    /* Songs of a group, in library order */
+    const std::uint32_t* groupBegin(std::uint32_t group) const;
+    const std::uint32_t* groupEnd(std::uint32_t group) const;
+};
+
+#endif
@@ -3,14 +3,120 @@
 
 #include "MusicLibrary.h"
 #include "PlaybackQueue.h"
+#include "PlaylistGenerator.h"
+#include "RecentPlays.h"
+#include "SimilarityGraph.h"
+#include "SongScorer.h"
+#include "WorkStealingPool.h"
 
 /*
- * Generates a smart playlist using BFS traversal.
+ * How MusicPlayer builds smart playlists.
+ */
+enum class SmartPlaylistMode
+{
+    Breadth,    /* BFS over shared artists and albums, in discovery order */
+    BestFirst,  /* always the best scored candidate next */
+    Harmonic    /* DJ-style: compatible keys at a steady tempo */
+};
+
+/*
+ * Generates a smart playlist using BFS traversal of the similarity
+ * graph, which must be current for the library. Each artist and album
+ * is expanded once and visits are tracked in a bitset, so the cost is
+ * O(maxSize + songs in the expanded groups).
+ * If recent is given, songs inside its window at time now are still
+ * traversed but left out of the playlist (the start song is always kept).
+ */
+PlaybackQueue generateSmartPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    int maxSize,
+    const RecentPlays* recent = nullptr,
+    std::int64_t now = 0
+);
+
+/*
+ * Same as above with a similarity graph built for this call only.
  */
 PlaybackQueue generateSmartPlaylist(
     Song& startSong,
     MusicLibrary& library,
-    int maxSize
+    int maxSize,
+    const RecentPlays* recent = nullptr,
+    std::int64_t now = 0
+);
+
+/*
+ * Generates a smart playlist best-first: each step emits the
+ * highest-scoring song of a frontier bounded to frontierSize songs,
+ * then scores up to frontierSize unread songs from each of its artist
+ * and album groups, plus its co-play partners, against it. Every step
+ * is O(frontierSize log frontierSize) however large the groups are.
+ * Songs inside the recent window are never emitted.
+ */
+PlaybackQueue generateScoredPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    int maxSize,
+    const CoPlayIndex* coPlays = nullptr,
+    const RecentPlays* recent = nullptr,
+    std::int64_t now = 0,
+    size_t frontierSize = SMART_FRONTIER_SIZE
+);
+
+/*
+ * Generates a DJ-style playlist from a seed: each song is followed by a
+ * close tempo match in a harmonically compatible key (see
+ * HarmonicGenerator), at O(1) amortized per song. The index must be
+ * current for the library. Songs inside the recent window are skipped.
+ */
+PlaybackQueue generateHarmonicPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const HarmonicIndex& index,
+    int maxSize,
+    size_t songsPerKey = HARMONIC_SONGS_PER_KEY,
+    const RecentPlays* recent = nullptr,
+    std::int64_t now = 0
+);
+
+/*
+ * One seed of a multi-seed playlist and its share of the result.
+ */
+struct PlaylistSeed
+{
+    const Song* song;
+    double weight = 1.0;
+};
+
+/*
+ * Generates a playlist blending the neighbourhoods of several seeds.
+ * Each seed runs its own BFS over artist and album groups; songs are
+ * claimed in a shared atomic bitset, so a song reached by several seeds
+ * appears once. Each seed claims a share of maxSize in proportion to
+ * its weight (seeds that run dry pass theirs on), and the results are
+ * interleaved so that every prefix follows the weights.
+ *
+ * Work is done in rounds of one pool task per seed that can still grow,
+ * with a wait at the end of each round, so at most one core per seed is
+ * busy and a round lasts as long as its slowest seed.
+ *
+ * With includeSeeds, the start song of every seed comes first in its
+ * part; otherwise seeds are left out and each part starts after its
+ * seed. Seeds with no song or a non-positive weight are ignored.
+ */
+PlaybackQueue generateMultiSeedPlaylist(
+    const std::vector<PlaylistSeed>& seeds,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    int maxSize,
+    WorkStealingPool& pool,
+    const RecentPlays* recent = nullptr,
+    std::int64_t now = 0,
+    bool includeSeeds = true
 );
 
 #endif
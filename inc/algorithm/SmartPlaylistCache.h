@@ -0,0 +1,147 @@
+#ifndef SMART_PLAYLIST_CACHE_H
+#define SMART_PLAYLIST_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "PlaylistGenerator.h"
+
+/*
+ * SmartPlaylistCache
+ * ------------------
+ * LRU cache of generated smart playlists, stored as library indices
+ * (4 bytes per song) and bounded by a memory budget.
+ *
+ * An entry is keyed by everything that decides its order except the
+ * length: the seeds, the generator and its parameters, and the library
+ * version. Entries of resumable generators keep the generator, so a
+ * longer request only generates the songs past the cached ones.
+ * Entries are stored unfiltered; songs a request does not accept (such
+ * as recently played ones) are skipped when serving it, so one entry
+ * serves every later request for the same key.
+ *
+ * A key with a different library version drops every entry, since
+ * cached generators point into the old similarity graph.
+ */
+class SmartPlaylistCache
+{
+public:
+    /* Identifies a playlist apart from its length */
+    struct Key
+    {
+        /* Generator and its parameters, hashed by the caller */
+        std::uint64_t parameters = 0;
+        std::uint64_t libraryVersion = 0;
+
+        /* Seed song IDs and weights, sorted by ID */
+        std::vector<std::pair<int, double>> seeds;
+
+        bool operator==(const Key& other) const;
+    };
+
+    /* Whether a cached song may be served; songs are library indices */
+    using Accept = std::function<bool(std::uint32_t)>;
+
+    /* Creates the generator of a resumable playlist */
+    using MakeGenerator = std::function<std::unique_ptr<PlaylistGenerator>()>;
+
+    /* Generates the first count songs of a playlist that cannot resume */
+    using Generate = std::function<std::vector<std::uint32_t>(size_t count)>;
+
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(64) << 20;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+
+        /* Songs generated so far, in play order */
+        std::vector<std::uint32_t> songs;
+
+        /* Produces the songs after the cached ones; null when not resumable */
+        std::unique_ptr<PlaylistGenerator> generator;
+
+        /* Every reachable song is cached; longer requests get nothing more */
+        bool complete = false;
+
+        /* Version of the data the generator read when songs were produced */
+        std::uint64_t inputVersion = 0;
+
+        size_t bytes = 0;
+    };
+
+    /* Most recently used first */
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    size_t memoryBudget;
+    size_t memoryUsed = 0;
+
+    /* Library version of the cached entries */
+    std::uint64_t libraryVersion = 0;
+
+    /* Finds or creates the entry of key and moves it to the front */
+    Entry& touch(const Key& key, bool& found);
+
+    /* Copies accepted songs of entry into result until it holds count */
+    static void serve(const Entry& entry, size_t& scanned, size_t count,
+                      const Accept& accept, std::vector<std::uint32_t>& result);
+
+    /* Recounts entry's bytes, then evicts until the budget holds */
+    void account(Entry& entry);
+
+public:
+    explicit SmartPlaylistCache(size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    /*
+     * Stores in result the first count accepted songs of a resumable
+     * playlist (fewer if it runs out). A miss creates the generator; a
+     * cached entry that is too short is extended by its own generator.
+     * inputVersion identifies the data the generator reads beyond the
+     * key (such as co-play counts): an entry that lost its generator is
+     * only resumed by a new one if it is unchanged, and is otherwise
+     * generated again from the start. Returns true if no song had to be
+     * generated.
+     */
+    bool fetch(const Key& key, size_t count, const Accept& accept,
+               const MakeGenerator& makeGenerator, std::vector<std::uint32_t>& result,
+               std::uint64_t inputVersion = 0);
+
+    /*
+     * Same for a playlist that cannot resume: a cached entry that is too
+     * short is replaced by one generated at least twice as long.
+     */
+    bool fetchWhole(const Key& key, size_t count, const Accept& accept,
+                    const Generate& generate, std::vector<std::uint32_t>& result);
+
+    /*
+     * fetchWhole in two steps, so the songs can be generated without
+     * holding the lock that guards the cache. lookupWhole serves a hit
+     * and returns true; on a miss it returns false and sets length to
+     * the number of songs to generate. storeWhole caches the songs
+     * generated for length and serves them; it returns false if they
+     * were too few, and twice the length has to be generated.
+     */
+    bool lookupWhole(const Key& key, size_t count, const Accept& accept,
+                     std::vector<std::uint32_t>& result, size_t& length);
+    bool storeWhole(const Key& key, size_t count, const Accept& accept,
+                    std::vector<std::uint32_t> songs, size_t length, std::vector<std::uint32_t>& result);
+
+    /* Drops every entry */
+    void clear();
+
+    /* Number of cached playlists and the bytes they hold */
+    size_t size() const;
+    size_t memoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SMART_RADIO_H
+#define SMART_RADIO_H
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "PlaylistGenerator.h"
+
+/*
+ * SmartRadio
+ * ----------
+ * Endless smart playlist, produced one song at a time. Each step scores
+ * a small random sample of the current song's artist and album groups
+ * and its co-play partners, and moves to the best one; when all of them
+ * were heard too recently, it samples the whole library instead, so the
+ * radio never runs dry.
+ *
+ * A song is not repeated within the last windowSize songs produced
+ * (nor while the optional RecentPlays holds it back). Every step costs
+ * O(SAMPLES) and the radio holds only the window and a prefetch buffer
+ * of PREFETCH songs, so starting is O(1) and memory stays the same
+ * however long it plays.
+ */
+class SmartRadio : public PlaylistGenerator
+{
+public:
+    /* Songs chosen ahead of time, visible through peek() */
+    static constexpr size_t PREFETCH = 4;
+
+    /* Candidates scored per step from each group and from the library */
+    static constexpr size_t SAMPLES = 8;
+
+    static constexpr size_t DEFAULT_WINDOW = 200;
+
+private:
+    const MusicLibrary& library;
+    const SimilarityGraph& graph;
+    const SongScorer& scorer;
+
+    /* Optional; not owned */
+    const CoPlayIndex* coPlays;
+    const RecentPlays* recent;
+
+    std::mt19937_64 rng;
+
+    /* Requested no-repeat window, before capping to the library */
+    size_t windowSize;
+
+    /* Last song chosen; the next one follows it */
+    std::uint32_t current = 0;
+    bool valid = false;
+
+    /*
+     * Ring of the last songs chosen, and the same songs for lookup
+     * (a multiset, as a forced repeat can hold a song twice).
+     */
+    std::vector<std::uint32_t> window;
+    size_t windowHead = 0;
+    size_t windowFill = 0;
+    std::unordered_multiset<std::uint32_t> inWindow;
+
+    /* Chosen but not yet produced */
+    std::deque<std::uint32_t> buffer;
+
+    /* Candidates of the step in progress; reused */
+    std::vector<std::uint32_t> candidates;
+
+    /* Whether a song may be chosen now */
+    bool isAllowed(std::uint32_t song, std::int64_t now) const;
+
+    /* Adds up to SAMPLES allowed random members of a group */
+    void sampleGroup(std::uint32_t group, std::int64_t now);
+
+    /* Adds up to SAMPLES allowed random songs of the library */
+    void sampleLibrary(std::int64_t now);
+
+    /* Puts a song in the no-repeat window, pushing out the oldest */
+    void remember(std::uint32_t song);
+
+    /* Chooses the song after current and appends it to the buffer */
+    void step();
+
+public:
+    /*
+     * Starts from startSong, which is not produced itself; a song
+     * outside the library (or an empty library) produces nothing.
+     * The library and graph must outlive the radio; if the library
+     * grows, the graph must be rebuilt before the next call.
+     */
+    SmartRadio(
+        const Song& startSong,
+        const MusicLibrary& library,
+        const SimilarityGraph& graph,
+        const SongScorer& scorer,
+        const CoPlayIndex* coPlays = nullptr,
+        const RecentPlays* recent = nullptr,
+        std::uint64_t seed = std::random_device()(),
+        size_t windowSize = DEFAULT_WINDOW
+    );
+
+    /*
+     * Produces the next song. Only fails when the radio has no start.
+     */
+    bool next(std::uint32_t& song) override;
+
+    /*
+     * Starts a new station from startSong, forgetting the window.
+     */
+    void restart(const Song& startSong) override;
+
+    /*
+     * Copies up to count upcoming songs (at most PREFETCH) to upcoming.
+     */
+    void peek(size_t count, std::vector<std::uint32_t>& upcoming) const;
+
+    size_t memoryUsage() const override;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SONG_SCORER_H
+#define SONG_SCORER_H
+
+#include "Song.h"
+#include "CoPlayIndex.h"
+
+/*
+ * SongScorer
+ * ----------
+ * Rates how well a candidate follows a song in a smart playlist.
+ * Higher is better; scores only need to be comparable with each other.
+ * Implementations must be cheap (O(1)) and safe to call concurrently.
+ */
+class SongScorer
+{
+public:
+    virtual ~SongScorer() = default;
+
+    virtual double score(const Song& from, const Song& candidate) const = 0;
+};
+
+/*
+ * Relative importance of each signal used by DefaultSongScorer.
+ */
+struct ScoreWeights
+{
+    double sameArtist = 1.0;
+    double sameAlbum = 1.5;
+    double duration = 0.5;          /* at equal length; halves every durationScale * ln 2 s apart */
+    double coPlay = 1.0;            /* per e-fold of plays together */
+    double durationScale = 60.0;    /* seconds */
+};
+
+/*
+ * DefaultSongScorer
+ * -----------------
+ * Weighted sum of shared artist, shared album, duration proximity and
+ * how often the two songs were played near each other.
+ */
+class DefaultSongScorer : public SongScorer
+{
+private:
+    ScoreWeights weights;
+
+    /* Optional; not owned */
+    const CoPlayIndex* coPlays;
+
+public:
+    explicit DefaultSongScorer(const CoPlayIndex* coPlays = nullptr, ScoreWeights weights = ScoreWeights());
+
+    double score(const Song& from, const Song& candidate) const override;
+
+    const ScoreWeights& getWeights() const;
+};
+
+#endif
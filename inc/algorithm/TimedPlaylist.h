@@ -0,0 +1,46 @@
+#ifndef TIMED_PLAYLIST_H
+#define TIMED_PLAYLIST_H
+
+#include <vector>
+#include "PlaybackQueue.h"
+
+/*
+ * Length a timed playlist should run for, and how varied it must be.
+ */
+struct DurationTarget
+{
+    int seconds = 3600;
+    int tolerance = 30;         /* seconds either way */
+
+    /* Most songs of one artist / album in the result; 0 = no limit */
+    size_t maxPerArtist = 0;
+    size_t maxPerAlbum = 0;
+};
+
+/*
+ * Picks songs from candidates whose durations add up to the target,
+ * in candidate order.
+ *
+ * Subset sum over a bitset of reachable totals: each song shifts the
+ * bitset by its duration and ORs it in, 64 totals per word, so the run
+ * is O(candidates x (seconds + tolerance) / 64). Every total remembers
+ * the first song that reached it, which is enough to rebuild one subset
+ * with O(seconds) extra memory. Songs early in candidates are therefore
+ * preferred, and the scan stops as soon as the exact target is reached.
+ *
+ * Diversity limits are applied first, by keeping only the first
+ * maxPerArtist / maxPerAlbum candidates of each artist / album, so
+ * every subset respects them. Songs without a duration or longer than
+ * the target are skipped.
+ *
+ * The result is the subset whose total is closest to the target
+ * without going over target + tolerance; totalSeconds receives that
+ * total (check it against the tolerance). Empty if nothing fits.
+ */
+PlaybackQueue generateTimedPlaylist(
+    const std::vector<const Song*>& candidates,
+    const DurationTarget& target,
+    int* totalSeconds = nullptr
+);
+
+#endif
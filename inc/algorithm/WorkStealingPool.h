@@ -0,0 +1,91 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * WorkStealingPool
+ * ----------------
+ * Fixed set of worker threads, each with its own task deque. A worker
+ * runs its newest task first (good cache locality for tasks it spawned
+ * itself) and, when its deque is empty, steals the oldest task of
+ * another worker, so uneven tasks still keep every core busy.
+ *
+ * Tasks submitted from a worker go to that worker's deque; tasks from
+ * other threads are spread round-robin. Each deque has its own small
+ * lock, so workers only contend when stealing from the same victim.
+ */
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    /* Tasks sitting in deques, and tasks submitted but not finished */
+    std::atomic<size_t> queued {0};
+    std::atomic<size_t> pending {0};
+
+    /* Round-robin target for tasks from outside the pool */
+    std::atomic<size_t> nextWorker {0};
+
+    std::atomic<bool> stopping {false};
+
+    /* Sleeping workers wait on wake; wait() sleeps on idle */
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    /* First exception thrown by a task since the last wait() */
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+
+    /* Runs one task, looking in deque self first; false if none found */
+    bool runOne(size_t self);
+
+    void workerLoop(size_t index);
+
+public:
+    /*
+     * Starts the given number of workers (0 = one per hardware thread).
+     */
+    explicit WorkStealingPool(size_t threadCount = 0);
+
+    /*
+     * Finishes every queued task, then stops the workers.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /*
+     * Queues a task. Tasks may submit further tasks.
+     */
+    void submit(std::function<void()> task);
+
+    /*
+     * Blocks until every submitted task has finished, running tasks on
+     * the calling thread meanwhile. Rethrows the first exception a task
+     * threw. Must not be called from inside a task.
+     */
+    void wait();
+
+    /* Number of worker threads */
+    size_t threadCount() const;
+};
+
+#endif
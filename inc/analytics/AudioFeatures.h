@@ -0,0 +1,106 @@
+#ifndef AUDIO_FEATURES_H
+#define AUDIO_FEATURES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AcousticIndex.h"
+
+/*
+ * Acoustic description of a song, from its decoded audio. Values of a
+ * FeatureVector, each roughly within [0, 1]:
+ *
+ *   CENTROID    spectral centroid, as a fraction of the Nyquist frequency
+ *   SPREAD      spectral spread around it, same unit
+ *   LOUDNESS    RMS energy in dB, mapped from [-60, 0] dB to [0, 1]
+ *   ONSET_RATE  note onsets per second / 10
+ *   CHROMA..    energy of the 12 pitch classes (C, C#, ... B), unit length
+ */
+enum FeatureSlot : size_t
+{
+    FEATURE_CENTROID = 0,
+    FEATURE_SPREAD = 1,
+    FEATURE_LOUDNESS = 2,
+    FEATURE_ONSET_RATE = 3,
+    FEATURE_CHROMA = 4
+};
+
+/*
+ * Decoded audio, mixed down to mono.
+ */
+struct AudioClip
+{
+    std::vector<float> samples;     /* in [-1, 1] */
+    int sampleRate = 0;
+};
+
+/*
+ * Decodes a WAV file: integer PCM of 8, 16, 24 or 32 bits or 32-bit
+ * float, any number of channels. The file is read in fixed-size chunks
+ * into clip, whose buffer is reused. A data size past the end of the
+ * file, or left unset, is read up to the end. Returns false if the file
+ * cannot be read or is not a supported WAV.
+ */
+bool decodeWav(const std::string& filePath, AudioClip& clip);
+
+/*
+ * AudioAnalyzer
+ * -------------
+ * Turns a clip into a FeatureVector. The clip is cut into Hann-windowed
+ * frames of FRAME samples, HOP apart, and the spectrum of each is
+ * taken with a radix-2 FFT over separate real and imaginary arrays.
+ * Every butterfly stage runs one contiguous loop with its own twiddle
+ * table. With SSE2 (every x86-64 target) the butterflies and the
+ * spectrum unpacking run four floats at a time; elsewhere they are
+ * plain scalar loops. Real frames are transformed two at a time as the
+ * real and imaginary parts of one complex FFT.
+ *
+ * An analyzer keeps its tables and buffers between songs, so a worker
+ * that reuses one does not allocate once warmed up. Not thread-safe:
+ * use one per thread.
+ */
+class AudioAnalyzer
+{
+public:
+    static constexpr size_t FRAME = 2048;
+    static constexpr size_t HOP = 1024;
+
+private:
+    /* Hann window, and bit-reversed positions of the FFT input */
+    std::vector<float> window;
+    std::vector<std::uint32_t> bitReversed;
+
+    /* Twiddles of each stage, back to back: FRAME - 1 in all */
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+
+    /* Pitch class of each spectrum bin (-1 outside the tuned range) for chromaRate */
+    std::vector<int> pitchClass;
+    int chromaRate = 0;
+
+    /* FFT work arrays, and magnitudes of the current and previous frame */
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<float> magnitude;
+    std::vector<float> previous;
+
+    /* Spectral flux of every frame */
+    std::vector<float> flux;
+
+    /* In-place FFT of re + i im */
+    void transform();
+
+    /* Builds pitchClass for a sample rate */
+    void tune(int sampleRate);
+
+public:
+    AudioAnalyzer();
+
+    /*
+     * Computes the features of a clip. Returns false for clips shorter
+     * than one frame.
+     */
+    bool analyze(const AudioClip& clip, FeatureVector& features);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef CO_PLAY_INDEX_H
+#define CO_PLAY_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "ListeningLog.h"
+
+/*
+ * CoPlayIndex
+ * -----------
+ * Item-to-item co-occurrence from listening sessions: how often two
+ * songs were played within WINDOW songs of each other in the same
+ * session (no more than SESSION_GAP seconds between plays).
+ *
+ * The sparse song x song matrix is never stored whole. Every song
+ * counts at most CANDIDATES partners, strongest first; a new partner
+ * arriving at a full row takes the place of the weakest one and
+ * inherits its count ("space saving"), so a frequent partner is never
+ * lost and memory stays O(songs x CANDIDATES) however many events are
+ * seen. Counts of partners that arrived that way are upper bounds.
+ *
+ * Events are folded in one at a time, so the index is built from the
+ * log in a single streaming pass and kept current as songs are played.
+ * Each event costs O(WINDOW x CANDIDATES). The NEIGHBOURS strongest
+ * partners of a song are the front of its row, so reading them is O(1).
+ */
+class CoPlayIndex
+{
+public:
+    /* Plays further apart than this belong to different sessions */
+    static constexpr std::int64_t SESSION_GAP = 30 * 60;
+
+    /* Songs up to this many plays apart count as played together */
+    static constexpr size_t WINDOW = 3;
+
+    /* Partners returned per song */
+    static constexpr size_t NEIGHBOURS = 32;
+
+    /* Partners counted per song; the slack keeps rising ones from being evicted */
+    static constexpr size_t CANDIDATES = 2 * NEIGHBOURS;
+
+    /* Events read from the log at once while building */
+    static constexpr size_t BUILD_CHUNK = 1 << 16;
+
+    /* Plays paired with earlier ones after which the epoch advances */
+    static constexpr size_t EPOCH_PLAYS = 64;
+
+    struct Neighbour
+    {
+        int songID;
+        std::uint32_t count;
+    };
+
+    /*
+     * View of the strongest partners of a song, highest count first.
+     * Valid until the index changes.
+     */
+    class NeighbourList
+    {
+    private:
+        const Neighbour* first = nullptr;
+        const Neighbour* last = nullptr;
+
+    public:
+        NeighbourList() = default;
+        NeighbourList(const Neighbour* first, const Neighbour* last) : first(first), last(last) {}
+
+        const Neighbour* begin() const { return first; }
+        const Neighbour* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+private:
+    /* Song ID -> counted partners, highest count first */
+    std::vector<std::vector<Neighbour>> partners;
+
+    /* Last WINDOW plays of the session in progress, oldest first */
+    ListeningEvent window[WINDOW] {};
+    size_t windowFill = 0;
+
+    /* Bumped whenever a count changes */
+    std::uint64_t version = 0;
+
+    /* Bumped on clear() and after every EPOCH_PLAYS counted plays */
+    std::uint64_t epoch = 0;
+    size_t playsSinceEpoch = 0;
+
+    /* Adds one co-play of partner to song's row */
+    void addPartner(int song, int partner);
+
+public:
+    /*
+     * Forgets every count and the session in progress.
+     */
+    void clear();
+
+    /*
+     * Folds in one play, pairing it with the plays just before it in
+     * the same session. Events must arrive in play order.
+     */
+    void record(const ListeningEvent& event);
+
+    /*
+     * Rebuilds the index from every event of the log, reading it in
+     * chunks of BUILD_CHUNK events.
+     */
+    void build(const ListeningLog& log);
+
+    /*
+     * Returns the NEIGHBOURS strongest partners of a song.
+     */
+    NeighbourList neighboursOf(int songID) const;
+
+    /*
+     * Returns how often two songs were played together,
+     * or 0 if b is not among a's counted partners.
+     */
+    std::uint32_t count(int a, int b) const;
+
+    /* Changes whenever a count changes, so derived results can tell they are stale */
+    std::uint64_t getVersion() const;
+
+    /*
+     * Changes on a rebuild and every EPOCH_PLAYS plays. Results keyed on
+     * it survive single plays, at the cost of slightly stale counts.
+     */
+    std::uint64_t getEpoch() const;
+
+    /* Approximate heap memory held by the index, in bytes */
+    size_t memoryUsage() const;
+};
+
+#endif
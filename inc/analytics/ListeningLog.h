@@ -0,0 +1,197 @@
+#ifndef LISTENING_LOG_H
+#define LISTENING_LOG_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MusicLibrary.h"
+
+/*
+ * One listening event: a song stopped playing.
+ */
+struct ListeningEvent
+{
+    int songID {};
+    std::int64_t timestamp {};      /* unix time (seconds) the song started */
+    int secondsListened {};
+    bool skipped = false;           /* stopped before reaching its end */
+};
+
+/*
+ * Maps every song ID to a dense group number (artist, album, ...).
+ * groupOfSong[id] is -1 for IDs that are not in the library.
+ */
+struct SongGrouping
+{
+    std::vector<std::string> names;         /* group number -> name */
+    std::vector<std::int32_t> groupOfSong;  /* song ID -> group number */
+};
+
+/*
+ * Builds a grouping of all library songs by artist.
+ */
+SongGrouping groupSongsByArtist(const MusicLibrary& library);
+
+/*
+ * Builds a grouping of all library songs by album.
+ */
+SongGrouping groupSongsByAlbum(const MusicLibrary& library);
+
+/*
+ * ListeningLog
+ * ------------
+ * Durable, append-only record of every listening event, stored in a
+ * memory-mapped file. Events are grouped in blocks of BLOCK_EVENTS and
+ * each block stores its fields column by column:
+ *
+ *   [ songID x N | timestamp x N | secondsListened x N | skipped x N ]
+ *
+ * Appends are plain stores into the mapping. Queries scan whole
+ * columns with branch-free loops the compiler can vectorize, and skip
+ * blocks whose timestamp range lies outside the requested window.
+ *
+ * Time windows are half-open: [from, to).
+ */
+class ListeningLog
+{
+private:
+    /* On-disk header, stored in the first page of the file */
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t eventCount;
+        std::uint32_t blockEvents;
+        std::int32_t maxSongID;
+    };
+
+    /* Per-block timestamp range, kept in memory for block pruning */
+    struct BlockRange
+    {
+        std::int64_t minTime;
+        std::int64_t maxTime;
+    };
+
+    /* Mapped view of the whole file */
+    unsigned char* base = nullptr;
+    std::uint64_t mappedBytes = 0;
+
+    /* Platform handles */
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+
+    std::vector<BlockRange> blockRanges;
+
+    /* Serializes appends, remaps and scans */
+    mutable std::mutex logMutex;
+
+    Header* header() const;
+
+    /* Column pointers of a block */
+    std::int32_t* songColumn(size_t block) const;
+    std::int64_t* timeColumn(size_t block) const;
+    std::int32_t* secondsColumn(size_t block) const;
+    std::uint8_t* skipColumn(size_t block) const;
+
+    size_t blockCount() const;
+
+    /* Number of valid events in a block */
+    size_t eventsInBlock(size_t block) const;
+
+    /* Maps the file with at least the given size */
+    bool map(std::uint64_t bytes);
+    void unmap();
+
+    /* Closes the platform file handle */
+    void closeFile();
+
+    /* Calls visit(block, eventCount) for blocks overlapping [from, to) */
+    template <typename Visitor>
+    void forEachBlock(std::int64_t from, std::int64_t to, Visitor visit) const;
+
+public:
+    /* Events per column block */
+    static constexpr size_t BLOCK_EVENTS = 4096;
+
+    ListeningLog() = default;
+    ~ListeningLog();
+
+    ListeningLog(const ListeningLog&) = delete;
+    ListeningLog& operator=(const ListeningLog&) = delete;
+
+    /*
+     * Opens the log file, creating it if needed.
+     * Returns false if the file cannot be created, mapped or is not a log.
+     */
+    bool open(const std::string& filePath);
+
+    /*
+     * Unmaps and closes the log file.
+     */
+    void close();
+
+    /*
+     * Checks whether a log file is currently open.
+     */
+    bool isOpen() const;
+
+    /*
+     * Appends one event. Amortized O(1); the file grows in large steps.
+     */
+    void append(const ListeningEvent& event);
+
+    /*
+     * Returns number of events in the log.
+     */
+    size_t size() const;
+
+    /*
+     * Copies the event at the given position (0 = oldest) into event.
+     * Returns false if there is no event at that position.
+     */
+    bool getEvent(size_t index, ListeningEvent& event) const;
+
+    /*
+     * Copies up to count events starting at position first into events
+     * (replacing its contents), under one lock. Returns how many were
+     * copied; reading a long log chunk by chunk keeps memory bounded.
+     */
+    size_t readEvents(size_t first, size_t count, std::vector<ListeningEvent>& events) const;
+
+    /*
+     * Counts events per song ID in [from, to).
+     * The result is indexed by song ID.
+     */
+    std::vector<std::uint64_t> playsPerSong(std::int64_t from, std::int64_t to) const;
+
+    /*
+     * Counts skipped events per song ID in [from, to).
+     * The result is indexed by song ID.
+     */
+    std::vector<std::uint64_t> skipsPerSong(std::int64_t from, std::int64_t to) const;
+
+    /*
+     * Counts events per group (see SongGrouping) in [from, to).
+     * The result is indexed by group number.
+     */
+    std::vector<std::uint64_t> playsPerGroup(const SongGrouping& grouping,
+                                             std::int64_t from, std::int64_t to) const;
+
+    /*
+     * Returns the fraction of events in [from, to) that were skipped.
+     * Returns 0 if there are no events in the window.
+     */
+    double skipRate(std::int64_t from, std::int64_t to) const;
+
+    /*
+     * Returns the skip rate of a single song in [from, to).
+     */
+    double skipRate(int songID, std::int64_t from, std::int64_t to) const;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef PLAY_STATISTICS_H
+#define PLAY_STATISTICS_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "ListeningLog.h"
+
+/*
+ * One ranked entry of a top-K list.
+ * id is a song ID, or a group number for artists and albums.
+ */
+struct TopItem
+{
+    int id;
+    double score;       /* approximate decayed play count */
+};
+
+/*
+ * DecayedTopK
+ * -----------
+ * Approximate top-K over an unbounded stream of integer keys, with
+ * exponentially decaying weights.
+ *
+ *  - A count-min sketch estimates every key's decayed count in
+ *    O(depth) time and fixed memory, whatever the number of keys.
+ *  - A space-saving min-heap of K candidates keeps the current leaders;
+ *    a key enters when its estimate beats the smallest candidate.
+ *
+ * Decay uses "forward decay": an event at time t adds exp(t / tau)
+ * instead of 1, so older counts never need to be touched. Dividing by
+ * exp(now / tau) yields counts where a play from tau seconds ago
+ * weighs 1/e. All values are rescaled occasionally to stay finite.
+ */
+class DecayedTopK
+{
+private:
+    struct Candidate
+    {
+        int key;
+        double weight;
+    };
+
+    size_t capacity;
+    size_t width;           /* power of two */
+    size_t depth;
+    double tau;             /* decay time constant in seconds */
+    double landmark = 0;    /* time at which weights are 1 */
+    bool started = false;
+
+    /* depth rows of width counters */
+    std::vector<double> sketch;
+
+    /* Min-heap on weight */
+    std::vector<Candidate> heap;
+    std::unordered_map<int, size_t> heapPosition;
+
+    size_t bucket(int key, size_t row) const;
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+    void swapCandidates(size_t a, size_t b);
+
+    /* Divides every stored weight by exp(shift / tau) */
+    void rescale(double newLandmark);
+
+public:
+    DecayedTopK(size_t capacity, double tauSeconds, size_t width = 2048, size_t depth = 4);
+
+    /*
+     * Counts one occurrence of key at the given time (seconds).
+     * O(depth + log K).
+     */
+    void add(int key, double now);
+
+    /*
+     * Returns the estimated decayed count of a key at the given time.
+     */
+    double estimate(int key, double now) const;
+
+    /*
+     * Returns the current leaders, highest score first. O(K log K).
+     */
+    std::vector<TopItem> top(double now) const;
+};
+
+/*
+ * Time windows offered by PlayStatistics.
+ */
+enum class StatsWindow
+{
+    Hour,
+    Day,
+    Week
+};
+
+/*
+ * PlayStatistics
+ * --------------
+ * Streaming "most played" songs, artists and albums over the last
+ * hour, day and week. Memory is fixed by TOP_K and the sketch size,
+ * independent of the catalog; each play costs O(1) amortized.
+ */
+class PlayStatistics
+{
+private:
+    /* [window][Songs, Artists, Albums] */
+    std::vector<DecayedTopK> trackers;
+
+    SongGrouping artists;
+    SongGrouping albums;
+
+    const DecayedTopK& tracker(StatsWindow window, size_t dimension) const;
+
+public:
+    /* Number of leaders tracked per list */
+    static constexpr size_t TOP_K = 50;
+
+    PlayStatistics();
+
+    /*
+     * Builds the song -> artist / album tables.
+     * Must be called after the library is loaded.
+     */
+    void initialize(const MusicLibrary& library);
+
+    /*
+     * Counts one play of a song at the given unix time (seconds).
+     */
+    void recordPlay(int songID, std::int64_t now);
+
+    std::vector<TopItem> topSongs(StatsWindow window, std::int64_t now) const;
+    std::vector<TopItem> topArtists(StatsWindow window, std::int64_t now) const;
+    std::vector<TopItem> topAlbums(StatsWindow window, std::int64_t now) const;
+
+    /* Names of artist and album group numbers returned above */
+    const std::string& artistName(int group) const;
+    const std::string& albumName(int group) const;
+};
+
+#endif
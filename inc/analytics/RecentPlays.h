@@ -0,0 +1,80 @@
+#ifndef RECENT_PLAYS_H
+#define RECENT_PLAYS_H
+
+#include <cstdint>
+#include <vector>
+#include "MusicLibrary.h"
+#include "ListeningLog.h"
+
+/*
+ * RecentPlays
+ * -----------
+ * Remembers when every song was last played, so shuffle and smart
+ * playlists can hold back songs heard "in the last N plays or M hours".
+ *
+ * State is one 8-byte entry per song ID (start time of the latest play
+ * and its play number), so recording a play and checking a candidate
+ * are both a single array access, and a catalog of ten million songs
+ * needs 80 MB. Times are unix seconds stored in 32 bits (valid until
+ * 2106); play numbers wrap harmlessly after 2^32 plays.
+ */
+class RecentPlays
+{
+private:
+    struct Entry
+    {
+        std::uint32_t playedAt;     /* unix time of the latest play, 0 = never */
+        std::uint32_t playNumber;   /* value of playCount after that play */
+    };
+
+    /* Song ID -> latest play */
+    std::vector<Entry> entries;
+
+    /* Plays recorded so far */
+    std::uint32_t playCount = 0;
+
+    /* Exclusion window; 0 disables that part */
+    std::uint32_t windowPlays = 0;
+    std::int64_t windowSeconds = 0;
+
+public:
+    /*
+     * Sizes the table for every song ID in the library.
+     * Songs outside the library are still accepted later.
+     */
+    void initialize(const MusicLibrary& library);
+
+    /*
+     * Sets the window: a song is recent if it was among the last
+     * plays songs played, or started less than seconds ago.
+     * Passing 0 for both disables exclusion.
+     */
+    void setWindow(std::uint32_t plays, std::int64_t seconds);
+
+    std::uint32_t getWindowPlays() const;
+    std::int64_t getWindowSeconds() const;
+
+    /*
+     * Returns true if any exclusion window is set.
+     */
+    bool isActive() const;
+
+    /*
+     * Records that a song started playing at the given unix time. O(1).
+     */
+    void recordPlay(int songID, std::int64_t now);
+
+    /*
+     * Forgets every play and refills the table from the tail of the
+     * log, reading only as many events as the window can cover.
+     */
+    void load(const ListeningLog& log, std::int64_t now);
+
+    /*
+     * Checks whether a song falls inside the window at the given
+     * unix time. O(1).
+     */
+    bool isRecent(int songID, std::int64_t now) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef MUSIC_LIBRARY_H
 #define MUSIC_LIBRARY_H
 
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <unordered_map>
@@ -42,6 +43,12 @@ private:
      */
     std::unordered_map<std::string, std::vector<Song*>> songByAlbum;
 
+    /*
+     * Incremented whenever songs are added, so derived structures
+     * (e.g. the similarity graph) know when to rebuild.
+     */
+    std::uint64_t version = 0;
+
 public:
     /*
      * Loads the music library from a CSV file.
@@ -63,6 +70,7 @@ public:
      * Returns nullptr if the song does not exist.
      */
     Song* findSongByID(int id);
+    const Song* findSongByID(int id) const;
 
      /*
      * Finds a song by its title.
@@ -86,6 +94,11 @@ public:
      */
     size_t getSongCount() const;
 
+    /*
+     * Returns the library version; it changes whenever songs are added.
+     */
+    std::uint64_t getVersion() const;
+
     /* 
      * Initializes the songByID. 
      * Must be called after loading all songs.
@@ -0,0 +1,45 @@
+#ifndef SONG_TAGS_H
+#define SONG_TAGS_H
+
+#include <string>
+#include "Song.h"
+
+/*
+ * Tempo and key hidden in sample-pack style names such as
+ * "90_C#m_FatChordsElGuitar_02_577" or "FL_FMT_Kit01_108_Bass_Loop_EbMaj".
+ *
+ * Names are split into tokens at '_', '-', ' ' and '.'. The tempo is
+ * the first plain number between MIN_BPM and MAX_BPM without a leading
+ * zero (take numbers such as "02" are skipped); the key is the first
+ * token made of a note, an optional '#' or 'b', and an optional mode
+ * ("m", or "min", "minor", "maj", "major" in any case). A note without
+ * a mode is taken as major.
+ */
+
+static constexpr int MIN_BPM = 50;
+static constexpr int MAX_BPM = 220;
+
+/*
+ * Reads one key token ("C#m", "EbMaj", "D"). Returns false if the
+ * token is not a key.
+ */
+bool parseKey(const std::string& token, CamelotKey& key);
+
+/*
+ * Fills bpm and key from a name, leaving either untouched if the name
+ * does not contain it. Returns true if anything was found.
+ */
+bool parseTempoAndKey(const std::string& name, int& bpm, CamelotKey& key);
+
+/*
+ * Fills song.bpm and song.key from its title, then from the file name
+ * of its path for whatever the title lacks.
+ */
+void tagSongFromName(Song& song);
+
+/*
+ * Camelot text of a key ("8A"), or "-" if unknown.
+ */
+std::string camelotName(const CamelotKey& key);
+
+#endif
@@ -3,6 +3,17 @@
 
 #include <string>
 
+/*
+ * Musical key as a position on the Camelot wheel, e.g. 8A = A minor,
+ * 8B = C major. Keys one number apart on the same letter, or on the
+ * same number, mix harmonically.
+ */
+struct CamelotKey
+{
+    int number {};              /* 1-12, 0 if unknown */
+    bool major {};              /* B (major) side, otherwise A (minor) */
+};
+
 /*
  * Represents a single audio track in the system.
  * This struct only stores metadata and does not contain playback logic.
@@ -15,6 +26,8 @@ struct Song
     std::string album;          /* album name */
     int duration {};            /* in seconds */
     std::string path;           /* file path */
+    int bpm {};                 /* tempo, 0 if unknown */
+    CamelotKey key;             /* musical key */
 };
 
 #endif
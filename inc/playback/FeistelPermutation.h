@@ -0,0 +1,51 @@
+#ifndef FEISTEL_PERMUTATION_H
+#define FEISTEL_PERMUTATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * FeistelPermutation
+ * ------------------
+ * Pseudo-random permutation of [0, n) defined entirely by a seed.
+ *
+ * A 6-round balanced Feistel network permutes the smallest
+ * even-bit-width power of two covering n (at least 256, so tiny
+ * playlists still get well-mixed orders); values that land outside
+ * [0, n) are encrypted again ("cycle walking") until they fall inside.
+ * Each lookup is O(1) expected (fewer than 4 walks on average once n
+ * exceeds 64) and the permutation needs no memory beyond the round keys.
+ */
+class FeistelPermutation
+{
+private:
+    static constexpr size_t ROUNDS = 6;
+
+    std::uint64_t domain = 0;       /* n */
+    unsigned halfBits = 4;          /* width of each Feistel half (at least 4) */
+    std::uint64_t halfMask = 15;
+    std::uint64_t roundKeys[ROUNDS] {};
+
+    /* One pass of the Feistel network over [0, 4^halfBits) */
+    std::uint64_t encrypt(std::uint64_t value) const;
+
+public:
+    FeistelPermutation() = default;
+
+    /*
+     * Creates the permutation of [0, size) selected by seed.
+     */
+    FeistelPermutation(std::uint64_t size, std::uint64_t seed);
+
+    /*
+     * Returns the image of index (index must be below size()).
+     */
+    std::uint64_t operator()(std::uint64_t index) const;
+
+    /*
+     * Returns n.
+     */
+    std::uint64_t size() const;
+};
+
+#endif
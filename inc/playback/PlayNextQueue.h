@@ -1,44 +1,135 @@
 #ifndef PLAYNEXT_QUEUE_H
 #define PLAYNEXT_QUEUE_H
 
-#include <queue>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "Song.h"
 
 /*
- * PlaybackQueue
+ * PlayNextQueue
  * -------------
- * Manages songs marked as "Play Next" using FIFO logic.
+ * Manages songs marked as "Play Next" using FIFO logic. MusicPlayer
+ * uses it as the lock-free inbox in front of its PriorityPlayNextQueue.
+ *
+ * Bounded lock-free multi-producer / single-consumer ring (Vyukov style):
+ *  - addSong() may be called from any number of threads at once
+ *    (UI, remote control, ...) and never blocks; it fails when full.
+ *  - playNext(), pop(), peek(), printAllSongs() and getSongIDs() belong
+ *    to the single consumer (MusicPlayer, under its state lock). They
+ *    are wait-free.
+ *
+ * Slots store pointers, so queued songs must outlive the queue;
+ * MusicPlayer only queues songs owned by the MusicLibrary.
  */
 class PlayNextQueue
 {
 private:
+    /* Each slot's sequence tells producers and the consumer whose turn it is */
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        const Song* song;
+    };
+
+    /* Keep producer and consumer counters on separate cache lines */
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> tail {0};  /* next slot to claim (producers) */
+    alignas(CACHE_LINE) std::atomic<size_t> head {0};  /* next slot to read (consumer) */
+
+public:
+    /* Default number of slots */
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
     /*
-     * FIFO queue of upcoming songs.
+     * Creates a queue with at least the given number of slots
+     * (rounded up to a power of two).
      */
-    std::queue<Song> queue;
+    explicit PlayNextQueue(size_t capacity = DEFAULT_CAPACITY);
+
+    PlayNextQueue(const PlayNextQueue&) = delete;
+    PlayNextQueue& operator=(const PlayNextQueue&) = delete;
 
-public:
     /*
-     * Adds a song to the end of the queue.
+     * Adds a song to the end of the queue. Lock-free, safe from any thread.
+     * Returns false if the queue is full.
      */
-    void addSong(const Song& song);
+    bool addSong(const Song& song);
 
     /*
      * Returns the next song to be played.
-     * Removes it from the queue.
+     * Removes it from the queue. Consumer only.
      */
     Song playNext();
 
+    /*
+     * Removes the front song and returns a pointer to it,
+     * or nullptr if the queue is empty. Consumer only.
+     */
+    const Song* pop();
+
     /*
      * Checks whether the queue is empty.
      */
     bool isEmpty() const;
 
+    /*
+     * Returns the number of queued songs. Exact for the consumer,
+     * approximate while producers are adding.
+     */
+    size_t size() const;
+
+    /*
+     * Returns the maximum number of queued songs.
+     */
+    size_t capacity() const;
+
+    /*
+     * Returns the song at the given distance from the front without
+     * removing it (0 is the song played next), or nullptr if there is
+     * no fully added song there. Consumer only.
+     */
+    const Song* peek(size_t offset) const;
+
     /*
      * Print all songs in the queue
      */
     void printAllSongs() const;
 
+    /*
+     * Returns the IDs of queued songs from front to back.
+     */
+    std::vector<int> getSongIDs() const;
+
 };
 
+/*
+ * Outcome of stressPlayNextQueue.
+ */
+struct PlayNextStressReport
+{
+    size_t producers = 0;
+    size_t songs = 0;               /* added by all producers together */
+    size_t lost = 0;                /* added but never popped */
+    size_t duplicated = 0;          /* popped more than once */
+    size_t reordered = 0;           /* popped ahead of an earlier song of the same producer */
+    size_t fullRetries = 0;         /* addSong calls that found the ring full */
+    double seconds = 0.0;
+    double songsPerSecond = 0.0;    /* add + pop pairs */
+};
+
+/*
+ * Hammer test of the ring: producers threads each add songsPerProducer
+ * distinct songs as fast as they can (retrying while full) into a queue
+ * of the given capacity, while the calling thread pops until every song
+ * is accounted for. A correct queue reports no lost, duplicated or
+ * reordered songs.
+ */
+PlayNextStressReport stressPlayNextQueue(size_t producers, size_t songsPerProducer, size_t capacity = 1024);
+
 #endif
@@ -1,25 +1,90 @@
 #ifndef PLAYBACK_HISTORY_H
 #define PLAYBACK_HISTORY_H
 
-#include <stack>
+#include <unordered_map>
+#include <vector>
 #include "Song.h"
 
 /*
  * PlaybackHistory
  * ----------------
- * Stores playback history using a LIFO stack.
- * Supports "Back" button functionality.
+ * Stores playback history with LIFO ("Back" button) semantics.
+ * Each song appears at most once; re-playing a song moves it to the top.
+ *
+ * Implemented as a fixed-capacity ring buffer plus an ID -> slot hash
+ * index, so push, duplicate removal, eviction and pop are all O(1)
+ * amortized, independent of the capacity.
  */
 class PlaybackHistory
 {
 private:
     /*
-     * Stack storing played songs.
-     * Top of stack = most recently played song.
+     * Ring slot. A slot whose song was re-played or evicted is left
+     * behind as a tombstone (live == false) and skipped later.
      */
-    std::stack<Song> history;
-    
+    struct Slot
+    {
+        Song song;
+        bool live = false;
+    };
+
+    /*
+     * Physical storage, twice the capacity so tombstones rarely
+     * force a compaction.
+     */
+    std::vector<Slot> ring;
+
+    /* Maximum number of songs kept in history */
+    size_t capacity;
+
+    /* Oldest used slot */
+    size_t tail = 0;
+
+    /* Number of used slots from tail, including tombstones */
+    size_t used = 0;
+
+    /* Number of live songs */
+    size_t liveCount = 0;
+
+    /*
+     * Key   : song ID
+     * Value : ring slot holding that song
+     */
+    std::unordered_map<int, size_t> slotByID;
+
+    /* Physical slot at the given distance from tail */
+    size_t slotAt(size_t offset) const;
+
+    /* Drops the oldest live song and any tombstones before it */
+    void evictOldest();
+
+    /* Rewrites live songs to the start of a ring of the given capacity */
+    void relayout(size_t newCapacity);
+
 public:
+    /*
+     * Default number of songs kept in history.
+     */
+    static constexpr size_t DEFAULT_CAPACITY = 200;
+
+    explicit PlaybackHistory(size_t capacity = DEFAULT_CAPACITY);
+
+    /*
+     * Changes how many songs are kept. Shrinking drops the oldest ones.
+     * O(capacity); intended for configuration, not the playback path.
+     */
+    void setCapacity(size_t newCapacity);
+
+    /*
+     * Returns the maximum number of songs kept in history.
+     */
+    size_t getCapacity() const;
+
+    /*
+     * Returns the number of songs in history.
+     */
+    size_t size() const;
+
     /*
      * Adds a song to playback history.
      * Should be called when a song finishes playing.
@@ -42,6 +107,11 @@ public:
      */
     void printHistory() const;
 
+    /*
+     * Returns the IDs of songs in history from oldest to most recent.
+     */
+    std::vector<int> getSongIDs() const;
+
 };
 
 #endif
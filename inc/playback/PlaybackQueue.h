@@ -3,8 +3,11 @@
 
 #include <list>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "Song.h"
 #include "MusicLibrary.h"
+#include "TimelineIndex.h"
 
 /*
  * PlaybackQueue manages the order of songs during playback.
@@ -24,6 +27,47 @@ private:
      * Iterator pointing to the currently playing song.
      */
     std::list<Song>::iterator current = queue.end();
+
+    /*
+     * Location of a queued song: its list node and its timeline slot.
+     */
+    struct IndexEntry
+    {
+        std::list<Song>::iterator node;
+        size_t slot;
+    };
+
+    /*
+     * Key   : song ID
+     * Value : location of that song inside the queue
+     * Keeps duplicate checks and removals O(1).
+     */
+    std::unordered_map<int, IndexEntry> songIndex;
+
+    /*
+     * Order-statistic tree of durations, one slot per song.
+     */
+    TimelineIndex timeline;
+
+    /*
+     * Slot -> list node, valid for live slots only.
+     */
+    std::vector<std::list<Song>::iterator> slotNodes;
+
+    /*
+     * Records the list node of a newly handed out slot.
+     */
+    void setSlotNode(size_t slot, std::list<Song>::iterator node);
+
+    /*
+     * Rebuilds songIndex and current after the list was copied.
+     */
+    void rebuildFrom(const PlaybackQueue& other);
+
+    /*
+     * Reassigns timeline slots in list order. O(n).
+     */
+    void rebuildTimeline();
     
 public:
     /*
@@ -31,12 +75,33 @@ public:
      */
     void addSong(const Song& song);
 
+    /*
+     * Inserts a song so that it ends up at the given position
+     * (past the end appends). If that is the current position, the new
+     * song becomes current, so it plays next instead of being skipped.
+     * Songs already queued are ignored. O(log n).
+     */
+    void insertSong(const Song& song, size_t position);
+
+    /*
+     * Reserves index space for the given number of songs,
+     * so a large queue is built without rehashing.
+     */
+    void reserve(size_t count);
+
     /*
      * Removes a song identified by its ID.
      * This operation does not invalidate iterators except the erased one.
      */
     void removeSongById(int songId);
 
+    /*
+     * Moves a song so that it ends up at the given position.
+     * Positions past the end move the song to the back.
+     * Returns false if the song is not queued. O(log n).
+     */
+    bool moveSong(int songId, size_t position);
+
     /*
      * Returns the currently playing song.
      */
@@ -51,6 +116,69 @@ public:
      */
     bool isEmpty() const;
 
+    /*
+     * Returns number of songs in the queue.
+     */
+    size_t size() const;
+
+    /*
+     * Returns the position of the current song.
+     * Returns size() if there is no current song.
+     */
+    size_t getCurrentIndex() const;
+
+    /*
+     * Moves the current song to the given position.
+     * An out of range index clears the current song.
+     */
+    void setCurrentIndex(size_t index);
+
+    /*
+     * Returns the IDs of queued songs in playback order.
+     */
+    std::vector<int> getSongIDs() const;
+
+    /*
+     * Appends pointers to the next count songs playNext() would return,
+     * starting at the current song and wrapping around like playNext().
+     * Nothing is copied; pointers stay valid until the songs are removed.
+     */
+    void peekUpcoming(size_t count, std::vector<const Song*>& out) const;
+
+    /* =============================================================
+     * TIMELINE QUERIES (all O(log n))
+     * Times are in seconds from the start of the first queued song.
+     * ============================================================= */
+
+    /*
+     * Returns the summed duration of every song in the queue.
+     */
+    long long totalDuration() const;
+
+    /*
+     * Returns the time left from the start of the current song
+     * to the end of the queue. Returns 0 if there is no current song.
+     */
+    long long remainingDuration() const;
+
+    /*
+     * Returns the song playing at the given time,
+     * or nullptr if the time lies outside the queue.
+     */
+    const Song* songAtTime(long long seconds) const;
+
+    /*
+     * Returns the time at which the song at the given position starts.
+     * Returns totalDuration() if the position is out of range.
+     */
+    long long startTimeOf(size_t position) const;
+
+    /*
+     * Makes the song playing at the given time the current song.
+     * Returns false and leaves the queue unchanged if out of range.
+     */
+    bool skipToTime(long long seconds);
+
     /*
      * Construcor default
      */
@@ -68,6 +196,7 @@ public:
 
     /*
      * Get all playbackQueue
+     * Callers may modify songs but must not add, remove or reorder nodes.
      */
     std::list<Song>& getQueue();
 
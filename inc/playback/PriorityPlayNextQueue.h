@@ -0,0 +1,143 @@
+#ifndef PRIORITY_PLAYNEXT_QUEUE_H
+#define PRIORITY_PLAYNEXT_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Song.h"
+
+/*
+ * Priority tiers of the "Play Next" queue, most urgent first.
+ * Values are stored in session checkpoints and must never be renumbered.
+ */
+enum class PlayNextLane : std::uint8_t
+{
+    Urgent    = 0,  /* jump ahead of everything else */
+    Requested = 1,  /* explicitly requested by a listener */
+    Suggested = 2   /* added automatically */
+};
+
+/* Number of PlayNextLane values */
+static constexpr size_t PLAY_NEXT_LANE_COUNT = 3;
+
+/*
+ * PriorityPlayNextQueue
+ * ---------------------
+ * "Play Next" songs ordered by lane, and first-in first-out within a lane.
+ *
+ * Implemented as an indexed 4-ary min-heap keyed by (lane, arrival
+ * sequence), plus a song ID -> heap slot index:
+ *  - push, pop, cancel and setLane are O(log n)
+ *  - contains and laneOf are O(1)
+ *
+ * A song is queued at most once; pushing a queued song into another lane
+ * moves it to the back of that lane.
+ *
+ * Slots store pointers, so queued songs must outlive the queue;
+ * MusicPlayer only queues songs owned by the MusicLibrary.
+ */
+class PriorityPlayNextQueue
+{
+private:
+    struct Entry
+    {
+        const Song* song;
+        std::uint64_t key;      /* lane in the top byte, arrival sequence below */
+    };
+
+    static constexpr size_t ARITY = 4;
+    static constexpr unsigned LANE_SHIFT = 56;
+
+    std::vector<Entry> heap;
+
+    /* song ID -> position in heap */
+    std::unordered_map<int, size_t> position;
+
+    /* Arrival counter used for FIFO order inside a lane */
+    std::uint64_t nextSequence = 0;
+
+    std::uint64_t makeKey(PlayNextLane lane);
+
+    void place(size_t slot, const Entry& entry);
+    void siftUp(size_t slot);
+    void siftDown(size_t slot);
+
+    /* Removes the entry at a heap slot */
+    void eraseAt(size_t slot);
+
+public:
+    /*
+     * Queues a song at the back of a lane.
+     * If the song is already queued in a different lane it is moved to
+     * the back of the new lane; in the same lane it keeps its place.
+     * Returns true if the song was not queued before.
+     */
+    bool push(const Song& song, PlayNextLane lane = PlayNextLane::Requested);
+
+    /*
+     * Returns the next song to be played.
+     * Removes it from the queue.
+     */
+    Song playNext();
+
+    /*
+     * Returns the song played next without removing it,
+     * or nullptr if the queue is empty.
+     */
+    const Song* front() const;
+
+    /*
+     * Removes a queued song. Returns false if it is not queued.
+     */
+    bool cancel(int songID);
+
+    /*
+     * Moves a queued song to the back of another lane; a song already
+     * in that lane keeps its place. Returns false if it is not queued.
+     */
+    bool setLane(int songID, PlayNextLane lane);
+
+    /*
+     * Checks whether a song is queued.
+     */
+    bool contains(int songID) const;
+
+    /*
+     * Returns the lane of a queued song (Requested if not queued).
+     */
+    PlayNextLane laneOf(int songID) const;
+
+    /*
+     * Checks whether the queue is empty.
+     */
+    bool isEmpty() const;
+
+    /*
+     * Returns the number of queued songs.
+     */
+    size_t size() const;
+
+    /*
+     * Appends up to count songs in play order without modifying the queue.
+     * O(count log count), independent of the queue size.
+     */
+    void peekUpcoming(size_t count, std::vector<const Song*>& out) const;
+
+    /*
+     * Print all songs in play order
+     */
+    void printAllSongs() const;
+
+    /*
+     * Returns the IDs of queued songs in play order.
+     */
+    std::vector<int> getSongIDs() const;
+
+    /*
+     * Removes every song.
+     */
+    void clear();
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef QUEUE_BATCH_H
+#define QUEUE_BATCH_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Kinds of edits that can be grouped in a QueueBatch.
+ */
+enum class QueueEditType
+{
+    Add,        /* append song to the playback queue */
+    Remove,     /* remove song from the playback queue */
+    Move,       /* move song to a new position in the playback queue */
+    PlayNext    /* append song to the "Play Next" queue */
+};
+
+/*
+ * One recorded edit. position is only used by Move.
+ */
+struct QueueEdit
+{
+    QueueEditType type;
+    int songID;
+    size_t position;
+};
+
+/*
+ * QueueBatch
+ * ----------
+ * Ordered list of queue edits applied together by MusicPlayer::applyBatch.
+ * Recording an edit does not touch any queue.
+ */
+class QueueBatch
+{
+private:
+    std::vector<QueueEdit> edits;
+
+public:
+    /* Records appending a song to the playback queue. */
+    void addSong(int songID);
+
+    /* Records removing a song from the playback queue. */
+    void removeSong(int songID);
+
+    /* Records moving a song so that it ends up at the given position. */
+    void moveSong(int songID, size_t position);
+
+    /* Records appending a song to the "Play Next" queue. */
+    void playNext(int songID);
+
+    /* Returns the recorded edits in order. */
+    const std::vector<QueueEdit>& getEdits() const;
+
+    /* Returns number of recorded edits. */
+    size_t size() const;
+
+    /* Checks whether no edit was recorded. */
+    bool isEmpty() const;
+
+    /* Discards all recorded edits. */
+    void clear();
+};
+
+#endif
@@ -1,15 +1,56 @@
 #ifndef SHUFFLE_MANAGER_H
 #define SHUFFLE_MANAGER_H
 
+#include <cstdint>
 #include <vector>
-#include <set>
 #include <random>
+#include <unordered_map>
 #include "Song.h"
+#include "FeistelPermutation.h"
+#include "WeightedSampler.h"
+#include "PlaybackQueue.h"
+#include "RecentPlays.h"
+
+/*
+ * How ShuffleManager orders songs.
+ */
+enum class ShuffleMode
+{
+    Random,     /* lazy Fisher-Yates driven by std::mt19937 from std::random_device */
+    Seeded,     /* Feistel permutation: reproducible from the seed and seekable */
+    Spread,     /* random, with songs of one artist / album spaced evenly apart */
+    Weighted    /* songs with larger weights tend to come earlier */
+};
 
 /*
  * ShuffleManager
  * --------------
  * Manages shuffled playback without immediate repeats.
+ *
+ * Random mode produces the permutation lazily with Fisher-Yates: each
+ * draw swaps a random not-yet-drawn song into the drawn prefix, so every
+ * draw is O(1) and no record of played songs is needed.
+ *
+ * Seeded mode never reorders the playlist. Shuffle position k maps to
+ * playlist index permutation(k), so the same seed always yields the same
+ * order (across restarts and devices) and any position is reachable in
+ * O(1) without producing the ones before it.
+ *
+ * Spread mode builds the whole order up front. Songs are grouped by
+ * artist (and by album inside an artist); each group of m songs is laid
+ * out at random offset + i * n / m, and the groups are k-way merged on
+ * those positions with a heap, so the cost is O(n log k) for k artists.
+ *
+ * Weighted mode draws lazily without replacement, each remaining song
+ * with probability proportional to its weight. Draws start on an alias
+ * table (O(1), redrawing songs already taken); once half of the weight
+ * is taken, or a weight changes, the remaining songs move to a Fenwick
+ * tree where draws and weight changes are O(log n).
+ *
+ * With a RecentPlays filter attached, every mode first moves songs
+ * inside the recently-played window behind the others (one O(1) check
+ * per song) and shuffles both parts on their own, so recently heard
+ * songs only come back once everything else has played.
  */
 class ShuffleManager
 {
@@ -19,28 +60,174 @@ private:
      */
     std::vector<Song*> shuffledSongs;
 
+    ShuffleMode mode = ShuffleMode::Random;
+
     /*
-     * IDs of songs already played in current shuffle cycle.
+     * Random mode: number of songs drawn so far.
+     * shuffledSongs[0, drawn) holds them in play order.
      */
-    std::set<int> playedSongIDs;
+    size_t drawn = 0;
+
+    /* Shuffle position returned by the next getNextSong() */
+    size_t cursor = 0;
 
     /*
     * Random number generator for shuffle.
     */
     std::mt19937 gen;
+
+    /* Seeded mode: shuffle position -> playlist index */
+    FeistelPermutation permutation;
+    std::uint64_t seed = 0;
+
+    /* Optional recently-played filter, not owned */
+    const RecentPlays* recentPlays = nullptr;
+
+    /*
+     * Songs outside the recent window. They occupy
+     * shuffledSongs[0, freshCount); held back songs follow.
+     */
+    size_t freshCount = 0;
+
+    /* Seeded mode: permutation of the held back songs */
+    FeistelPermutation recentPermutation;
+
+    /* Weighted mode: playlist index -> weight, and songs drawn so far */
+    std::vector<double> weights;
+    std::vector<bool> taken;
+    std::vector<size_t> weightedOrder;
+
+    /*
+     * Weighted mode: playlist range drawn from now, fresh songs first
+     * and then the held back ones, with its total and taken weight.
+     */
+    size_t phaseBegin = 0;
+    size_t phaseEnd = 0;
+    double phaseWeight = 0.0;
+    double takenWeight = 0.0;
+
+    /* Weighted mode samplers over the current phase */
+    AliasTable aliasTable;
+    WeightTree weightTree;
+    bool treeActive = false;
+
+    /* Weighted mode: song ID -> playlist index, built on first setWeight */
+    std::unordered_map<int, size_t> indexOfSong;
+
+    /* Moves recently played songs behind the others and sets freshCount */
+    void holdBackRecent();
+
+    /* Seeded mode: shuffle position -> index into shuffledSongs */
+    size_t seededIndex(size_t k) const;
+
+    /* Random mode: draws one more song into the prefix */
+    void drawOne();
+
+    /* Weighted mode: starts drawing from shuffledSongs[begin, end) */
+    void startPhase(size_t begin, size_t end);
+
+    /* Weighted mode: moves the songs left in the phase to the tree */
+    void switchToTree();
+
+    /* Weighted mode: draws one more song into weightedOrder */
+    void drawWeighted();
+
+    /* Frees Weighted mode state */
+    void clearWeighted();
+
+    /*
+     * Spread mode: reorders songs so equal values of fields[level] are
+     * evenly spaced, recursing into each group with the next field.
+     */
+    void spreadSongs(std::vector<Song*>& songs, size_t level);
     
 public:
     /*
-     * Initializes shuffle with a list of songs.
+     * Attaches a recently-played filter consulted by later initialize
+     * and insertSong calls, or detaches it with nullptr.
+     * The filter must outlive the ShuffleManager.
+     */
+    void setRecentPlays(const RecentPlays* recent);
+
+    /*
+     * Initializes a Random mode shuffle with a list of songs.
      */
     void initialize(const std::vector<Song*>& playlist);
 
     /*
-     * Returns the next shuffled song.
-     * Automatically resets when all songs are played.
+     * Initializes a Seeded mode shuffle with a list of songs.
+     * The same playlist, seed and recently played songs always give
+     * the same order.
+     */
+    void initialize(const std::vector<Song*>& playlist, std::uint64_t seed);
+
+    /*
+     * Initializes a Spread mode shuffle with a list of songs.
+     */
+    void initializeSpread(const std::vector<Song*>& playlist);
+
+    /*
+     * Initializes a Weighted mode shuffle. songWeights[i] belongs to
+     * playlist[i]; weights are clamped to a small positive minimum so
+     * every song is still drawn once.
+     */
+    void initializeWeighted(const std::vector<Song*>& playlist, const std::vector<double>& songWeights);
+
+    /*
+     * Changes the weight of a song that has not been drawn yet, in
+     * O(log n) (the first call also indexes the playlist in O(n)).
+     * Returns false unless in Weighted mode with the song in the shuffle.
+     */
+    bool setWeight(int songID, double weight);
+
+    /*
+     * Returns the next shuffled song in O(1),
+     * or nullptr once every song of the cycle has been returned.
      */
     Song* getNextSong();
 
+    /*
+     * Same as getNextSong().
+     */
+    Song* next();
+
+    /*
+     * Returns the song at shuffle position k, or nullptr if k >= size().
+     * O(1) in Seeded mode; Random and Weighted mode draw up to k first.
+     */
+    Song* at(size_t k);
+
+    /*
+     * Makes the next getNextSong() return the song at position k.
+     */
+    void seek(size_t k);
+
+    /*
+     * Returns the shuffle position of the next song.
+     */
+    size_t position() const;
+
+    /*
+     * Returns the number of songs in the shuffle.
+     */
+    size_t size() const;
+
+    ShuffleMode getMode() const;
+
+    /*
+     * Returns the seed of a Seeded mode shuffle.
+     */
+    std::uint64_t getSeed() const;
+
+    /*
+     * Inserts a song into a live shuffled queue at a uniformly random
+     * position among the songs not played yet (the current song and
+     * everything after it), leaving their order intact. Recently played
+     * songs go to the end instead. O(log n).
+     * Returns the position used.
+     */
+    size_t insertSong(PlaybackQueue& queue, const Song& song);
+
     /*
      * Print all songs in the shuffled list
      */
@@ -0,0 +1,114 @@
+#ifndef TIMELINE_INDEX_H
+#define TIMELINE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * TimelineIndex
+ * -------------
+ * Song durations in playback order, stored in an implicit treap: a
+ * randomized balanced binary tree ordered by queue position, where
+ * every node also keeps the song count and total duration of its
+ * subtree.
+ *
+ * Each entry is identified by a slot that stays fixed while other
+ * entries are inserted, erased or moved around it. Insertion at any
+ * position, erasure, prefix sums, time lookups and position lookups
+ * are all O(log n) expected. Erased slots are reused.
+ */
+class TimelineIndex
+{
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    struct Node
+    {
+        size_t left;
+        size_t right;
+        size_t parent;
+        size_t count;           /* entries in this subtree */
+        long long seconds;      /* summed duration of this subtree */
+        int duration;
+        std::uint32_t priority; /* max-heap order keeps the tree balanced */
+    };
+
+    std::vector<Node> nodes;
+    std::vector<size_t> freeSlots;
+    size_t root = NONE;
+
+    /* xorshift state for node priorities */
+    std::uint32_t randomState = 0x9E3779B9u;
+
+    size_t countOf(size_t node) const;
+    long long secondsOf(size_t node) const;
+
+    /* Recomputes count and seconds of a node from its children */
+    void update(size_t node);
+
+    /* Rotates a node above its parent */
+    void rotateUp(size_t node);
+
+    /* Creates a detached node */
+    size_t allocate(int duration);
+
+public:
+    TimelineIndex();
+
+    /*
+     * Removes all slots.
+     */
+    void clear();
+
+    /*
+     * Replaces the index with entries of the given durations in O(n).
+     * Slot i holds durations[i].
+     */
+    void build(const std::vector<int>& durations);
+
+    /*
+     * Appends an entry at the end of the timeline and returns its slot.
+     */
+    size_t append(int duration);
+
+    /*
+     * Inserts an entry so that it ends up at the given position
+     * (past the end appends) and returns its slot.
+     */
+    size_t insertAt(size_t position, int duration);
+
+    /*
+     * Removes a live entry. Its slot may be handed out again.
+     */
+    void erase(size_t slot);
+
+    /* Upper bound of slot numbers handed out so far. */
+    size_t slotCount() const;
+
+    /* Number of live entries. */
+    size_t liveCount() const;
+
+    /* Sum of all live durations. */
+    long long totalDuration() const;
+
+    /* Sum of durations of entries strictly before the given slot. */
+    long long durationBefore(size_t slot) const;
+
+    /* Number of entries strictly before the given slot (its position). */
+    size_t countBefore(size_t slot) const;
+
+    /*
+     * Returns the slot whose interval [start, start + duration)
+     * contains the given time, or slotCount() if time is out of range.
+     */
+    size_t slotAtTime(long long seconds) const;
+
+    /*
+     * Returns the slot of the entry at the given position,
+     * or slotCount() if the position is out of range.
+     */
+    size_t slotAtPosition(size_t position) const;
+};
+
+#endif
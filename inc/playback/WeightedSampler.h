@@ -0,0 +1,99 @@
+#ifndef WEIGHTED_SAMPLER_H
+#define WEIGHTED_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+ * AliasTable
+ * ----------
+ * Walker / Vose alias method: after an O(n) build, draws index i with
+ * probability weights[i] / sum(weights) in O(1) (one uniform column and
+ * one biased coin). Sampling is with replacement and the weights are
+ * fixed; 12 bytes per entry.
+ */
+class AliasTable
+{
+private:
+    /* Chance of keeping column i instead of jumping to alias[i] */
+    std::vector<double> probability;
+    std::vector<std::uint32_t> alias;
+
+public:
+    /*
+     * Builds the table. Weights must be non-negative with a positive sum;
+     * otherwise the table is left empty.
+     */
+    void build(const std::vector<double>& weights);
+
+    /*
+     * Returns a random index, or size() if the table is empty.
+     */
+    size_t sample(std::mt19937& gen) const;
+
+    size_t size() const;
+
+    /* Frees the table */
+    void clear();
+};
+
+/*
+ * WeightTree
+ * ----------
+ * Fenwick (binary indexed) tree of weights. Build is O(n); changing a
+ * weight and drawing an index in proportion to its weight are both
+ * O(log n), so drawing and then zeroing entries gives weighted
+ * sampling without replacement while weights keep changing.
+ */
+class WeightTree
+{
+private:
+    /* 1-based Fenwick sums */
+    std::vector<double> tree;
+
+    /* Exact current weights, used to repair rounding drift */
+    std::vector<double> weights;
+
+    /* Entries with a positive weight */
+    size_t positive = 0;
+
+    /* Largest power of two not above size() */
+    size_t topStep = 0;
+
+    /* Sum of the first count weights, from the tree */
+    double prefix(size_t count) const;
+
+    /* Recomputes the tree from weights */
+    void rebuild();
+
+public:
+    /*
+     * Replaces all weights in O(n).
+     */
+    void build(const std::vector<double>& initial);
+
+    /*
+     * Sets the weight of entry i (negative values count as 0). O(log n).
+     */
+    void set(size_t i, double weight);
+
+    double weight(size_t i) const;
+
+    /* Sum of all weights. O(log n). */
+    double total() const;
+
+    /*
+     * Returns an index drawn in proportion to its weight,
+     * or size() if every weight is 0. O(log n).
+     */
+    size_t sample(std::mt19937& gen);
+
+    size_t size() const;
+
+    /* Frees the tree */
+    void clear();
+};
+
+#endif
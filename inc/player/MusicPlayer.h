@@ -3,13 +3,52 @@
 
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include "MusicLibrary.h"
 #include "PlaybackQueue.h"
 #include "PlaybackHistory.h"
 #include "PlayNextQueue.h"
+#include "PriorityPlayNextQueue.h"
 #include "ShuffleManager.h"
 #include "SmartPlaylist.h"
+#include "SmartPlaylistCache.h"
+#include "SmartRadio.h"
+#include "BatchPlaylist.h"
+#include "TimedPlaylist.h"
+#include "SessionJournal.h"
+#include "QueueBatch.h"
+#include "ListeningLog.h"
+#include "PlayStatistics.h"
+#include "RecentPlays.h"
+#include "CoPlayIndex.h"
+#include "AudioFeatures.h"
+
+/*
+ * Where an upcoming song will be taken from.
+ */
+enum class UpcomingSource
+{
+    Repeat,     /* current song, replayed because repeat is enabled */
+    PlayNext,   /* high-priority "Play Next" queue */
+    Radio,      /* smart radio, chosen ahead of time */
+    Queue       /* standard playback queue */
+};
+
+/*
+ * A song that is about to play, copied while the player was locked,
+ * so it stays valid however the queues change afterwards.
+ */
+struct UpcomingSong
+{
+    Song song;
+    UpcomingSource source;
+};
 
 /*
  * Acts as the central controller for the application.
@@ -31,11 +70,98 @@ private:
     /* Queue for smart playlist */
     PlaybackQueue smartQueue;
 
+    /* Artist / album links between songs, rebuilt when the library changes. */
+    SimilarityGraph similarityGraph;
+
+    /* Songs by Camelot key and tempo, built on first harmonic mix. */
+    HarmonicIndex harmonicIndex;
+
+    /* Songs played near each other, read from the listening log on first use. */
+    CoPlayIndex coPlayIndex;
+    bool coPlayIndexLoaded = false;
+
+    /* How songs sound, from audio analysis; read from disk on first use. */
+    AcousticIndex acousticIndex;
+    bool acousticIndexLoaded = false;
+
+    /*
+     * Serializes updates of acousticIndex, which are built on a copy with
+     * stateMutex released and swapped in. Taken before stateMutex.
+     */
+    std::mutex acousticUpdateMutex;
+
+    /* Ranks candidates of best-first smart playlists. */
+    DefaultSongScorer songScorer { &coPlayIndex };
+
+    /* Smart playlists generated before, reused and extended by later requests. */
+    SmartPlaylistCache smartPlaylistCache;
+
+    /* Endless smart playlist; while set, it plays instead of the queue. */
+    std::unique_ptr<SmartRadio> smartRadio;
+
+    /* Runs parallel playlist generation; started on first use. */
+    std::unique_ptr<WorkStealingPool> workerPool;
+
+    /*
+     * Held by whoever runs a group of tasks on workerPool, since its
+     * wait() waits for every task. Taken after stateMutex, never before.
+     */
+    std::mutex poolMutex;
+
+    /*
+     * Batches reading the shared indexes with stateMutex released. While
+     * any run, plays are kept in deferredCoPlays instead of changing
+     * coPlayIndex under them, and folded in when the last one ends.
+     * The library, and so the similarity graph and harmonic index, do
+     * not change after loading.
+     */
+    size_t sharedIndexReaders = 0;
+    std::vector<ListeningEvent> deferredCoPlays;
+
+    /* Start and end such a reader; both with stateMutex held */
+    void acquireSharedIndexes();
+    void releaseSharedIndexes();
+
+    /* Rebuilds similarityGraph (dropping cached playlists) if the library changed since. */
+    void refreshSimilarityGraph();
+
+    /* Rebuilds harmonicIndex if the library changed since. */
+    void refreshHarmonicIndex();
+
+    WorkStealingPool& getWorkerPool();
+
+    /* Cache parameters of best-first playlists under the current scoring. */
+    std::uint64_t bestFirstCacheParameters() const;
+
+    /* Reads coPlayIndex from the listening log, once; logListeningEvent() keeps it current. */
+    void loadCoPlayIndex();
+
+    /*
+     * Reads acousticIndex from the features file, once. lock holds
+     * stateMutex and is released while the file is read and clustered.
+     */
+    void loadAcousticIndex(std::unique_lock<std::mutex>& lock);
+
+    /*
+     * Turns smart playlist mode on with the freshly generated smartQueue.
+     * Must be called with stateMutex held.
+     */
+    void installSmartQueue();
+
     /* Queue for shuffle */
     PlaybackQueue shuffleQueue; 
 
-    /* High-priority queue for user-selected "Play Next" songs. */
-    PlayNextQueue playNextQueue;
+    /*
+     * Lock-free inbox for "Requested" Play Next songs added from any
+     * thread. Drained into playNextQueue under stateMutex.
+     */
+    mutable PlayNextQueue playNextInbox;
+
+    /*
+     * High-priority "Play Next" songs, ordered by lane.
+     * Mutable only so const readers can drain the inbox first.
+     */
+    mutable PriorityPlayNextQueue playNextQueue;
 
     /* Stack storing previously played songs for "Back" functionality. */
     PlaybackHistory playbackHistory;
@@ -50,8 +176,118 @@ private:
     bool smartPlaylistEnabled = false;
     bool shuffleEnabled = false;
 
+    /* Order used by applyShuffle, and the seed of Seeded shuffles */
+    ShuffleMode shuffleMode = ShuffleMode::Seeded;
+    std::uint64_t shuffleSeed = 0;
+
+    /* Produces shuffled queues and places songs added while shuffled. */
+    ShuffleManager shuffleManager;
+
     /* Flag indicating if a song is currently loaded (playing or paused). */
     bool hasCurrentSong = false;
+
+    /*
+     * Guards queues, history and current song state. Held for the whole
+     * of every public operation (except the lock-free Play Next producer
+     * path) so the UI thread and the audio thread never observe a
+     * half-applied change.
+     */
+    mutable std::mutex stateMutex;
+
+    /* Incremented once per published queue change. */
+    std::atomic<std::uint64_t> queueVersion {0};
+
+    /* Optional callback invoked after each queue change. */
+    std::function<void(std::uint64_t)> queueChangedListener;
+
+    /* Guards queueChangedListener only, so publishing never waits for stateMutex. */
+    mutable std::mutex listenerMutex;
+
+    /*
+     * Bumps queueVersion and notifies the listener.
+     * Must be called without holding stateMutex.
+     */
+    void publishQueueChange();
+
+    /*
+     * Moves songs from playNextInbox into playNextQueue, journaling each.
+     * Must be called with stateMutex held.
+     */
+    void drainPlayNextInbox() const;
+
+    /* Durable record of every song that stopped playing. */
+    ListeningLog listeningLog;
+
+    /* Streaming most-played rankings, fed on every track change. */
+    PlayStatistics playStatistics;
+
+    /* Last play of every song, held back by shuffle and smart playlists. */
+    RecentPlays recentPlays;
+
+    /* Wall-clock time at which currentSong started. */
+    std::chrono::system_clock::time_point currentStartedAt;
+
+    /*
+     * Weighted shuffle weight of each song: grows with the times it was
+     * played through and shrinks with the times it was skipped recently.
+     */
+    std::vector<double> shuffleWeights(const std::vector<Song*>& playlist) const;
+
+    /*
+     * Appends currentSong to the listening log.
+     * Must be called before currentSong is replaced.
+     */
+    void logListeningEvent();
+
+    /*
+     * Binary journal used to restore the session after a restart.
+     * Mutable so const readers can journal the songs they drain.
+     */
+    mutable SessionJournal sessionJournal;
+
+    /*
+     * Records collected by applyBatch while batchOpen is set; they are
+     * journaled together as one batch when it ends.
+     */
+    std::vector<JournalRecord> batchRecords;
+    bool batchOpen = false;
+
+    /*
+     * Appends one operation to the journal, compacting it when due.
+     * Inside applyBatch the operation is added to the open batch instead.
+     */
+    void recordOperation(JournalOp op, int arg = 0);
+
+    /* Captures the complete session state for a checkpoint. */
+    SessionSnapshot captureSession() const;
+
+    /* Writes a compacted checkpoint of the current session. */
+    void checkpointSession();
+
+    /*
+     * Rebuilds the session from the last checkpoint and journal.
+     * Songs no longer present in the library are skipped.
+     */
+    void restoreSession();
+
+    /* Applies one journaled operation without journaling it again. */
+    void replayOperation(const JournalRecord& record);
+
+    /* Shared implementation of enableShuffle and enableShuffleWithSeed. */
+    void startShuffle(ShuffleMode mode, std::uint64_t seed);
+
+    /* The unshuffled queue restored when shuffle is turned off. */
+    PlaybackQueue& shuffleSource();
+
+    /*
+     * Adds a song to the playback queue, optionally journaling it.
+     * While shuffled, the song is also appended to shuffleSource() and
+     * placed at a random unplayed position in O(log n).
+     */
+    void queueSong(Song& song, bool journal);
+
+    /* Removes a song from the playback queue (and shuffleSource()). */
+    void dequeueSong(int songID);
     
 public:
     /*
@@ -72,7 +308,8 @@ public:
     /*
      * Plays the next song based on priority:
      * 1. 'Play Next' Queue
-     * 2. Standard Playback Queue
+     * 2. Smart Radio, while it is on
+     * 3. Standard Playback Queue
      */
     void playNext();
 
@@ -81,23 +318,91 @@ public:
      */
     void playPrevious();
 
+    /*
+     * Returns copies of up to count songs in the order they will
+     * play, without copying or modifying any queue. Cost is O(count).
+     * With repeat enabled, the current song comes first, followed
+     * by the songs a manual "Next" would play.
+     */
+    std::vector<UpcomingSong> peekUpcoming(size_t count) const;
+
     /* =============================================================
      * QUEUE MANAGEMENT
      * ============================================================= */
 
     /*
-     * Adds a specific song to the high-priority "Play Next" queue.
+     * Adds a specific song to the high-priority "Play Next" queue,
+     * at the back of the given lane. A song already queued is moved.
+     * The Requested lane is lock-free and safe from any thread.
+     */
+    void addSongToPlayNext(int songID, PlayNextLane lane = PlayNextLane::Requested);
+
+    /*
+     * Removes a song from the "Play Next" queue.
+     */
+    void cancelPlayNext(int songID);
+
+    /*
+     * Moves a queued "Play Next" song to the back of another lane.
+     * Picking the lane it is already in changes nothing.
      */
-    void addSongToPlayNext(int songID);
+    void setPlayNextLane(int songID, PlayNextLane lane);
 
     /* Print Play Next queue */
     void printPlayNextQueue() const;
 
+    /*
+     * Appends a song from the library to the playback queue.
+     */
+    void addSongToQueue(int songID);
+
+    /*
+     * Appends every song of an album to the playback queue.
+     */
+    void addAlbumToQueue(const std::string& albumName);
+
+    /*
+     * Appends the whole library to the playback queue.
+     */
+    void addLibraryToQueue();
+
+    /*
+     * Removes a song from the playback queue.
+     */
+    void removeSongFromQueue(int songID);
+
+    /*
+     * Applies all edits of a batch under a single lock, journals them
+     * as one all-or-nothing batch record and publishes one change
+     * notification. Edits naming unknown songs are skipped.
+     */
+    void applyBatch(const QueueBatch& batch);
+
+    /*
+     * Registers a callback run after every queue change with the new
+     * version number. It runs outside the state lock, so it may call
+     * back into the player (e.g. peekUpcoming).
+     */
+    void setQueueChangedListener(std::function<void(std::uint64_t)> listener);
+
+    /* Returns the number of queue changes published so far. */
+    std::uint64_t getQueueVersion() const;
+
     /*
      * Randomizes the current playback order using the ShuffleManager.
      * Replaces the current playback queue with the shuffled version.
+     * Seeded mode picks a fresh seed and reports it.
+     */
+    void enableShuffle(ShuffleMode mode = ShuffleMode::Seeded);
+
+    /*
+     * Enables a Seeded shuffle with a known seed, reproducing the
+     * order of another session or device for the same queue.
      */
-    void enableShuffle();
+    void enableShuffleWithSeed(std::uint64_t seed);
+
+    /* Returns the seed of the current Seeded shuffle. */
+    std::uint64_t getShuffleSeed() const;
 
     /*
      * Restore playbackQueue to original
@@ -105,10 +410,37 @@ public:
     void disableShuffle();
 
     /*
-     * Generates a "Smart Playlist" using Breadth-First Search (BFS)
-     * starting from a seed song.
+     * Generates a "Smart Playlist" starting from a seed song, either
+     * best-first by similarity score, by Breadth-First Search (BFS), or
+     * as a harmonic mix (the seed needs a tempo and key).
      */
-    void enableSmartPlaylist(int startSongID, int maxSize);
+    void enableSmartPlaylist(int startSongID, int maxSize,
+                             SmartPlaylistMode mode = SmartPlaylistMode::BestFirst);
+
+    /*
+     * Generates a smart playlist blending the neighbourhoods of several
+     * seed songs, each contributing in proportion to its weight
+     * (missing weights count as 1). Each seed expands as its own task on
+     * the worker pool. The seeds themselves are part of the mix unless
+     * includeSeeds is false.
+     */
+    void enableSmartMix(const std::vector<int>& seedIDs, const std::vector<double>& weights, int maxSize,
+                        bool includeSeeds = true);
+
+    /*
+     * Smart mix seeded by the last seedCount songs played,
+     * the most recent one weighted highest. The seeds are left out.
+     */
+    void enableSmartMixFromHistory(size_t seedCount, int maxSize);
+
+    /*
+     * Smart playlist lasting targetSeconds, give or take
+     * toleranceSeconds, drawn from a seed song's neighbourhood
+     * (startSongID 0: the whole library) and limited to songs the
+     * filter accepts. Recently played songs are left out.
+     */
+    void enableTimedPlaylist(int startSongID, int targetSeconds, int toleranceSeconds,
+                             const std::function<bool(const Song&)>& filter = nullptr);
 
 
     /*
@@ -116,6 +448,40 @@ public:
      */
     void disableSmartPlaylist();
 
+    /*
+     * Starts an endless radio of songs similar to a seed song, chosen
+     * one at a time as they are played. The playback queue is paused
+     * (not changed) while the radio is on. Not kept across sessions.
+     */
+    void enableSmartRadio(int startSongID);
+
+    /*
+     * Stops the radio; playback continues from the queue.
+     */
+    void disableSmartRadio();
+
+    /*
+     * Generates many playlists at once on the worker pool (see
+     * generatePlaylistBatch), e.g. nightly playlists for every user
+     * profile. The player stays usable while the batch runs; plays
+     * logged meanwhile reach the co-play index once it is done.
+     */
+    BatchReport generatePlaylistBatch(const std::vector<PlaylistJob>& jobs,
+                                      std::vector<std::vector<std::uint32_t>>& playlists);
+
+    /*
+     * Decodes every song's WAV file and stores its acoustic features,
+     * in parallel on the worker pool, then saves them for later runs.
+     * Playback is not locked out while files are analysed.
+     */
+    void analyzeLibraryAudio();
+
+    /*
+     * Prints the songs that sound most like a song (needs a previous
+     * analyzeLibraryAudio()).
+     */
+    void printSimilarSounding(int songID, size_t count);
+
     /*
      * Applies shuffle to a given playback queue and returns the shuffled version.
      */
@@ -142,11 +508,30 @@ public:
     PlaybackQueue& getPlaybackQueue();
 
     /* Retrieves the priority playback queue. */
-    PlayNextQueue& getPlayNextQueue();
+    PriorityPlayNextQueue& getPlayNextQueue();
 
     /* Retrieves the playback history stack. */
     PlaybackHistory& getPlaybackHistory();
 
+    /* Retrieves the durable listening log for analytics queries. */
+    const ListeningLog& getListeningLog() const;
+
+    /* Retrieves the streaming most-played rankings. */
+    const PlayStatistics& getPlayStatistics() const;
+
+    /*
+     * Prints the most played songs, artists and albums of a window.
+     */
+    void printMostPlayed(StatsWindow window, size_t count) const;
+
+    /*
+     * Sets which songs shuffle and smart playlists hold back: those
+     * among the last plays songs played or started less than seconds
+     * ago (0 disables either part). Takes effect at the next shuffle
+     * or smart playlist.
+     */
+    void setRecentlyPlayedWindow(std::uint32_t plays, std::int64_t seconds);
+
     /* Overwrites the current playback queue with a new one. */
     void setPlaybackQueue(PlaybackQueue& pb);
 
@@ -0,0 +1,153 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Operations recorded in the session journal.
+ * Values are stored on disk and must never be renumbered.
+ */
+enum class JournalOp : std::uint32_t
+{
+    QueueAdd     = 1,   /* arg = song ID appended to playbackQueue */
+    QueueRemove  = 2,   /* arg = song ID removed from playbackQueue */
+    QueueAdvance = 3,   /* playbackQueue moved to its next song */
+    PlayNextAdd  = 4,   /* arg = song ID queued in the Requested Play Next lane */
+    PlayNextPop  = 5,   /* front of playNextQueue was consumed */
+    HistoryPush  = 6,   /* arg = song ID pushed to playbackHistory */
+    HistoryPop   = 7,   /* most recent history entry was consumed */
+    SetCurrent   = 8,   /* arg = ID of the song now active in the player */
+    SetRepeat    = 9,   /* arg = 1 if repeat is enabled, otherwise 0 */
+    PlayNextUrgent    = 10, /* arg = song ID queued in the Urgent Play Next lane */
+    PlayNextSuggested = 11, /* arg = song ID queued in the Suggested Play Next lane */
+    PlayNextCancel    = 12, /* arg = song ID removed from the Play Next queue */
+    QueueInsertAt     = 13, /* arg = position the song of the preceding QueueAdd moves to */
+    BatchBegin        = 14, /* arg = number of records that follow and belong to one batch */
+    QueueMove         = 15, /* arg = song ID moved to the position of the following QueueMoveTo */
+    QueueMoveTo       = 16  /* arg = position the song of the preceding QueueMove moves to */
+};
+
+/*
+ * One fixed-size journal entry.
+ */
+struct JournalRecord
+{
+    JournalOp op;
+    std::int32_t arg;
+};
+
+/*
+ * Song IDs of a playback queue plus the position of its current song.
+ * currentIndex equals songIDs.size() when there is no current song.
+ */
+struct QueueSnapshot
+{
+    std::vector<int> songIDs;
+    std::uint64_t currentIndex {};
+};
+
+/*
+ * Complete compacted state of a MusicPlayer session.
+ */
+struct SessionSnapshot
+{
+    QueueSnapshot playbackQueue;
+    QueueSnapshot baseQueue;
+    QueueSnapshot smartQueue;
+    std::vector<int> playNextIDs;       /* front to back */
+    std::vector<int> playNextLanes;     /* PlayNextLane of each playNextIDs entry */
+    std::vector<int> historyIDs;        /* oldest to most recent */
+    int currentSongID {};
+    bool hasCurrentSong = false;
+    bool baseQueueSaved = false;
+    bool smartPlaylistEnabled = false;
+    bool shuffleEnabled = false;
+    bool repeatEnabled = false;
+    int shuffleMode {};                 /* ShuffleMode of the active shuffle */
+    std::uint64_t shuffleSeed {};       /* seed of a Seeded shuffle */
+};
+
+/*
+ * SessionJournal
+ * --------------
+ * Persists the playback session as a binary checkpoint followed by an
+ * append-only log of the operations applied since that checkpoint.
+ *
+ * Both files carry a generation number. A journal is only replayed on
+ * top of the checkpoint with the same generation, so a crash between
+ * writing a checkpoint and truncating the journal cannot apply the
+ * same operations twice. A partially written trailing record or batch
+ * is ignored.
+ */
+class SessionJournal
+{
+private:
+    std::string journalPath;
+    std::string checkpointPath;
+
+    /* Open journal file, nullptr until the first checkpoint is written */
+    std::FILE* journalFile = nullptr;
+
+    /* Generation of the current checkpoint and journal */
+    std::uint64_t generation = 0;
+
+    /* Records appended since the last checkpoint */
+    std::atomic<std::size_t> recordsSinceCheckpoint {0};
+
+    /* Staging area of appendBatch, kept to avoid reallocating */
+    std::vector<JournalRecord> batchBuffer;
+
+    /* Serializes writers (UI thread and audio thread) */
+    std::mutex journalMutex;
+
+    bool readCheckpoint(const std::string& path, SessionSnapshot& snapshot);
+
+public:
+    /*
+     * Number of records after which a compacted checkpoint is due.
+     */
+    static constexpr std::size_t CHECKPOINT_INTERVAL = 4096;
+
+    SessionJournal(const std::string& journalPath, const std::string& checkpointPath);
+    ~SessionJournal();
+
+    SessionJournal(const SessionJournal&) = delete;
+    SessionJournal& operator=(const SessionJournal&) = delete;
+
+    /*
+     * Reads the last checkpoint and the records journaled after it.
+     * Returns false if no usable checkpoint exists.
+     */
+    bool load(SessionSnapshot& snapshot, std::vector<JournalRecord>& records);
+
+    /*
+     * Appends one record and flushes it to the operating system.
+     * Does nothing until a checkpoint has opened the journal.
+     */
+    void append(JournalOp op, int arg = 0);
+
+    /*
+     * Appends a group of records behind one BatchBegin record in a
+     * single write. load() returns either all of them or, if the tail
+     * was torn, none.
+     */
+    void appendBatch(const std::vector<JournalRecord>& records);
+
+    /*
+     * Atomically replaces the checkpoint with the given state
+     * and starts a new, empty journal.
+     */
+    void writeCheckpoint(const SessionSnapshot& snapshot);
+
+    /*
+     * Checks whether enough records accumulated to compact the journal.
+     */
+    bool needsCheckpoint() const;
+};
+
+#endif
@@ -0,0 +1,515 @@
+#include "AcousticIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Songs whose distances are summed at once; the block stays in L1 */
+static constexpr size_t SCAN_BLOCK = 1024;
+
+/* k-means trains on at most this many songs per list */
+static constexpr size_t TRAINING_PER_LIST = 64;
+
+static constexpr std::uint32_t FILE_MAGIC = 0x58494341;    /* "ACIX" */
+static constexpr std::uint32_t FILE_VERSION = 1;
+
+/* Heap order: the farthest match on top, ties broken by song ID */
+static bool closer(const AcousticIndex::Match& a, const AcousticIndex::Match& b)
+{
+    return (a.distance != b.distance) ? a.distance < b.distance : a.songID < b.songID;
+}
+
+/* distances[i] += (column[i] - value)^2; contiguous and branch-free */
+static void addSquaredDifferences(const float* column, float value, size_t count, float* distances)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 values = _mm_set1_ps(value);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 difference = _mm_sub_ps(_mm_loadu_ps(column + i), values);
+        _mm_storeu_ps(distances + i, _mm_add_ps(_mm_loadu_ps(distances + i), _mm_mul_ps(difference, difference)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float difference = column[i] - value;
+        distances[i] += difference * difference;
+    }
+}
+
+/* Offers one match to a max-heap holding the k best */
+static void offer(const AcousticIndex::Match& match, size_t k, std::vector<AcousticIndex::Match>& best)
+{
+    if (best.size() < k)
+    {
+        best.push_back(match);
+        std::push_heap(best.begin(), best.end(), closer);
+    }
+    else if (closer(match, best.front()))
+    {
+        std::pop_heap(best.begin(), best.end(), closer);
+        best.back() = match;
+        std::push_heap(best.begin(), best.end(), closer);
+    }
+}
+
+void AcousticIndex::scan(const float* block, size_t stride, const std::uint32_t* rows,
+                         const std::vector<int>& ids, size_t first, size_t last,
+                         const FeatureVector& query, size_t k, std::vector<Match>& best)
+{
+    float distances[SCAN_BLOCK];
+
+    for (size_t start = first; start < last; start += SCAN_BLOCK)
+    {
+        size_t count = std::min(SCAN_BLOCK, last - start);
+        std::fill(distances, distances + count, 0.0f);
+
+        for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+        {
+            addSquaredDifferences(block + d * stride + start, query[d], count, distances);
+        }
+
+        size_t i = 0;
+
+#ifdef __SSE2__
+        /* Once k are kept, four songs farther than all of them are skipped at once */
+        for (; i + 4 <= count; i += 4)
+        {
+            if (best.size() >= k &&
+                _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(distances + i), _mm_set1_ps(best.front().distance))) == 0)
+            {
+                continue;
+            }
+
+            for (size_t j = i; j < i + 4; ++j)
+            {
+                size_t position = (rows != nullptr) ? rows[start + j] : start + j;
+
+                if (best.size() < k || distances[j] <= best.front().distance)
+                {
+                    offer({ ids[position], distances[j] }, k, best);
+                }
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            size_t position = (rows != nullptr) ? rows[start + i] : start + i;
+
+            /* Squared distances until the end; the order is the same */
+            if (best.size() < k || distances[i] <= best.front().distance)
+            {
+                offer({ ids[position], distances[i] }, k, best);
+            }
+        }
+    }
+}
+
+void AcousticIndex::clear()
+{
+    songIDs.clear();
+    positionOf.clear();
+    columns.clear();
+    capacity = 0;
+
+    centroids.clear();
+    listOffsets.clear();
+    listSongs.clear();
+    listColumns.clear();
+    listCount = 0;
+    indexedSongs = 0;
+}
+
+void AcousticIndex::reserveColumns(size_t count)
+{
+    if (count <= capacity)
+    {
+        return;
+    }
+
+    /* Columns are interleaved in one block, so growing moves each one */
+    size_t grown = std::max(count, capacity * 2);
+    std::vector<float> moved(ACOUSTIC_DIMENSIONS * grown, 0.0f);
+
+    for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+    {
+        std::copy(columns.begin() + d * capacity, columns.begin() + d * capacity + songIDs.size(),
+                  moved.begin() + d * grown);
+    }
+
+    columns.swap(moved);
+    capacity = grown;
+}
+
+void AcousticIndex::add(int songID, const FeatureVector& features)
+{
+    auto known = positionOf.find(songID);
+    size_t position;
+
+    if (known != positionOf.end())
+    {
+        position = known->second;
+
+        /* Its list was chosen for the old vector */
+        if (position < indexedSongs)
+        {
+            centroids.clear();
+            listOffsets.clear();
+            listSongs.clear();
+            listColumns.clear();
+            listCount = 0;
+            indexedSongs = 0;
+        }
+    }
+    else
+    {
+        position = songIDs.size();
+        reserveColumns(position + 1);
+        songIDs.push_back(songID);
+        positionOf.emplace(songID, static_cast<std::uint32_t>(position));
+    }
+
+    for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+    {
+        columns[d * capacity + position] = features[d];
+    }
+}
+
+size_t AcousticIndex::size() const
+{
+    return songIDs.size();
+}
+
+bool AcousticIndex::featuresOf(int songID, FeatureVector& features) const
+{
+    auto known = positionOf.find(songID);
+
+    if (known == positionOf.end())
+    {
+        return false;
+    }
+
+    for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+    {
+        features[d] = columns[d * capacity + known->second];
+    }
+
+    return true;
+}
+
+void AcousticIndex::nearest(const FeatureVector& query, size_t k, std::vector<Match>& result) const
+{
+    result.clear();
+
+    if (k == 0)
+    {
+        return;
+    }
+
+    scan(columns.data(), capacity, nullptr, songIDs, 0, songIDs.size(), query, k, result);
+
+    std::sort_heap(result.begin(), result.end(), closer);
+
+    for (Match& match : result)
+    {
+        match.distance = std::sqrt(match.distance);
+    }
+}
+
+void AcousticIndex::buildApproximate(size_t lists, size_t iterations, std::uint64_t seed)
+{
+    size_t n = songIDs.size();
+
+    if (lists == 0)
+    {
+        lists = static_cast<size_t>(std::sqrt(static_cast<double>(n)));
+    }
+
+    lists = std::max<size_t>(1, std::min(lists, n));
+    listCount = 0;
+    indexedSongs = 0;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    std::mt19937_64 rng(seed);
+
+    /*
+     * Training sample, and initial centroids drawn from it.
+     */
+    std::vector<std::uint32_t> sample(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        sample[i] = static_cast<std::uint32_t>(i);
+    }
+
+    std::shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(std::min(n, lists * TRAINING_PER_LIST));
+
+    centroids.assign(ACOUSTIC_DIMENSIONS * lists, 0.0f);
+
+    for (size_t l = 0; l < lists; ++l)
+    {
+        for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+        {
+            centroids[d * lists + l] = columns[d * capacity + sample[l]];
+        }
+    }
+
+    /* Nearest centroid of a song, distances to all centroids summed a column at a time */
+    std::vector<float> distances(lists);
+
+    auto nearestList = [&](size_t position)
+    {
+        std::fill(distances.begin(), distances.end(), 0.0f);
+
+        for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+        {
+            addSquaredDifferences(&centroids[d * lists], columns[d * capacity + position], lists, distances.data());
+        }
+
+        return static_cast<size_t>(std::min_element(distances.begin(), distances.end()) - distances.begin());
+    };
+
+    /*
+     * Lloyd iterations over the sample.
+     */
+    std::vector<double> sums(ACOUSTIC_DIMENSIONS * lists);
+    std::vector<size_t> counts(lists);
+
+    for (size_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for (std::uint32_t position : sample)
+        {
+            size_t l = nearestList(position);
+            ++counts[l];
+
+            for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+            {
+                sums[d * lists + l] += columns[d * capacity + position];
+            }
+        }
+
+        for (size_t l = 0; l < lists; ++l)
+        {
+            /* An empty list restarts at a random song */
+            std::uint32_t restart = sample[rng() % sample.size()];
+
+            for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+            {
+                centroids[d * lists + l] = (counts[l] != 0)
+                    ? static_cast<float>(sums[d * lists + l] / static_cast<double>(counts[l]))
+                    : columns[d * capacity + restart];
+            }
+        }
+    }
+
+    /*
+     * Assign every song, then lay the lists out by counting sort.
+     */
+    std::vector<std::uint32_t> listOf(n);
+    listOffsets.assign(lists + 1, 0);
+
+    for (size_t position = 0; position < n; ++position)
+    {
+        listOf[position] = static_cast<std::uint32_t>(nearestList(position));
+        ++listOffsets[listOf[position] + 1];
+    }
+
+    for (size_t l = 0; l < lists; ++l)
+    {
+        listOffsets[l + 1] += listOffsets[l];
+    }
+
+    std::vector<std::uint32_t> fill(listOffsets.begin(), listOffsets.end() - 1);
+    listSongs.assign(n, 0);
+    listColumns.assign(ACOUSTIC_DIMENSIONS * n, 0.0f);
+
+    for (size_t position = 0; position < n; ++position)
+    {
+        std::uint32_t slot = fill[listOf[position]]++;
+        listSongs[slot] = static_cast<std::uint32_t>(position);
+
+        for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+        {
+            listColumns[d * n + slot] = columns[d * capacity + position];
+        }
+    }
+
+    listCount = lists;
+    indexedSongs = n;
+}
+
+bool AcousticIndex::hasApproximate() const
+{
+    return listCount != 0;
+}
+
+void AcousticIndex::nearestApproximate(const FeatureVector& query, size_t k, std::vector<Match>& result,
+                                       size_t probes) const
+{
+    if (listCount == 0)
+    {
+        nearest(query, k, result);
+        return;
+    }
+
+    result.clear();
+
+    if (k == 0)
+    {
+        return;
+    }
+
+    /*
+     * The probes lists whose centroids are closest to the query.
+     */
+    std::vector<float> distances(listCount, 0.0f);
+
+    for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+    {
+        addSquaredDifferences(&centroids[d * listCount], query[d], listCount, distances.data());
+    }
+
+    std::vector<std::uint32_t> order(listCount);
+
+    for (size_t l = 0; l < listCount; ++l)
+    {
+        order[l] = static_cast<std::uint32_t>(l);
+    }
+
+    probes = std::min(std::max<size_t>(probes, 1), listCount);
+    std::partial_sort(order.begin(), order.begin() + probes, order.end(), [&](std::uint32_t a, std::uint32_t b)
+    {
+        return distances[a] < distances[b];
+    });
+
+    for (size_t p = 0; p < probes; ++p)
+    {
+        scan(listColumns.data(), indexedSongs, listSongs.data(), songIDs,
+             listOffsets[order[p]], listOffsets[order[p] + 1], query, k, result);
+    }
+
+    /* Songs added since the build */
+    scan(columns.data(), capacity, nullptr, songIDs, indexedSongs, songIDs.size(), query, k, result);
+
+    std::sort_heap(result.begin(), result.end(), closer);
+
+    for (Match& match : result)
+    {
+        match.distance = std::sqrt(match.distance);
+    }
+}
+
+bool AcousticIndex::save(const std::string& filePath) const
+{
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    std::uint32_t header[3] = { FILE_MAGIC, FILE_VERSION, static_cast<std::uint32_t>(ACOUSTIC_DIMENSIONS) };
+    std::uint64_t count = songIDs.size();
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    /* Song by song, so the file does not depend on the column capacity */
+    for (size_t position = 0; position < songIDs.size(); ++position)
+    {
+        std::int32_t id = songIDs[position];
+        float row[ACOUSTIC_DIMENSIONS];
+
+        for (size_t d = 0; d < ACOUSTIC_DIMENSIONS; ++d)
+        {
+            row[d] = columns[d * capacity + position];
+        }
+
+        file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+        file.write(reinterpret_cast<const char*>(row), sizeof(row));
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool AcousticIndex::load(const std::string& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    std::uint32_t header[3] = {};
+    std::uint64_t count = 0;
+
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (!file || header[0] != FILE_MAGIC || header[1] != FILE_VERSION || header[2] != ACOUSTIC_DIMENSIONS)
+    {
+        return false;
+    }
+
+    /* A damaged count must not reserve more songs than the file holds */
+    constexpr std::uint64_t RECORD_SIZE = sizeof(std::int32_t) + sizeof(float) * ACOUSTIC_DIMENSIONS;
+
+    std::streamoff recordsStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    file.seekg(recordsStart);
+
+    if (!file || count > static_cast<std::uint64_t>(fileSize - recordsStart) / RECORD_SIZE)
+    {
+        return false;
+    }
+
+    clear();
+    reserveColumns(static_cast<size_t>(count));
+
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        std::int32_t id;
+        FeatureVector features;
+
+        file.read(reinterpret_cast<char*>(&id), sizeof(id));
+        file.read(reinterpret_cast<char*>(features.data()), sizeof(float) * ACOUSTIC_DIMENSIONS);
+
+        if (!file)
+        {
+            clear();
+            return false;
+        }
+
+        add(id, features);
+    }
+
+    return true;
+}
+
+size_t AcousticIndex::memoryUsage() const
+{
+    /* Hash nodes are counted with a rough per-node overhead */
+    return songIDs.capacity() * sizeof(int)
+         + positionOf.size() * (sizeof(int) + sizeof(std::uint32_t) + 16)
+         + (columns.capacity() + centroids.capacity() + listColumns.capacity()) * sizeof(float)
+         + (listOffsets.capacity() + listSongs.capacity()) * sizeof(std::uint32_t);
+}
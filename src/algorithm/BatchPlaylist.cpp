@@ -0,0 +1,148 @@
+#include "BatchPlaylist.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "FeistelPermutation.h"
+
+/* Jobs a worker claims at once; small enough to even out the tail */
+static constexpr size_t BATCH_CHUNK = 16;
+
+/*
+ * Everything one worker reuses from job to job.
+ */
+struct BatchScratch
+{
+    std::unique_ptr<PlaylistGenerator> breadth;
+    std::unique_ptr<PlaylistGenerator> bestFirst;
+    std::unique_ptr<PlaylistGenerator> harmonic;
+
+    /* Generated order of a playlist that is shuffled afterwards */
+    std::vector<std::uint32_t> order;
+};
+
+BatchReport generatePlaylistBatch(
+    const std::vector<PlaylistJob>& jobs,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    WorkStealingPool& pool,
+    std::vector<std::vector<std::uint32_t>>& playlists,
+    const CoPlayIndex* coPlays,
+    const HarmonicIndex* harmonicIndex
+)
+{
+    BatchReport report;
+    report.jobs = jobs.size();
+    report.threads = pool.threadCount();
+
+    playlists.resize(jobs.size());
+
+    std::atomic<size_t> nextJob {0};
+    std::atomic<size_t> failed {0};
+    std::atomic<size_t> songs {0};
+
+    auto started = std::chrono::steady_clock::now();
+
+    auto work = [&]()
+    {
+        BatchScratch scratch;
+        size_t localFailed = 0;
+        size_t localSongs = 0;
+
+        /* First use creates the mode's generator, later ones restart it */
+        auto generatorFor = [&](const PlaylistJob& job, const Song& seed) -> PlaylistGenerator&
+        {
+            std::unique_ptr<PlaylistGenerator>& slot =
+                (job.mode == SmartPlaylistMode::BestFirst) ? scratch.bestFirst
+              : (job.mode == SmartPlaylistMode::Harmonic) ? scratch.harmonic
+              : scratch.breadth;
+
+            if (slot)
+            {
+                slot->restart(seed);
+            }
+            else if (job.mode == SmartPlaylistMode::BestFirst)
+            {
+                slot = std::make_unique<BestFirstGenerator>(seed, library, graph, scorer, coPlays);
+            }
+            else if (job.mode == SmartPlaylistMode::Harmonic)
+            {
+                slot = std::make_unique<HarmonicGenerator>(seed, library, *harmonicIndex);
+            }
+            else
+            {
+                slot = std::make_unique<BreadthFirstGenerator>(seed, library, graph);
+            }
+
+            return *slot;
+        };
+
+        for (size_t first; (first = nextJob.fetch_add(BATCH_CHUNK)) < jobs.size(); )
+        {
+            size_t last = std::min(first + BATCH_CHUNK, jobs.size());
+
+            for (size_t i = first; i < last; ++i)
+            {
+                const PlaylistJob& job = jobs[i];
+                std::vector<std::uint32_t>& playlist = playlists[i];
+                playlist.clear();
+
+                const Song* seed = library.findSongByID(job.seedID);
+
+                if (seed == nullptr || job.size <= 0
+                    || (job.mode == SmartPlaylistMode::Harmonic && harmonicIndex == nullptr))
+                {
+                    ++localFailed;
+                    continue;
+                }
+
+                PlaylistGenerator& generator = generatorFor(job, *seed);
+                size_t size = std::min(static_cast<size_t>(job.size), library.getSongCount());
+
+                /* Shuffled playlists are generated into the scratch buffer first */
+                std::vector<std::uint32_t>& order = (job.shuffleSeed != 0) ? scratch.order : playlist;
+                order.clear();
+                order.reserve(size);
+
+                std::uint32_t song;
+
+                while (order.size() < size && generator.next(song))
+                {
+                    order.push_back(song);
+                }
+
+                if (job.shuffleSeed != 0)
+                {
+                    FeistelPermutation permutation(order.size(), job.shuffleSeed);
+                    playlist.resize(order.size());
+
+                    for (size_t k = 0; k < order.size(); ++k)
+                    {
+                        playlist[k] = order[permutation(k)];
+                    }
+                }
+
+                localSongs += playlist.size();
+            }
+        }
+
+        failed += localFailed;
+        songs += localSongs;
+    };
+
+    /* One long-running task per worker; the counter balances the load */
+    for (size_t t = 0; t < report.threads; ++t)
+    {
+        pool.submit(work);
+    }
+
+    pool.wait();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    report.failed = failed;
+    report.songs = songs;
+    report.jobsPerSecond = (report.seconds > 0.0) ? static_cast<double>(report.jobs) / report.seconds : 0.0;
+
+    return report;
+}
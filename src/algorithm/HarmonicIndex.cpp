@@ -0,0 +1,144 @@
+#include "HarmonicIndex.h"
+#include "SongTags.h"
+
+void HarmonicIndex::build(const MusicLibrary& library, int tolerance)
+{
+    size_t n = library.getSongCount();
+
+    this->tolerance = (tolerance > 0) ? tolerance : 1;
+    bucketCount = static_cast<size_t>(MAX_BPM / this->tolerance) + 1;
+
+    auto indexed = [](const Song& song)
+    {
+        return song.bpm > 0 && song.bpm <= MAX_BPM && song.key.number >= 1 && song.key.number <= 12;
+    };
+
+    /*
+     * Counting sort by tempo first, so that the stable counting sort
+     * into cells leaves every cell slowest first.
+     */
+    std::vector<std::uint32_t> tempoStart(MAX_BPM + 2, 0);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Song& song = library.getSongByIndex(i);
+
+        if (indexed(song))
+        {
+            ++tempoStart[song.bpm + 1];
+        }
+    }
+
+    for (size_t t = 1; t < tempoStart.size(); ++t)
+    {
+        tempoStart[t] += tempoStart[t - 1];
+    }
+
+    std::vector<std::uint32_t> byTempo(tempoStart.back());
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Song& song = library.getSongByIndex(i);
+
+        if (indexed(song))
+        {
+            byTempo[tempoStart[song.bpm]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    offsets.assign(cellCount() + 1, 0);
+
+    for (std::uint32_t i : byTempo)
+    {
+        const Song& song = library.getSongByIndex(i);
+        ++offsets[cellOf(keyIndex(song.key), bucketOf(song.bpm)) + 1];
+    }
+
+    for (size_t c = 1; c < offsets.size(); ++c)
+    {
+        offsets[c] += offsets[c - 1];
+    }
+
+    members.resize(byTempo.size());
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+    for (std::uint32_t i : byTempo)
+    {
+        const Song& song = library.getSongByIndex(i);
+        members[fill[cellOf(keyIndex(song.key), bucketOf(song.bpm))]++] = i;
+    }
+
+    builtVersion = library.getVersion();
+    librarySize = n;
+    built = true;
+}
+
+bool HarmonicIndex::isCurrent(const MusicLibrary& library, int tolerance) const
+{
+    return built && builtVersion == library.getVersion() && this->tolerance == tolerance;
+}
+
+int HarmonicIndex::getTolerance() const
+{
+    return tolerance;
+}
+
+size_t HarmonicIndex::songCount() const
+{
+    return librarySize;
+}
+
+size_t HarmonicIndex::getBucketCount() const
+{
+    return bucketCount;
+}
+
+size_t HarmonicIndex::cellCount() const
+{
+    return KEYS * bucketCount;
+}
+
+size_t HarmonicIndex::keyIndex(const CamelotKey& key)
+{
+    if (key.number < 1 || key.number > 12)
+    {
+        return KEYS;
+    }
+
+    return static_cast<size_t>(key.number - 1) * 2 + (key.major ? 1 : 0);
+}
+
+size_t HarmonicIndex::clockwise(size_t keyIndex)
+{
+    return (keyIndex + 2) % KEYS;
+}
+
+size_t HarmonicIndex::counterClockwise(size_t keyIndex)
+{
+    return (keyIndex + KEYS - 2) % KEYS;
+}
+
+size_t HarmonicIndex::relative(size_t keyIndex)
+{
+    return keyIndex ^ 1;
+}
+
+size_t HarmonicIndex::bucketOf(int bpm) const
+{
+    return static_cast<size_t>(bpm / tolerance);
+}
+
+size_t HarmonicIndex::cellOf(size_t keyIndex, size_t bucket) const
+{
+    return keyIndex * bucketCount + bucket;
+}
+
+const std::uint32_t* HarmonicIndex::cellBegin(size_t cell) const
+{
+    return members.data() + offsets[cell];
+}
+
+const std::uint32_t* HarmonicIndex::cellEnd(size_t cell) const
+{
+    return members.data() + offsets[cell + 1];
+}
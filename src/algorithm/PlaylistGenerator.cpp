@@ -0,0 +1,725 @@
+#include "PlaylistGenerator.h"
+#include <iterator>
+
+/* Sets bit i and returns whether it was set before */
+static bool testAndSet(std::vector<std::uint64_t>& bits, size_t i)
+{
+    std::uint64_t mask = std::uint64_t(1) << (i % 64);
+    bool wasSet = (bits[i / 64] & mask) != 0;
+    bits[i / 64] |= mask;
+    return wasSet;
+}
+
+BreadthFirstGenerator::BreadthFirstGenerator(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const RecentPlays* recent,
+    std::int64_t now
+)
+    : library(library), graph(graph), recent(recent), now(now)
+{
+    restart(startSong);
+}
+
+void BreadthFirstGenerator::restart(const Song& startSong)
+{
+    /*
+     * The last walk set bits only for the songs it queued and the groups
+     * of the songs it expanded, so clearing those is cheaper than a wipe.
+     */
+    for (size_t i = 0; i < head; ++i)
+    {
+        for (std::uint32_t group : { graph.artistGroup(bfsOrder[i]), graph.albumGroup(bfsOrder[i]) })
+        {
+            expandedGroups[group / 64] &= ~(std::uint64_t(1) << (group % 64));
+        }
+    }
+
+    for (std::uint32_t song : bfsOrder)
+    {
+        visitedSongs[song / 64] &= ~(std::uint64_t(1) << (song % 64));
+    }
+
+    bfsOrder.clear();
+    head = 0;
+    groupIndex = 2;
+    cursor = nullptr;
+    end = nullptr;
+    startPending = false;
+
+    /*
+     * Locate the start node; a song outside the library has no neighbors.
+     */
+    const Song* found = library.findSongByID(startSong.id);
+
+    if (found == nullptr || graph.songCount() == 0)
+    {
+        return;
+    }
+
+    songs = &library.getSongByIndex(0);
+    std::uint32_t start = static_cast<std::uint32_t>(found - songs);
+
+    if (visitedSongs.empty())
+    {
+        visitedSongs.assign((graph.songCount() + 63) / 64, 0);
+        expandedGroups.assign((graph.groupCount() + 63) / 64, 0);
+    }
+
+    bfsOrder.push_back(start);
+    testAndSet(visitedSongs, start);
+    startPending = true;
+}
+
+bool BreadthFirstGenerator::next(std::uint32_t& song)
+{
+    if (startPending)
+    {
+        startPending = false;
+        song = bfsOrder[0];
+        return true;
+    }
+
+    while (true)
+    {
+        /*
+         * Continue the group being scanned.
+         */
+        while (cursor != end)
+        {
+            std::uint32_t member = *cursor++;
+
+            if (testAndSet(visitedSongs, member))
+            {
+                continue;
+            }
+
+            bfsOrder.push_back(member);
+
+            /* Recently played songs link artists and albums but are not produced */
+            if (recent == nullptr || !recent->isRecent(songs[member].id, now))
+            {
+                song = member;
+                return true;
+            }
+        }
+
+        /*
+         * Explore the current song by artist, then by album. A group seen
+         * before has had all its songs visited already.
+         */
+        if (groupIndex < 2)
+        {
+            std::uint32_t group = groups[groupIndex++];
+
+            if (!testAndSet(expandedGroups, group))
+            {
+                cursor = graph.groupBegin(group);
+                end = graph.groupEnd(group);
+            }
+
+            continue;
+        }
+
+        if (head == bfsOrder.size())
+        {
+            return false;
+        }
+
+        std::uint32_t current = bfsOrder[head++];
+        groups[0] = graph.artistGroup(current);
+        groups[1] = graph.albumGroup(current);
+        groupIndex = 0;
+    }
+}
+
+size_t BreadthFirstGenerator::memoryUsage() const
+{
+    return (visitedSongs.capacity() + expandedGroups.capacity()) * sizeof(std::uint64_t)
+         + bfsOrder.capacity() * sizeof(std::uint32_t);
+}
+
+BestFirstGenerator::BestFirstGenerator(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    const CoPlayIndex* coPlays,
+    const RecentPlays* recent,
+    std::int64_t now,
+    size_t frontierSize
+)
+    : library(library), graph(graph), scorer(scorer),
+      coPlays(coPlays), recent(recent), now(now), frontierSize(frontierSize)
+{
+    frontier.reserve(frontierSize);
+    restart(startSong);
+}
+
+void BestFirstGenerator::restart(const Song& startSong)
+{
+    /*
+     * Clear only the bits and slots the last run set, as a wipe of
+     * every word would cost O(songs) per playlist.
+     */
+    for (std::uint32_t song : produced)
+    {
+        emitted[song / 64] &= ~(std::uint64_t(1) << (song % 64));
+    }
+
+    for (const Candidate& candidate : frontier)
+    {
+        frontierSlot[candidate.song] = NOT_IN_FRONTIER;
+    }
+
+    for (const GroupState& state : groupStates)
+    {
+        groupSlot[state.group] = NO_GROUP_STATE;
+    }
+
+    produced.clear();
+    frontier.clear();
+    spill.clear();
+    groupStates.clear();
+    openGroups.clear();
+    started = false;
+    valid = false;
+
+    const Song* found = library.findSongByID(startSong.id);
+
+    if (found == nullptr || graph.songCount() == 0 || frontierSize == 0)
+    {
+        return;
+    }
+
+    songs = &library.getSongByIndex(0);
+    current = static_cast<std::uint32_t>(found - songs);
+
+    if (emitted.empty())
+    {
+        emitted.assign((graph.songCount() + 63) / 64, 0);
+        frontierSlot.assign(graph.songCount(), NOT_IN_FRONTIER);
+        groupSlot.assign(graph.groupCount(), NO_GROUP_STATE);
+    }
+
+    valid = true;
+}
+
+bool BestFirstGenerator::isEmitted(std::uint32_t song) const
+{
+    return (emitted[song / 64] >> (song % 64)) & 1;
+}
+
+void BestFirstGenerator::markEmitted(std::uint32_t song)
+{
+    emitted[song / 64] |= std::uint64_t(1) << (song % 64);
+    produced.push_back(song);
+}
+
+/* Slots at depth 0, 2, 4, ... of the frontier heap; the rest are at odd depths */
+static bool onBestLevel(size_t slot)
+{
+    bool best = true;
+
+    for (size_t i = slot + 1; i > 1; i /= 2)
+    {
+        best = !best;
+    }
+
+    return best;
+}
+
+void BestFirstGenerator::place(size_t slot, const Candidate& candidate)
+{
+    frontier[slot] = candidate;
+    frontierSlot[candidate.song] = static_cast<std::uint32_t>(slot);
+}
+
+void BestFirstGenerator::swapSlots(size_t a, size_t b)
+{
+    Candidate held = frontier[a];
+    place(a, frontier[b]);
+    place(b, held);
+}
+
+/* Whether slot a belongs above slot b on a best (or, if not best, a worst) level */
+bool BestFirstGenerator::ranksBefore(size_t a, size_t b, bool best) const
+{
+    return best ? frontier[a] < frontier[b] : frontier[b] < frontier[a];
+}
+
+void BestFirstGenerator::siftUp(size_t slot)
+{
+    if (slot == 0)
+    {
+        return;
+    }
+
+    bool best = onBestLevel(slot);
+    size_t parent = (slot - 1) / 2;
+
+    /* The parent bounds the entry from the other side; past it, the entry changes kind of level */
+    if (ranksBefore(parent, slot, best))
+    {
+        swapSlots(slot, parent);
+        slot = parent;
+        best = !best;
+    }
+
+    /* Then up through the grandparents on the same kind of level */
+    while (slot > 2)
+    {
+        size_t grandparent = ((slot - 1) / 2 - 1) / 2;
+
+        if (!ranksBefore(slot, grandparent, best))
+        {
+            break;
+        }
+
+        swapSlots(slot, grandparent);
+        slot = grandparent;
+    }
+}
+
+void BestFirstGenerator::siftDown(size_t slot)
+{
+    bool best = onBestLevel(slot);
+    size_t count = frontier.size();
+
+    while (true)
+    {
+        size_t first = 2 * slot + 1;
+
+        if (first >= count)
+        {
+            return;
+        }
+
+        /* The entry that ranks first among the children and grandchildren */
+        size_t below[6] = { first, first + 1, 2 * first + 1, 2 * first + 2, 2 * first + 3, 2 * first + 4 };
+        size_t leader = first;
+
+        for (size_t candidate : below)
+        {
+            if (candidate < count && ranksBefore(candidate, leader, best))
+            {
+                leader = candidate;
+            }
+        }
+
+        if (!ranksBefore(leader, slot, best))
+        {
+            return;
+        }
+
+        swapSlots(slot, leader);
+
+        if (leader <= first + 1)
+        {
+            return;
+        }
+
+        /* A grandchild moved down must still sit on the right side of its parent */
+        size_t parent = (leader - 1) / 2;
+
+        if (ranksBefore(parent, leader, best))
+        {
+            swapSlots(parent, leader);
+        }
+
+        slot = leader;
+    }
+}
+
+void BestFirstGenerator::repair(size_t slot)
+{
+    /* Whatever ends up in slot after moving up is then moved down */
+    siftUp(slot);
+    siftDown(slot);
+}
+
+void BestFirstGenerator::insertFrontier(const Candidate& candidate)
+{
+    frontier.push_back(candidate);
+    frontierSlot[candidate.song] = static_cast<std::uint32_t>(frontier.size() - 1);
+    siftUp(frontier.size() - 1);
+}
+
+void BestFirstGenerator::eraseAt(size_t slot)
+{
+    frontierSlot[frontier[slot].song] = NOT_IN_FRONTIER;
+
+    Candidate last = frontier.back();
+    frontier.pop_back();
+
+    if (slot == frontier.size())
+    {
+        return;
+    }
+
+    /* Refill the hole with the last entry and restore heap order */
+    place(slot, last);
+    repair(slot);
+}
+
+size_t BestFirstGenerator::worstSlot() const
+{
+    if (frontier.size() <= 2)
+    {
+        return frontier.size() - 1;
+    }
+
+    return (frontier[1] < frontier[2]) ? 2 : 1;
+}
+
+void BestFirstGenerator::consider(std::uint32_t candidate, std::uint32_t anchor)
+{
+    if (isEmitted(candidate))
+    {
+        return;
+    }
+
+    const Song& song = songs[candidate];
+
+    if (recent != nullptr && recent->isRecent(song.id, now))
+    {
+        return;
+    }
+
+    double score = scorer.score(songs[anchor], song);
+    std::uint32_t slot = frontierSlot[candidate];
+
+    if (slot != NOT_IN_FRONTIER)
+    {
+        /* Keep the best score any emitted song gave it */
+        if (score > frontier[slot].score)
+        {
+            frontier[slot].score = score;
+            repair(slot);
+        }
+
+        return;
+    }
+
+    if (frontier.size() >= frontierSize)
+    {
+        size_t worst = worstSlot();
+
+        if (!(Candidate { score, candidate } < frontier[worst]))
+        {
+            spill.push_back(candidate);
+            return;
+        }
+
+        spill.push_back(frontier[worst].song);
+        eraseAt(worst);
+    }
+
+    insertFrontier({ score, candidate });
+}
+
+void BestFirstGenerator::readGroup(std::uint32_t group, std::uint32_t anchor)
+{
+    if (groupSlot[group] == NO_GROUP_STATE)
+    {
+        groupSlot[group] = static_cast<std::uint32_t>(groupStates.size());
+        groupStates.push_back({ group, graph.groupBegin(group), anchor });
+        openGroups.push_back(group);
+    }
+
+    GroupState& state = groupStates[groupSlot[group]];
+    const std::uint32_t* end = graph.groupEnd(group);
+    state.anchor = anchor;
+
+    for (size_t taken = 0; state.cursor != end && taken < frontierSize; ++taken)
+    {
+        consider(*state.cursor++, anchor);
+    }
+}
+
+bool BestFirstGenerator::next(std::uint32_t& song)
+{
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (!started)
+    {
+        started = true;
+        markEmitted(current);
+        song = current;
+        return true;
+    }
+
+    /*
+     * Expand: a bounded slice of each group, then co-play partners.
+     */
+    readGroup(graph.artistGroup(current), current);
+    readGroup(graph.albumGroup(current), current);
+
+    if (coPlays != nullptr)
+    {
+        for (const CoPlayIndex::Neighbour& neighbour : coPlays->neighboursOf(songs[current].id))
+        {
+            const Song* partner = library.findSongByID(neighbour.songID);
+
+            if (partner != nullptr)
+            {
+                consider(static_cast<std::uint32_t>(partner - songs), current);
+            }
+        }
+    }
+
+    /*
+     * Refill a dry frontier from groups with unread songs, most
+     * recently opened first, and then from the spill.
+     */
+    while (frontier.empty() && !openGroups.empty())
+    {
+        std::uint32_t group = openGroups.back();
+        GroupState& state = groupStates[groupSlot[group]];
+
+        if (state.cursor == graph.groupEnd(group))
+        {
+            openGroups.pop_back();
+            continue;
+        }
+
+        readGroup(group, state.anchor);
+    }
+
+    while (frontier.size() < frontierSize && !spill.empty() && openGroups.empty())
+    {
+        std::uint32_t candidate = spill.back();
+        spill.pop_back();
+        consider(candidate, current);
+    }
+
+    if (frontier.empty())
+    {
+        valid = false;
+        return false;
+    }
+
+    /*
+     * Produce the best candidate and expand from it next time.
+     */
+    Candidate best = frontier.front();
+    eraseAt(0);
+
+    current = best.song;
+    markEmitted(current);
+    song = current;
+    return true;
+}
+
+size_t BestFirstGenerator::memoryUsage() const
+{
+    return emitted.capacity() * sizeof(std::uint64_t)
+         + frontier.capacity() * sizeof(Candidate)
+         + (frontierSlot.capacity() + produced.capacity() + spill.capacity()
+            + openGroups.capacity() + groupSlot.capacity()) * sizeof(std::uint32_t)
+         + groupStates.capacity() * sizeof(GroupState);
+}
+
+HarmonicGenerator::HarmonicGenerator(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const HarmonicIndex& index,
+    size_t songsPerKey,
+    const RecentPlays* recent,
+    std::int64_t now
+)
+    : library(library), index(index), recent(recent), now(now), songsPerKey(songsPerKey)
+{
+    restart(startSong);
+}
+
+void HarmonicGenerator::restart(const Song& startSong)
+{
+    run = 0;
+    started = false;
+    valid = false;
+
+    const Song* found = library.findSongByID(startSong.id);
+
+    if (found == nullptr || index.songCount() == 0)
+    {
+        return;
+    }
+
+    current = static_cast<std::uint32_t>(found - &library.getSongByIndex(0));
+    used.assign((index.songCount() + 63) / 64, 0);
+
+    low.resize(index.cellCount());
+    high.resize(index.cellCount());
+
+    for (size_t cell = 0; cell < index.cellCount(); ++cell)
+    {
+        low[cell] = index.cellBegin(cell);
+        high[cell] = index.cellEnd(cell);
+    }
+
+    valid = true;
+}
+
+bool HarmonicGenerator::isUsed(std::uint32_t song) const
+{
+    return (used[song / 64] >> (song % 64)) & 1;
+}
+
+void HarmonicGenerator::markUsed(std::uint32_t song)
+{
+    used[song / 64] |= std::uint64_t(1) << (song % 64);
+}
+
+bool HarmonicGenerator::facingEnd(size_t cell, int bucketStep, int bpm, std::uint32_t& song)
+{
+    const std::uint32_t*& begin = low[cell];
+    const std::uint32_t*& end = high[cell];
+
+    auto skip = [&](std::uint32_t candidate)
+    {
+        if (isUsed(candidate))
+        {
+            return true;
+        }
+
+        /* Recent songs are dropped for good, like played ones */
+        if (recent != nullptr && recent->isRecent(library.getSongByIndex(candidate).id, now))
+        {
+            markUsed(candidate);
+            return true;
+        }
+
+        return false;
+    };
+
+    while (begin != end && skip(*begin))
+    {
+        ++begin;
+    }
+
+    while (begin != end && skip(*(end - 1)))
+    {
+        --end;
+    }
+
+    if (begin == end)
+    {
+        return false;
+    }
+
+    if (bucketStep < 0)
+    {
+        song = *(end - 1);
+    }
+    else if (bucketStep > 0)
+    {
+        song = *begin;
+    }
+    else
+    {
+        /* Own bucket: whichever end is nearer */
+        int slowGap = bpm - library.getSongByIndex(*begin).bpm;
+        int fastGap = library.getSongByIndex(*(end - 1)).bpm - bpm;
+        song = (slowGap <= fastGap) ? *begin : *(end - 1);
+    }
+
+    return true;
+}
+
+bool HarmonicGenerator::next(std::uint32_t& song)
+{
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (!started)
+    {
+        started = true;
+        markUsed(current);
+        run = 1;
+        song = current;
+        return true;
+    }
+
+    const Song& from = library.getSongByIndex(current);
+    size_t key = HarmonicIndex::keyIndex(from.key);
+
+    if (key == HarmonicIndex::KEYS || from.bpm <= 0 || index.bucketOf(from.bpm) >= index.getBucketCount())
+    {
+        valid = false;
+        return false;
+    }
+
+    /* Preference order on ties: stay, clockwise, relative, back */
+    size_t keys[] = { key, HarmonicIndex::clockwise(key), HarmonicIndex::relative(key),
+                      HarmonicIndex::counterClockwise(key) };
+    size_t bucket = index.bucketOf(from.bpm);
+
+    bool found = false;
+    std::uint32_t best = 0;
+    int bestGap = 0;
+
+    /* The second pass stays in key only if nothing else fits */
+    for (int pass = 0; pass < 2 && !found; ++pass)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            bool sameKey = (k == 0);
+            bool keyFull = run >= songsPerKey;
+
+            if ((pass == 0 && sameKey && keyFull) || (pass == 1 && !(sameKey && keyFull)))
+            {
+                continue;
+            }
+
+            for (int step = -1; step <= 1; ++step)
+            {
+                if ((step < 0 && bucket == 0) || (step > 0 && bucket + 1 >= index.getBucketCount()))
+                {
+                    continue;
+                }
+
+                std::uint32_t candidate;
+
+                if (!facingEnd(index.cellOf(keys[k], bucket + step), step, from.bpm, candidate))
+                {
+                    continue;
+                }
+
+                int gap = library.getSongByIndex(candidate).bpm - from.bpm;
+                gap = (gap < 0) ? -gap : gap;
+
+                if (gap <= index.getTolerance() && (!found || gap < bestGap))
+                {
+                    found = true;
+                    best = candidate;
+                    bestGap = gap;
+                }
+            }
+        }
+    }
+
+    if (!found)
+    {
+        valid = false;
+        return false;
+    }
+
+    run = (HarmonicIndex::keyIndex(library.getSongByIndex(best).key) == key) ? run + 1 : 1;
+    current = best;
+    markUsed(current);
+    song = current;
+    return true;
+}
+
+size_t HarmonicGenerator::memoryUsage() const
+{
+    return used.capacity() * sizeof(std::uint64_t)
+         + (low.capacity() + high.capacity()) * sizeof(const std::uint32_t*);
+}
@@ -0,0 +1,96 @@
+#include "SimilarityGraph.h"
+#include <string>
+#include <unordered_map>
+
+/* Numbers the distinct values of a field in order of first appearance */
+template <typename KeyOf>
+static std::uint32_t numberGroups(const MusicLibrary& library, KeyOf keyOf, std::vector<std::uint32_t>& groupOf)
+{
+    std::unordered_map<std::string, std::uint32_t> numbers;
+    numbers.reserve(library.getSongCount() / 4 + 1);
+
+    groupOf.resize(library.getSongCount());
+
+    for (size_t i = 0; i < library.getSongCount(); ++i)
+    {
+        auto inserted = numbers.emplace(keyOf(library.getSongByIndex(i)), static_cast<std::uint32_t>(numbers.size()));
+        groupOf[i] = inserted.first->second;
+    }
+
+    return static_cast<std::uint32_t>(numbers.size());
+}
+
+void SimilarityGraph::build(const MusicLibrary& library)
+{
+    size_t n = library.getSongCount();
+
+    std::uint32_t artists = numberGroups(library, [](const Song& song) -> const std::string& { return song.artist; }, artistOf);
+    std::uint32_t albums = numberGroups(library, [](const Song& song) -> const std::string& { return song.album; }, albumOf);
+
+    /* Album groups follow the artist groups */
+    for (std::uint32_t& group : albumOf)
+    {
+        group += artists;
+    }
+
+    /* Counting sort of songs into their groups keeps library order */
+    offsets.assign(static_cast<size_t>(artists) + albums + 1, 0);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        ++offsets[artistOf[i] + 1];
+        ++offsets[albumOf[i] + 1];
+    }
+
+    for (size_t g = 1; g < offsets.size(); ++g)
+    {
+        offsets[g] += offsets[g - 1];
+    }
+
+    members.resize(2 * n);
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        members[fill[artistOf[i]]++] = static_cast<std::uint32_t>(i);
+        members[fill[albumOf[i]]++] = static_cast<std::uint32_t>(i);
+    }
+
+    builtVersion = library.getVersion();
+    built = true;
+}
+
+bool SimilarityGraph::isCurrent(const MusicLibrary& library) const
+{
+    return built && builtVersion == library.getVersion();
+}
+
+size_t SimilarityGraph::songCount() const
+{
+    return artistOf.size();
+}
+
+size_t SimilarityGraph::groupCount() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+std::uint32_t SimilarityGraph::artistGroup(size_t song) const
+{
+    return artistOf[song];
+}
+
+std::uint32_t SimilarityGraph::albumGroup(size_t song) const
+{
+    return albumOf[song];
+}
+
+const std::uint32_t* SimilarityGraph::groupBegin(std::uint32_t group) const
+{
+    return members.data() + offsets[group];
+}
+
+const std::uint32_t* SimilarityGraph::groupEnd(std::uint32_t group) const
+{
+    return members.data() + offsets[group + 1];
+}
@@ -1,80 +1,345 @@
 #include "SmartPlaylist.h"
-#include <queue>
-#include <set>
+#include <atomic>
+#include <cmath>
+#include <memory>
 
 /*
  * Generates a smart playlist based on artist and album similarity.
  */
+PlaybackQueue generateSmartPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    int maxSize,
+    const RecentPlays* recent,
+    std::int64_t now
+)
+{
+    PlaybackQueue resultQueue;
+    size_t limit = (maxSize > 0) ? static_cast<size_t>(maxSize) : 0;
+
+    resultQueue.addSong(startSong);
+
+    BreadthFirstGenerator generator(startSong, library, graph, recent, now);
+    std::uint32_t song;
+
+    /* The first song produced is the start song itself */
+    generator.next(song);
+
+    while (resultQueue.size() < limit && generator.next(song))
+    {
+        resultQueue.addSong(library.getSongByIndex(song));
+    }
+
+    return resultQueue;
+}
+
 PlaybackQueue generateSmartPlaylist(
     Song& startSong,
     MusicLibrary& library,
-    int maxSize
+    int maxSize,
+    const RecentPlays* recent,
+    std::int64_t now
+)
+{
+    SimilarityGraph graph;
+    graph.build(library);
+
+    return generateSmartPlaylist(startSong, library, graph, maxSize, recent, now);
+}
+
+PlaybackQueue generateScoredPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    int maxSize,
+    const CoPlayIndex* coPlays,
+    const RecentPlays* recent,
+    std::int64_t now,
+    size_t frontierSize
 )
 {
     PlaybackQueue resultQueue;
+    size_t limit = (maxSize > 0) ? static_cast<size_t>(maxSize) : 0;
 
-    /*
-     * Queue used for BFS traversal.
-     */
-    std::queue<const Song*> bfsQueue;
+    resultQueue.addSong(startSong);
+
+    BestFirstGenerator generator(startSong, library, graph, scorer, coPlays, recent, now, frontierSize);
+    std::uint32_t song;
+
+    /* The first song produced is the start song itself */
+    generator.next(song);
+
+    while (resultQueue.size() < limit && generator.next(song))
+    {
+        resultQueue.addSong(library.getSongByIndex(song));
+    }
+
+    return resultQueue;
+}
+
+PlaybackQueue generateHarmonicPlaylist(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const HarmonicIndex& index,
+    int maxSize,
+    size_t songsPerKey,
+    const RecentPlays* recent,
+    std::int64_t now
+)
+{
+    PlaybackQueue resultQueue;
+    size_t limit = (maxSize > 0) ? static_cast<size_t>(maxSize) : 0;
+
+    resultQueue.addSong(startSong);
+
+    HarmonicGenerator generator(startSong, library, index, songsPerKey, recent, now);
+    std::uint32_t song;
+
+    /* The first song produced is the start song itself */
+    generator.next(song);
+
+    while (resultQueue.size() < limit && generator.next(song))
+    {
+        resultQueue.addSong(library.getSongByIndex(song));
+    }
+
+    return resultQueue;
+}
+
+/*
+ * Resumable BFS of one seed in a multi-seed playlist.
+ */
+struct SeedExpansion
+{
+    double weight;
+
+    /* Songs this seed claimed, in BFS order */
+    std::vector<std::uint32_t> claimed;
+
+    /* Stop once claimed reaches quota */
+    size_t quota = 0;
+
+    /* Groups to scan in BFS order, and this seed's expanded-group bitset */
+    std::vector<std::uint32_t> groupQueue;
+    std::vector<std::uint64_t> queuedGroups;
+    size_t groupHead = 0;
+    const std::uint32_t* cursor = nullptr;
+
+    bool exhausted = false;
+};
+
+/* Marks both groups of a song for scanning, unless queued before */
+static void queueGroupsOf(SeedExpansion& seed, const SimilarityGraph& graph, std::uint32_t song)
+{
+    std::uint32_t groups[] = { graph.artistGroup(song), graph.albumGroup(song) };
+
+    for (std::uint32_t group : groups)
+    {
+        std::uint64_t mask = std::uint64_t(1) << (group % 64);
+
+        if ((seed.queuedGroups[group / 64] & mask) == 0)
+        {
+            seed.queuedGroups[group / 64] |= mask;
+            seed.groupQueue.push_back(group);
+        }
+    }
+}
+
+/* Scans groups until the seed's quota is met or its component runs out */
+static void expandSeed(SeedExpansion& seed, const SimilarityGraph& graph, const Song* songs,
+                       std::atomic<std::uint64_t>* claimedBits,
+                       const RecentPlays* recent, std::int64_t now)
+{
+    while (seed.claimed.size() < seed.quota)
+    {
+        if (seed.groupHead == seed.groupQueue.size())
+        {
+            seed.exhausted = true;
+            return;
+        }
+
+        std::uint32_t group = seed.groupQueue[seed.groupHead];
+        const std::uint32_t* end = graph.groupEnd(group);
+
+        if (seed.cursor == nullptr)
+        {
+            seed.cursor = graph.groupBegin(group);
+        }
+
+        while (seed.cursor != end && seed.claimed.size() < seed.quota)
+        {
+            std::uint32_t song = *seed.cursor++;
+
+            /* Songs claimed elsewhere or recently played still link groups */
+            queueGroupsOf(seed, graph, song);
+
+            if (recent != nullptr && recent->isRecent(songs[song].id, now))
+            {
+                continue;
+            }
+
+            std::uint64_t mask = std::uint64_t(1) << (song % 64);
+
+            if ((claimedBits[song / 64].fetch_or(mask, std::memory_order_relaxed) & mask) == 0)
+            {
+                seed.claimed.push_back(song);
+            }
+        }
+
+        if (seed.cursor == end)
+        {
+            ++seed.groupHead;
+            seed.cursor = nullptr;
+        }
+    }
+}
+
+PlaybackQueue generateMultiSeedPlaylist(
+    const std::vector<PlaylistSeed>& seeds,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    int maxSize,
+    WorkStealingPool& pool,
+    const RecentPlays* recent,
+    std::int64_t now,
+    bool includeSeeds
+)
+{
+    PlaybackQueue resultQueue;
+    size_t limit = (maxSize > 0) ? static_cast<size_t>(maxSize) : 0;
+
+    if (graph.songCount() == 0 || limit == 0)
+    {
+        return resultQueue;
+    }
+
+    const Song* songs = &library.getSongByIndex(0);
 
     /*
-     * Set to track songs already added to playlist.
+     * Shared claim bitset; one bit per song.
      */
-    std::set<int> visitedSongIDs;
+    size_t words = (graph.songCount() + 63) / 64;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> claimedBits(new std::atomic<std::uint64_t>[words]);
+
+    for (size_t w = 0; w < words; ++w)
+    {
+        claimedBits[w].store(0, std::memory_order_relaxed);
+    }
 
     /*
-     * Initialize BFS with the starting song.
+     * Seeds claim their own start songs before any expansion runs, so no
+     * other seed adds them even when they are left out of the result.
      */
-    bfsQueue.push(&startSong);
-    visitedSongIDs.insert(startSong.id);
-    resultQueue.addSong(startSong);
+    std::vector<SeedExpansion> expansions;
+    expansions.reserve(seeds.size());
+
+    size_t totalClaimed = 0;
+
+    for (const PlaylistSeed& seed : seeds)
+    {
+        const Song* found = (seed.song != nullptr) ? library.findSongByID(seed.song->id) : nullptr;
+
+        if (found == nullptr || !(seed.weight > 0.0))
+        {
+            continue;
+        }
+
+        std::uint32_t start = static_cast<std::uint32_t>(found - songs);
+
+        expansions.emplace_back();
+        SeedExpansion& expansion = expansions.back();
+        expansion.weight = seed.weight;
+        expansion.queuedGroups.assign((graph.groupCount() + 63) / 64, 0);
+
+        std::uint64_t mask = std::uint64_t(1) << (start % 64);
+
+        if ((claimedBits[start / 64].fetch_or(mask) & mask) == 0 && includeSeeds)
+        {
+            expansion.claimed.push_back(start);
+            ++totalClaimed;
+        }
+
+        queueGroupsOf(expansion, graph, start);
+    }
 
     /*
-     * Perform BFS until playlist reaches max size.
+     * Rounds: split what is still missing among the seeds that can grow,
+     * by weight, and expand each as one pool task; the round ends when
+     * all of them are done.
      */
-    while (!bfsQueue.empty() && visitedSongIDs.size() < static_cast<size_t>(maxSize))
+    while (totalClaimed < limit)
     {
-        const Song* currentSong = bfsQueue.front();
-        bfsQueue.pop();
+        double activeWeight = 0.0;
 
-        /*
-         * Explore neighbors by artist.
-         */
-        auto artistNeighbors = library.findSongsByArtist(currentSong->artist);
-
-        for (const Song* neighbor : artistNeighbors)
+        for (const SeedExpansion& expansion : expansions)
         {
-            if (visitedSongIDs.size() >= static_cast<size_t>(maxSize))
+            if (!expansion.exhausted)
             {
-                break;
+                activeWeight += expansion.weight;
             }
+        }
 
-            if (visitedSongIDs.insert(neighbor->id).second)
-            {
-                resultQueue.addSong(*neighbor);
-                bfsQueue.push(neighbor);
-            }
+        if (activeWeight == 0.0)
+        {
+            break;
         }
 
-        /*
-         * Explore neighbors by album.
-         */
-        auto albumNeighbors = library.findSongsByAlbum(currentSong->album);
+        size_t missing = limit - totalClaimed;
 
-        for (const Song* neighbor : albumNeighbors)
+        for (SeedExpansion& expansion : expansions)
         {
-            if (visitedSongIDs.size() >= static_cast<size_t>(maxSize))
+            if (expansion.exhausted)
             {
-                break;
+                continue;
             }
 
-            if (visitedSongIDs.insert(neighbor->id).second)
+            double share = std::ceil(static_cast<double>(missing) * expansion.weight / activeWeight);
+            expansion.quota = expansion.claimed.size() + static_cast<size_t>(share);
+
+            pool.submit([&expansion, &graph, songs, &claimedBits, recent, now]
+            {
+                expandSeed(expansion, graph, songs, claimedBits.get(), recent, now);
+            });
+        }
+
+        pool.wait();
+
+        totalClaimed = 0;
+
+        for (const SeedExpansion& expansion : expansions)
+        {
+            totalClaimed += expansion.claimed.size();
+        }
+    }
+
+    /*
+     * Interleave by stride scheduling: the seed with the smallest pass
+     * goes next and then advances its pass by 1 / weight.
+     */
+    std::vector<double> pass(expansions.size(), 0.0);
+    std::vector<size_t> next(expansions.size(), 0);
+
+    while (resultQueue.size() < limit)
+    {
+        size_t best = expansions.size();
+
+        for (size_t i = 0; i < expansions.size(); ++i)
+        {
+            if (next[i] < expansions[i].claimed.size() && (best == expansions.size() || pass[i] < pass[best]))
             {
-                resultQueue.addSong(*neighbor);
-                bfsQueue.push(neighbor);
+                best = i;
             }
         }
+
+        if (best == expansions.size())
+        {
+            break;
+        }
+
+        resultQueue.addSong(songs[expansions[best].claimed[next[best]++]]);
+        pass[best] += 1.0 / expansions[best].weight;
     }
 
     return resultQueue;
@@ -0,0 +1,280 @@
+#include "SmartPlaylistCache.h"
+#include <algorithm>
+
+bool SmartPlaylistCache::Key::operator==(const Key& other) const
+{
+    return parameters == other.parameters
+        && libraryVersion == other.libraryVersion
+        && seeds == other.seeds;
+}
+
+size_t SmartPlaylistCache::KeyHash::operator()(const Key& key) const
+{
+    /* 64-bit FNV-1a style mixing of every field */
+    std::uint64_t hash = 14695981039346656037ull;
+
+    auto mix = [&hash](std::uint64_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    mix(key.parameters);
+    mix(key.libraryVersion);
+
+    for (const std::pair<int, double>& seed : key.seeds)
+    {
+        mix(static_cast<std::uint64_t>(static_cast<std::uint32_t>(seed.first)));
+        mix(std::hash<double>()(seed.second));
+    }
+
+    return static_cast<size_t>(hash);
+}
+
+SmartPlaylistCache::SmartPlaylistCache(size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+{
+}
+
+SmartPlaylistCache::Entry& SmartPlaylistCache::touch(const Key& key, bool& found)
+{
+    /* Entries of another library version can never be hit again */
+    if (key.libraryVersion != libraryVersion)
+    {
+        clear();
+        libraryVersion = key.libraryVersion;
+    }
+
+    auto known = index.find(key);
+    found = known != index.end();
+
+    if (found)
+    {
+        entries.splice(entries.begin(), entries, known->second);
+        return entries.front();
+    }
+
+    entries.emplace_front();
+    entries.front().key = key;
+    index.emplace(key, entries.begin());
+
+    return entries.front();
+}
+
+void SmartPlaylistCache::serve(const Entry& entry, size_t& scanned, size_t count,
+                               const Accept& accept, std::vector<std::uint32_t>& result)
+{
+    for (; scanned < entry.songs.size() && result.size() < count; ++scanned)
+    {
+        std::uint32_t song = entry.songs[scanned];
+
+        if (!accept || accept(song))
+        {
+            result.push_back(song);
+        }
+    }
+}
+
+void SmartPlaylistCache::account(Entry& entry)
+{
+    memoryUsed -= entry.bytes;
+
+    entry.bytes = sizeof(Entry)
+                + entry.key.seeds.capacity() * sizeof(std::pair<int, double>)
+                + entry.songs.capacity() * sizeof(std::uint32_t)
+                + (entry.generator ? entry.generator->memoryUsage() : 0);
+
+    memoryUsed += entry.bytes;
+
+    /* Least recently used first; the entry just served goes last */
+    while (memoryUsed > memoryBudget && &entries.back() != &entry)
+    {
+        memoryUsed -= entries.back().bytes;
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    if (memoryUsed <= memoryBudget)
+    {
+        return;
+    }
+
+    /* Alone and still too big: give up resuming it, then caching it */
+    if (entry.generator)
+    {
+        entry.generator.reset();
+        account(entry);
+        return;
+    }
+
+    memoryUsed -= entry.bytes;
+    index.erase(entry.key);
+    entries.pop_front();
+}
+
+bool SmartPlaylistCache::fetch(const Key& key, size_t count, const Accept& accept,
+                               const MakeGenerator& makeGenerator, std::vector<std::uint32_t>& result,
+                               std::uint64_t inputVersion)
+{
+    bool found;
+    Entry& entry = touch(key, found);
+
+    if (!found)
+    {
+        entry.inputVersion = inputVersion;
+    }
+
+    result.clear();
+    result.reserve(count);
+
+    size_t scanned = 0;
+    serve(entry, scanned, count, accept, result);
+
+    if (found && (result.size() >= count || entry.complete))
+    {
+        return true;
+    }
+
+    /*
+     * An entry that lost its generator to the budget starts a new one
+     * and skips what is cached; generators are deterministic, but only
+     * over the same input. Otherwise the new one would not reproduce
+     * the cached songs, so they are generated again.
+     */
+    std::uint32_t song;
+
+    if (!entry.generator && !entry.complete)
+    {
+        if (entry.inputVersion != inputVersion)
+        {
+            entry.songs.clear();
+            entry.inputVersion = inputVersion;
+            result.clear();
+        }
+
+        entry.generator = makeGenerator();
+
+        for (size_t skipped = 0; skipped < entry.songs.size(); ++skipped)
+        {
+            entry.generator->next(song);
+        }
+    }
+
+    while (result.size() < count && !entry.complete)
+    {
+        if (!entry.generator->next(song))
+        {
+            entry.complete = true;
+            entry.generator.reset();
+            break;
+        }
+
+        entry.songs.push_back(song);
+
+        if (!accept || accept(song))
+        {
+            result.push_back(song);
+        }
+    }
+
+    account(entry);
+    return false;
+}
+
+bool SmartPlaylistCache::fetchWhole(const Key& key, size_t count, const Accept& accept,
+                                    const Generate& generate, std::vector<std::uint32_t>& result)
+{
+    size_t length;
+
+    if (lookupWhole(key, count, accept, result, length))
+    {
+        return true;
+    }
+
+    while (!storeWhole(key, count, accept, generate(length), length, result))
+    {
+        length *= 2;
+    }
+
+    return false;
+}
+
+bool SmartPlaylistCache::lookupWhole(const Key& key, size_t count, const Accept& accept,
+                                     std::vector<std::uint32_t>& result, size_t& length)
+{
+    if (key.libraryVersion != libraryVersion)
+    {
+        clear();
+        libraryVersion = key.libraryVersion;
+    }
+
+    result.clear();
+    length = count;
+
+    auto known = index.find(key);
+
+    if (known == index.end())
+    {
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, known->second);
+    Entry& entry = entries.front();
+
+    result.reserve(count);
+
+    size_t scanned = 0;
+    serve(entry, scanned, count, accept, result);
+
+    if (result.size() >= count || entry.complete)
+    {
+        return true;
+    }
+
+    /*
+     * Regenerate at least twice as long as before, so a sequence of
+     * growing requests costs O(final length) in total.
+     */
+    length = std::max(count, entry.songs.size() * 2);
+    return false;
+}
+
+bool SmartPlaylistCache::storeWhole(const Key& key, size_t count, const Accept& accept,
+                                    std::vector<std::uint32_t> songs, size_t length,
+                                    std::vector<std::uint32_t>& result)
+{
+    bool found;
+    Entry& entry = touch(key, found);
+
+    entry.songs = std::move(songs);
+    entry.complete = entry.songs.size() < length;
+
+    result.clear();
+    result.reserve(count);
+
+    size_t scanned = 0;
+    serve(entry, scanned, count, accept, result);
+
+    /* Decided before account(), which may evict the entry */
+    bool done = result.size() >= count || entry.complete;
+
+    account(entry);
+    return done;
+}
+
+void SmartPlaylistCache::clear()
+{
+    entries.clear();
+    index.clear();
+    memoryUsed = 0;
+}
+
+size_t SmartPlaylistCache::size() const
+{
+    return entries.size();
+}
+
+size_t SmartPlaylistCache::memoryUsage() const
+{
+    return memoryUsed;
+}
@@ -0,0 +1,222 @@
+#include "SmartRadio.h"
+#include <algorithm>
+#include <chrono>
+
+/* Random picks per sample before giving up on finding allowed songs */
+static constexpr size_t PROBES_PER_SAMPLE = 4;
+
+SmartRadio::SmartRadio(
+    const Song& startSong,
+    const MusicLibrary& library,
+    const SimilarityGraph& graph,
+    const SongScorer& scorer,
+    const CoPlayIndex* coPlays,
+    const RecentPlays* recent,
+    std::uint64_t seed,
+    size_t windowSize
+)
+    : library(library), graph(graph), scorer(scorer), coPlays(coPlays), recent(recent), rng(seed),
+      windowSize(windowSize)
+{
+    restart(startSong);
+}
+
+void SmartRadio::restart(const Song& startSong)
+{
+    inWindow.clear();
+    windowHead = 0;
+    windowFill = 0;
+    buffer.clear();
+    valid = false;
+
+    const Song* found = library.findSongByID(startSong.id);
+
+    if (found == nullptr || graph.songCount() == 0)
+    {
+        return;
+    }
+
+    /* Leave at least half the library allowed, so sampling stays cheap */
+    window.assign(std::min(windowSize, graph.songCount() / 2), 0);
+    inWindow.reserve(window.size() * 2);
+    candidates.reserve(3 * SAMPLES);
+
+    current = static_cast<std::uint32_t>(found - &library.getSongByIndex(0));
+    remember(current);
+    valid = true;
+
+    for (size_t i = 0; i < PREFETCH; ++i)
+    {
+        step();
+    }
+}
+
+bool SmartRadio::isAllowed(std::uint32_t song, std::int64_t now) const
+{
+    if (inWindow.count(song) != 0)
+    {
+        return false;
+    }
+
+    return recent == nullptr || !recent->isRecent(library.getSongByIndex(song).id, now);
+}
+
+void SmartRadio::sampleGroup(std::uint32_t group, std::int64_t now)
+{
+    const std::uint32_t* begin = graph.groupBegin(group);
+    size_t size = static_cast<size_t>(graph.groupEnd(group) - begin);
+    size_t added = 0;
+
+    for (size_t probe = 0; probe < SAMPLES * PROBES_PER_SAMPLE && added < SAMPLES && size > 0; ++probe)
+    {
+        std::uint32_t member = begin[rng() % size];
+
+        if (isAllowed(member, now))
+        {
+            candidates.push_back(member);
+            ++added;
+        }
+    }
+}
+
+void SmartRadio::sampleLibrary(std::int64_t now)
+{
+    size_t added = 0;
+
+    for (size_t probe = 0; probe < SAMPLES * PROBES_PER_SAMPLE && added < SAMPLES; ++probe)
+    {
+        std::uint32_t song = static_cast<std::uint32_t>(rng() % graph.songCount());
+
+        if (isAllowed(song, now))
+        {
+            candidates.push_back(song);
+            ++added;
+        }
+    }
+}
+
+void SmartRadio::remember(std::uint32_t song)
+{
+    if (window.empty())
+    {
+        return;
+    }
+
+    /* The ring starts out unused; once full, forget its oldest song */
+    if (windowFill == window.size())
+    {
+        inWindow.erase(inWindow.find(window[windowHead]));
+    }
+    else
+    {
+        ++windowFill;
+    }
+
+    window[windowHead] = song;
+    windowHead = (windowHead + 1) % window.size();
+    inWindow.insert(song);
+}
+
+void SmartRadio::step()
+{
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+    /*
+     * Candidates: neighbours by artist and album, then co-play partners.
+     */
+    candidates.clear();
+    sampleGroup(graph.artistGroup(current), now);
+    sampleGroup(graph.albumGroup(current), now);
+
+    if (coPlays != nullptr)
+    {
+        size_t added = 0;
+
+        for (const CoPlayIndex::Neighbour& neighbour : coPlays->neighboursOf(library.getSongByIndex(current).id))
+        {
+            if (added == SAMPLES)
+            {
+                break;
+            }
+
+            const Song* partner = library.findSongByID(neighbour.songID);
+
+            if (partner != nullptr)
+            {
+                std::uint32_t song = static_cast<std::uint32_t>(partner - &library.getSongByIndex(0));
+
+                if (isAllowed(song, now))
+                {
+                    candidates.push_back(song);
+                    ++added;
+                }
+            }
+        }
+    }
+
+    /* The neighbourhood is used up: jump elsewhere in the library */
+    if (candidates.empty())
+    {
+        sampleLibrary(now);
+    }
+
+    /* Nothing allowed was found at all; a repeat cannot be avoided */
+    if (candidates.empty())
+    {
+        candidates.push_back(static_cast<std::uint32_t>(rng() % graph.songCount()));
+    }
+
+    /*
+     * Move to the best scored candidate.
+     */
+    const Song& from = library.getSongByIndex(current);
+    std::uint32_t best = candidates[0];
+    double bestScore = scorer.score(from, library.getSongByIndex(best));
+
+    for (size_t i = 1; i < candidates.size(); ++i)
+    {
+        double score = scorer.score(from, library.getSongByIndex(candidates[i]));
+
+        if (score > bestScore)
+        {
+            best = candidates[i];
+            bestScore = score;
+        }
+    }
+
+    current = best;
+    remember(current);
+    buffer.push_back(current);
+}
+
+bool SmartRadio::next(std::uint32_t& song)
+{
+    if (!valid)
+    {
+        return false;
+    }
+
+    song = buffer.front();
+    buffer.pop_front();
+    step();
+
+    return true;
+}
+
+void SmartRadio::peek(size_t count, std::vector<std::uint32_t>& upcoming) const
+{
+    for (size_t i = 0; i < buffer.size() && i < count; ++i)
+    {
+        upcoming.push_back(buffer[i]);
+    }
+}
+
+size_t SmartRadio::memoryUsage() const
+{
+    /* Hash nodes are counted with a rough per-node overhead */
+    return window.capacity() * sizeof(std::uint32_t)
+         + inWindow.bucket_count() * sizeof(void*)
+         + inWindow.size() * (sizeof(std::uint32_t) + 16)
+         + buffer.size() * sizeof(std::uint32_t)
+         + candidates.capacity() * sizeof(std::uint32_t);
+}
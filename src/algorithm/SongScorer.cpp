@@ -0,0 +1,38 @@
+#include "SongScorer.h"
+#include <cmath>
+#include <cstdlib>
+
+DefaultSongScorer::DefaultSongScorer(const CoPlayIndex* coPlays, ScoreWeights weights)
+    : weights(weights), coPlays(coPlays)
+{
+}
+
+double DefaultSongScorer::score(const Song& from, const Song& candidate) const
+{
+    double total = 0.0;
+
+    if (from.artist == candidate.artist)
+    {
+        total += weights.sameArtist;
+    }
+
+    if (from.album == candidate.album)
+    {
+        total += weights.sameAlbum;
+    }
+
+    double gap = std::abs(from.duration - candidate.duration);
+    total += weights.duration * std::exp(-gap / weights.durationScale);
+
+    if (coPlays != nullptr)
+    {
+        total += weights.coPlay * std::log1p(static_cast<double>(coPlays->count(from.id, candidate.id)));
+    }
+
+    return total;
+}
+
+const ScoreWeights& DefaultSongScorer::getWeights() const
+{
+    return weights;
+}
@@ -0,0 +1,162 @@
+#include "TimedPlaylist.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/* Position of the lowest set bit; each total is new only once, so this is rare */
+static size_t lowestBit(std::uint64_t bits)
+{
+    size_t position = 0;
+
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        ++position;
+    }
+
+    return position;
+}
+
+PlaybackQueue generateTimedPlaylist(
+    const std::vector<const Song*>& candidates,
+    const DurationTarget& target,
+    int* totalSeconds
+)
+{
+    PlaybackQueue resultQueue;
+
+    if (totalSeconds != nullptr)
+    {
+        *totalSeconds = 0;
+    }
+
+    if (target.seconds <= 0)
+    {
+        return resultQueue;
+    }
+
+    size_t exact = static_cast<size_t>(target.seconds);
+    size_t capacity = exact + static_cast<size_t>(std::max(target.tolerance, 0));
+
+    /*
+     * Diversity limits: keep the first songs of every artist and album.
+     */
+    std::unordered_map<std::string, size_t> perArtist;
+    std::unordered_map<std::string, size_t> perAlbum;
+    std::vector<const Song*> pool;
+    pool.reserve(candidates.size());
+
+    for (const Song* song : candidates)
+    {
+        if (song == nullptr || song->duration <= 0 || static_cast<size_t>(song->duration) > capacity)
+        {
+            continue;
+        }
+
+        if (target.maxPerArtist != 0 && perArtist[song->artist] >= target.maxPerArtist)
+        {
+            continue;
+        }
+
+        if (target.maxPerAlbum != 0 && perAlbum[song->album] >= target.maxPerAlbum)
+        {
+            continue;
+        }
+
+        ++perArtist[song->artist];
+        ++perAlbum[song->album];
+        pool.push_back(song);
+    }
+
+    /*
+     * Bit s of reachable: some subset of the songs so far totals s.
+     */
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+    size_t words = capacity / 64 + 1;
+    std::vector<std::uint64_t> reachable(words, 0);
+    std::vector<std::uint32_t> firstSong(capacity + 1, NONE);
+    reachable[0] = 1;
+
+    /* Totals above capacity are cut off in the last word */
+    size_t topBits = capacity % 64 + 1;
+    std::uint64_t topMask = (topBits == 64) ? ~std::uint64_t(0) : (std::uint64_t(1) << topBits) - 1;
+
+    auto isReachable = [&](size_t total) { return (reachable[total / 64] >> (total % 64)) & 1; };
+
+    for (size_t i = 0; i < pool.size() && !isReachable(exact); ++i)
+    {
+        size_t wordShift = static_cast<size_t>(pool[i]->duration) / 64;
+        size_t bitShift = static_cast<size_t>(pool[i]->duration) % 64;
+
+        /* High words first, so every word still reads the old bitset */
+        for (size_t w = words; w-- > wordShift; )
+        {
+            std::uint64_t shifted = reachable[w - wordShift] << bitShift;
+
+            if (bitShift != 0 && w - wordShift >= 1)
+            {
+                shifted |= reachable[w - wordShift - 1] >> (64 - bitShift);
+            }
+
+            if (w == words - 1)
+            {
+                shifted &= topMask;
+            }
+
+            /* Totals reached for the first time remember this song */
+            for (std::uint64_t fresh = shifted & ~reachable[w]; fresh != 0; fresh &= fresh - 1)
+            {
+                firstSong[w * 64 + lowestBit(fresh)] = static_cast<std::uint32_t>(i);
+            }
+
+            reachable[w] |= shifted;
+        }
+    }
+
+    /*
+     * Closest reachable total, preferring the shorter one on a tie.
+     */
+    size_t best = 0;
+
+    for (size_t total = 1; total <= capacity; ++total)
+    {
+        if (!isReachable(total))
+        {
+            continue;
+        }
+
+        size_t gap = (total > exact) ? total - exact : exact - total;
+        size_t bestGap = (best > exact) ? best - exact : exact - best;
+
+        if (gap < bestGap)
+        {
+            best = total;
+        }
+    }
+
+    /*
+     * Walk back: the song that first reached a total was added to a
+     * total that was reachable before it, so every step uses an earlier
+     * song and none repeats.
+     */
+    std::vector<std::uint32_t> chosen;
+
+    for (size_t total = best; total > 0; total -= static_cast<size_t>(pool[firstSong[total]]->duration))
+    {
+        chosen.push_back(firstSong[total]);
+    }
+
+    for (size_t k = chosen.size(); k-- > 0; )
+    {
+        resultQueue.addSong(*pool[chosen[k]]);
+    }
+
+    if (totalSeconds != nullptr)
+    {
+        *totalSeconds = static_cast<int>(best);
+    }
+
+    return resultQueue;
+}
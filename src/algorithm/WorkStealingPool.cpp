@@ -0,0 +1,178 @@
+#include "WorkStealingPool.h"
+
+/* Worker index of the current thread, if it belongs to a pool */
+static thread_local const WorkStealingPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    size_t target = (currentPool == this) ? currentWorker
+                                          : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+
+    pending.fetch_add(1);
+
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+
+    queued.fetch_add(1);
+
+    /* Taking the lock orders this against a worker about to sleep */
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+
+    wake.notify_one();
+}
+
+bool WorkStealingPool::runOne(size_t self)
+{
+    std::function<void()> task;
+
+    for (size_t k = 0; k < workers.size() && !task; ++k)
+    {
+        Worker& victim = *workers[(self + k) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.tasks.empty())
+        {
+            continue;
+        }
+
+        /* Own deque: newest first; other deques: steal the oldest */
+        if (k == 0)
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+
+    queued.fetch_sub(1);
+
+    try
+    {
+        task();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+
+        if (!firstError)
+        {
+            firstError = std::current_exception();
+        }
+    }
+
+    if (pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        idle.notify_all();
+    }
+
+    return true;
+}
+
+void WorkStealingPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (true)
+    {
+        if (runOne(index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+
+        if (stopping && queued.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::wait()
+{
+    size_t self = (currentPool == this) ? currentWorker : 0;
+
+    while (pending.load() > 0)
+    {
+        /* Help out instead of blocking while there is work to take */
+        if (runOne(self))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait(lock, [&] { return pending.load() == 0 || queued.load() > 0; });
+    }
+
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        std::swap(error, firstError);
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+size_t WorkStealingPool::threadCount() const
+{
+    return workers.size();
+}
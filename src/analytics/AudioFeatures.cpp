@@ -0,0 +1,551 @@
+#include "AudioFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Sample frames decoded per file read */
+static constexpr size_t READ_FRAMES = 16384;
+
+/* Pitch classes are taken from this frequency range (A1 to about D#8) */
+static constexpr double CHROMA_LOW_HZ = 55.0;
+static constexpr double CHROMA_HIGH_HZ = 5000.0;
+
+/*
+ * An onset is a flux peak this far above the average of the frames
+ * before it, where at least ONSET_MIN_FLUX of the frame is new energy.
+ */
+static constexpr float ONSET_FACTOR = 1.5f;
+static constexpr size_t ONSET_CONTEXT = 8;
+static constexpr float ONSET_MIN_FLUX = 0.2f;
+
+static constexpr double PI = 3.14159265358979323846;
+
+/* Little-endian field readers; WAV files are little-endian everywhere */
+static std::uint32_t readLE16(const unsigned char* bytes)
+{
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8);
+}
+
+static std::uint32_t readLE32(const unsigned char* bytes)
+{
+    return readLE16(bytes) | (readLE16(bytes + 2) << 16);
+}
+
+/* One sample of the given format as a float in [-1, 1] */
+static float decodeSample(const unsigned char* bytes, std::uint32_t format, std::uint32_t bits)
+{
+    if (format == 3)
+    {
+        std::uint32_t raw = readLE32(bytes);
+        float value;
+        std::memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+
+    switch (bits)
+    {
+        case 8:
+            return (static_cast<float>(bytes[0]) - 128.0f) / 128.0f;
+
+        case 16:
+            return static_cast<float>(static_cast<std::int16_t>(readLE16(bytes))) / 32768.0f;
+
+        case 24:
+        {
+            /* Placed in the top of a 32-bit value to keep its sign */
+            std::uint32_t raw = (static_cast<std::uint32_t>(bytes[0]) << 8)
+                              | (static_cast<std::uint32_t>(bytes[1]) << 16)
+                              | (static_cast<std::uint32_t>(bytes[2]) << 24);
+            return static_cast<float>(static_cast<std::int32_t>(raw)) / 2147483648.0f;
+        }
+
+        default:
+            return static_cast<float>(static_cast<std::int32_t>(readLE32(bytes))) / 2147483648.0f;
+    }
+}
+
+bool decodeWav(const std::string& filePath, AudioClip& clip)
+{
+    clip.samples.clear();
+    clip.sampleRate = 0;
+
+    std::ifstream file(filePath, std::ios::binary);
+    unsigned char header[12];
+
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))
+        || std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+
+    /*
+     * Walk the chunks up to "data", reading "fmt " on the way.
+     */
+    std::uint32_t format = 0;
+    std::uint32_t channels = 0;
+    std::uint32_t sampleRate = 0;
+    std::uint32_t bits = 0;
+    std::uint64_t dataBytes = 0;
+    bool haveFormat = false;
+
+    while (true)
+    {
+        unsigned char chunk[8];
+
+        if (!file.read(reinterpret_cast<char*>(chunk), sizeof(chunk)))
+        {
+            return false;
+        }
+
+        std::uint32_t size = readLE32(chunk + 4);
+
+        /* Chunks are padded to an even size; what is left of it gets skipped */
+        std::uint64_t skip = static_cast<std::uint64_t>(size) + (size & 1);
+
+        if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            dataBytes = size;
+            break;
+        }
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            unsigned char fields[40] = {};
+            std::uint32_t kept = std::min<std::uint32_t>(size, sizeof(fields));
+
+            if (!file.read(reinterpret_cast<char*>(fields), kept))
+            {
+                return false;
+            }
+
+            format = readLE16(fields);
+            channels = readLE16(fields + 2);
+            sampleRate = readLE32(fields + 4);
+            bits = readLE16(fields + 14);
+
+            /* WAVE_FORMAT_EXTENSIBLE: the real format opens the sub-format GUID */
+            if (format == 0xFFFE && kept >= 26)
+            {
+                format = readLE16(fields + 24);
+            }
+
+            haveFormat = true;
+            skip -= kept;
+        }
+
+        file.seekg(static_cast<std::streamoff>(skip), std::ios::cur);
+    }
+
+    bool integer = (format == 1) && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    bool floating = (format == 3) && (bits == 32);
+
+    if (!haveFormat || channels == 0 || sampleRate == 0 || !(integer || floating))
+    {
+        return false;
+    }
+
+    /*
+     * The declared size is only trusted as far as the file goes; 0 and
+     * 0xFFFFFFFF are left by streaming writers and mean "up to the end".
+     */
+    std::streamoff dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff fileEnd = file.tellg();
+    file.seekg(dataStart);
+
+    if (dataStart < 0 || fileEnd <= dataStart)
+    {
+        return false;
+    }
+
+    std::uint64_t available = static_cast<std::uint64_t>(fileEnd - dataStart);
+
+    if (dataBytes == 0 || dataBytes == 0xFFFFFFFF || dataBytes > available)
+    {
+        dataBytes = available;
+    }
+
+    /*
+     * Decode chunk by chunk, averaging the channels.
+     */
+    size_t sampleBytes = bits / 8;
+    size_t frameBytes = sampleBytes * channels;
+    size_t frames = static_cast<size_t>(dataBytes / frameBytes);
+    float scale = 1.0f / static_cast<float>(channels);
+
+    clip.samples.resize(frames);
+    clip.sampleRate = static_cast<int>(sampleRate);
+
+    std::vector<unsigned char> raw(READ_FRAMES * frameBytes);
+    size_t decoded = 0;
+
+    while (decoded < frames)
+    {
+        size_t wanted = std::min(READ_FRAMES, frames - decoded);
+        file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(wanted * frameBytes));
+
+        size_t got = static_cast<size_t>(file.gcount()) / frameBytes;
+
+        for (size_t i = 0; i < got; ++i)
+        {
+            const unsigned char* frame = &raw[i * frameBytes];
+            float sum = 0.0f;
+
+            for (size_t c = 0; c < channels; ++c)
+            {
+                sum += decodeSample(frame + c * sampleBytes, format, bits);
+            }
+
+            clip.samples[decoded + i] = sum * scale;
+        }
+
+        decoded += got;
+
+        /* A truncated file keeps what was read */
+        if (got < wanted)
+        {
+            break;
+        }
+    }
+
+    clip.samples.resize(decoded);
+    return decoded > 0;
+}
+
+AudioAnalyzer::AudioAnalyzer()
+    : window(FRAME), bitReversed(FRAME), twiddleRe(FRAME - 1), twiddleIm(FRAME - 1),
+      pitchClass(FRAME / 2 + 1, -1), re(FRAME), im(FRAME), magnitude(FRAME / 2 + 1), previous(FRAME / 2 + 1)
+{
+    size_t bitsUsed = 0;
+
+    while ((size_t(1) << bitsUsed) < FRAME)
+    {
+        ++bitsUsed;
+    }
+
+    for (size_t i = 0; i < FRAME; ++i)
+    {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * static_cast<double>(i) / FRAME));
+
+        std::uint32_t reversed = 0;
+
+        for (size_t b = 0; b < bitsUsed; ++b)
+        {
+            reversed |= static_cast<std::uint32_t>((i >> b) & 1) << (bitsUsed - 1 - b);
+        }
+
+        bitReversed[i] = reversed;
+    }
+
+    /* Stage with half-size h uses twiddles [h - 1, 2h - 1): exp(-2 pi i j / 2h) */
+    for (size_t half = 1; half < FRAME; half *= 2)
+    {
+        for (size_t j = 0; j < half; ++j)
+        {
+            double angle = -PI * static_cast<double>(j) / static_cast<double>(half);
+            twiddleRe[half - 1 + j] = static_cast<float>(std::cos(angle));
+            twiddleIm[half - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+/*
+ * Magnitudes of one real frame out of the FFT Z = a + i b of a frame
+ * pair: |Z[k] + conj Z[N - k]| / 2. With a and b swapped this gives
+ * the other frame, |Z[k] - conj Z[N - k]| / 2.
+ */
+static void halfSpectrum(const float* a, const float* b, float* magnitude)
+{
+    constexpr size_t N = AudioAnalyzer::FRAME;
+
+    /* Bin 0 is its own mirror */
+    float r0 = a[0] + a[0];
+    float i0 = b[0] - b[0];
+    magnitude[0] = 0.5f * std::sqrt(r0 * r0 + i0 * i0);
+
+#ifdef __SSE2__
+    static_assert((N / 2) % 4 == 0, "bins 1 to N / 2 are taken four at a time");
+
+    const __m128 halves = _mm_set1_ps(0.5f);
+
+    /* Bins k..k+3 against mirrors N-k..N-k-3, loaded in order and reversed */
+    for (size_t k = 1; k <= N / 2; k += 4)
+    {
+        __m128 am = _mm_loadu_ps(a + N - k - 3);
+        __m128 bm = _mm_loadu_ps(b + N - k - 3);
+        am = _mm_shuffle_ps(am, am, _MM_SHUFFLE(0, 1, 2, 3));
+        bm = _mm_shuffle_ps(bm, bm, _MM_SHUFFLE(0, 1, 2, 3));
+
+        __m128 r = _mm_add_ps(_mm_loadu_ps(a + k), am);
+        __m128 i = _mm_sub_ps(_mm_loadu_ps(b + k), bm);
+
+        _mm_storeu_ps(magnitude + k, _mm_mul_ps(halves, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)))));
+    }
+#else
+    for (size_t k = 1; k <= N / 2; ++k)
+    {
+        float r = a[k] + a[N - k];
+        float i = b[k] - b[N - k];
+        magnitude[k] = 0.5f * std::sqrt(r * r + i * i);
+    }
+#endif
+}
+
+void AudioAnalyzer::transform()
+{
+    /* A permutation, which stays scalar */
+    for (size_t i = 0; i < FRAME; ++i)
+    {
+        size_t j = bitReversed[i];
+
+        if (i < j)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    for (size_t half = 1; half < FRAME; half *= 2)
+    {
+        const float* wr = &twiddleRe[half - 1];
+        const float* wi = &twiddleIm[half - 1];
+
+        for (size_t start = 0; start < FRAME; start += 2 * half)
+        {
+            float* ar = &re[start];
+            float* ai = &im[start];
+            float* br = ar + half;
+            float* bi = ai + half;
+
+            size_t j = 0;
+
+#ifdef __SSE2__
+            /* Four butterflies at a time; the first two stages are too short */
+            for (; j + 4 <= half; j += 4)
+            {
+                __m128 twr = _mm_loadu_ps(wr + j);
+                __m128 twi = _mm_loadu_ps(wi + j);
+                __m128 vbr = _mm_loadu_ps(br + j);
+                __m128 vbi = _mm_loadu_ps(bi + j);
+                __m128 var = _mm_loadu_ps(ar + j);
+                __m128 vai = _mm_loadu_ps(ai + j);
+
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(twr, vbr), _mm_mul_ps(twi, vbi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(twr, vbi), _mm_mul_ps(twi, vbr));
+
+                _mm_storeu_ps(br + j, _mm_sub_ps(var, tr));
+                _mm_storeu_ps(bi + j, _mm_sub_ps(vai, ti));
+                _mm_storeu_ps(ar + j, _mm_add_ps(var, tr));
+                _mm_storeu_ps(ai + j, _mm_add_ps(vai, ti));
+            }
+#endif
+
+            for (; j < half; ++j)
+            {
+                float tr = wr[j] * br[j] - wi[j] * bi[j];
+                float ti = wr[j] * bi[j] + wi[j] * br[j];
+
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+void AudioAnalyzer::tune(int sampleRate)
+{
+    for (size_t k = 1; k <= FRAME / 2; ++k)
+    {
+        double frequency = static_cast<double>(k) * sampleRate / FRAME;
+
+        if (frequency < CHROMA_LOW_HZ || frequency > CHROMA_HIGH_HZ)
+        {
+            pitchClass[k] = -1;
+            continue;
+        }
+
+        /* MIDI note 60 is C, so the note number mod 12 counts from C */
+        long note = std::lround(69.0 + 12.0 * std::log2(frequency / 440.0));
+        pitchClass[k] = static_cast<int>(((note % 12) + 12) % 12);
+    }
+
+    pitchClass[0] = -1;
+    chromaRate = sampleRate;
+}
+
+bool AudioAnalyzer::analyze(const AudioClip& clip, FeatureVector& features)
+{
+    features.fill(0.0f);
+
+    const std::vector<float>& samples = clip.samples;
+
+    if (samples.size() < FRAME || clip.sampleRate <= 0)
+    {
+        return false;
+    }
+
+    if (chromaRate != clip.sampleRate)
+    {
+        tune(clip.sampleRate);
+    }
+
+    size_t frames = 1 + (samples.size() - FRAME) / HOP;
+    size_t bins = FRAME / 2 + 1;
+
+    double magnitudeSum = 0.0;
+    double firstMoment = 0.0;
+    double secondMoment = 0.0;
+    double chroma[12] = {};
+
+    flux.clear();
+    std::fill(previous.begin(), previous.end(), 0.0f);
+
+    /* Spectral statistics of the frame in magnitude */
+    auto addFrame = [&]()
+    {
+        float frameFlux = 0.0f;
+        float frameMagnitude = 0.0f;
+
+        for (size_t k = 0; k < bins; ++k)
+        {
+            float m = magnitude[k];
+            float k1 = static_cast<float>(k);
+
+            magnitudeSum += m;
+            firstMoment += k1 * m;
+            secondMoment += k1 * k1 * m;
+
+            if (pitchClass[k] >= 0)
+            {
+                chroma[pitchClass[k]] += static_cast<double>(m) * m;
+            }
+
+            frameFlux += std::max(0.0f, m - previous[k]);
+            frameMagnitude += m;
+        }
+
+        /*
+         * Flux as a share of the frame, so it does not depend on volume;
+         * the added 1 (about the noise floor of 16-bit audio) keeps
+         * near-silent frames out. The first frame rises from silence,
+         * which is not an onset.
+         */
+        flux.push_back(flux.empty() ? 0.0f : frameFlux / (frameMagnitude + 1.0f));
+        previous.swap(magnitude);
+    };
+
+    /*
+     * Frames in pairs: one as the real part, the next as the imaginary part.
+     */
+    for (size_t f = 0; f < frames; f += 2)
+    {
+        const float* first = &samples[f * HOP];
+        bool paired = f + 1 < frames;
+
+        for (size_t i = 0; i < FRAME; ++i)
+        {
+            re[i] = first[i] * window[i];
+        }
+
+        if (paired)
+        {
+            const float* second = &samples[(f + 1) * HOP];
+
+            for (size_t i = 0; i < FRAME; ++i)
+            {
+                im[i] = second[i] * window[i];
+            }
+        }
+        else
+        {
+            std::fill(im.begin(), im.end(), 0.0f);
+        }
+
+        transform();
+
+        /* X1[k] = (Z[k] + conj Z[N - k]) / 2 */
+        halfSpectrum(re.data(), im.data(), magnitude.data());
+        addFrame();
+
+        if (paired)
+        {
+            /* X2[k] = (Z[k] - conj Z[N - k]) / 2i */
+            halfSpectrum(im.data(), re.data(), magnitude.data());
+            addFrame();
+        }
+    }
+
+    /*
+     * Onsets: flux peaks well above the frames just before them.
+     */
+    size_t onsets = 0;
+    double context = 0.0;
+
+    for (size_t t = 1; t < flux.size(); ++t)
+    {
+        context += flux[t - 1];
+
+        if (t > ONSET_CONTEXT)
+        {
+            context -= flux[t - 1 - ONSET_CONTEXT];
+        }
+
+        double average = context / static_cast<double>(std::min(t, ONSET_CONTEXT));
+        bool peak = flux[t] >= flux[t - 1] && (t + 1 == flux.size() || flux[t] > flux[t + 1]);
+
+        if (peak && flux[t] > ONSET_FACTOR * average && flux[t] > ONSET_MIN_FLUX)
+        {
+            ++onsets;
+        }
+    }
+
+    /*
+     * Loudness over every sample.
+     */
+    double energy = 0.0;
+
+    for (float sample : samples)
+    {
+        energy += static_cast<double>(sample) * sample;
+    }
+
+    double rms = std::sqrt(energy / static_cast<double>(samples.size()));
+    double decibels = (rms > 0.0) ? 20.0 * std::log10(rms) : -60.0;
+    double seconds = static_cast<double>(samples.size()) / clip.sampleRate;
+    double nyquistBins = static_cast<double>(FRAME / 2);
+
+    if (magnitudeSum > 0.0)
+    {
+        double centroid = firstMoment / magnitudeSum;
+        double variance = std::max(0.0, secondMoment / magnitudeSum - centroid * centroid);
+
+        features[FEATURE_CENTROID] = static_cast<float>(centroid / nyquistBins);
+        features[FEATURE_SPREAD] = static_cast<float>(std::sqrt(variance) / nyquistBins);
+    }
+
+    features[FEATURE_LOUDNESS] = static_cast<float>(std::min(1.0, std::max(0.0, (decibels + 60.0) / 60.0)));
+    features[FEATURE_ONSET_RATE] = static_cast<float>(static_cast<double>(onsets) / seconds / 10.0);
+
+    double chromaLength = 0.0;
+
+    for (double value : chroma)
+    {
+        chromaLength += value * value;
+    }
+
+    chromaLength = std::sqrt(chromaLength);
+
+    for (size_t c = 0; c < 12 && chromaLength > 0.0; ++c)
+    {
+        features[FEATURE_CHROMA + c] = static_cast<float>(chroma[c] / chromaLength);
+    }
+
+    return true;
+}
@@ -0,0 +1,165 @@
+#include "CoPlayIndex.h"
+#include <algorithm>
+#include <utility>
+
+void CoPlayIndex::clear()
+{
+    partners.clear();
+    windowFill = 0;
+    ++version;
+    ++epoch;
+    playsSinceEpoch = 0;
+}
+
+void CoPlayIndex::addPartner(int song, int partner)
+{
+    if (static_cast<size_t>(song) >= partners.size())
+    {
+        partners.resize(static_cast<size_t>(song) + 1);
+    }
+
+    std::vector<Neighbour>& row = partners[song];
+    size_t position = 0;
+
+    while (position < row.size() && row[position].songID != partner)
+    {
+        ++position;
+    }
+
+    if (position == row.size())
+    {
+        if (row.size() < CANDIDATES)
+        {
+            row.push_back({ partner, 0 });
+        }
+        else
+        {
+            /* Full row: the newcomer replaces the weakest partner and starts from its count */
+            position = row.size() - 1;
+            row[position].songID = partner;
+        }
+    }
+
+    if (row[position].count != UINT32_MAX)
+    {
+        ++row[position].count;
+    }
+
+    /* Move up past the partners it now outnumbers, keeping the row sorted */
+    while (position > 0 && row[position - 1].count < row[position].count)
+    {
+        std::swap(row[position - 1], row[position]);
+        --position;
+    }
+}
+
+void CoPlayIndex::record(const ListeningEvent& event)
+{
+    if (event.songID < 0)
+    {
+        windowFill = 0;
+        return;
+    }
+
+    /* A long pause starts a new session */
+    if (windowFill > 0 && event.timestamp - window[windowFill - 1].timestamp > SESSION_GAP)
+    {
+        windowFill = 0;
+    }
+
+    for (size_t i = 0; i < windowFill; ++i)
+    {
+        if (window[i].songID != event.songID)
+        {
+            addPartner(event.songID, window[i].songID);
+            addPartner(window[i].songID, event.songID);
+        }
+    }
+
+    if (windowFill > 0)
+    {
+        ++version;
+
+        if (++playsSinceEpoch == EPOCH_PLAYS)
+        {
+            ++epoch;
+            playsSinceEpoch = 0;
+        }
+    }
+
+    if (windowFill == WINDOW)
+    {
+        std::move(window + 1, window + WINDOW, window);
+        --windowFill;
+    }
+
+    window[windowFill++] = event;
+}
+
+void CoPlayIndex::build(const ListeningLog& log)
+{
+    clear();
+
+    std::vector<ListeningEvent> chunk;
+    chunk.reserve(BUILD_CHUNK);
+
+    for (size_t first = 0; log.readEvents(first, BUILD_CHUNK, chunk) > 0; first += chunk.size())
+    {
+        for (const ListeningEvent& event : chunk)
+        {
+            record(event);
+        }
+    }
+}
+
+CoPlayIndex::NeighbourList CoPlayIndex::neighboursOf(int songID) const
+{
+    if (songID < 0 || static_cast<size_t>(songID) >= partners.size())
+    {
+        return NeighbourList();
+    }
+
+    const std::vector<Neighbour>& row = partners[songID];
+
+    return NeighbourList(row.data(), row.data() + std::min(row.size(), NEIGHBOURS));
+}
+
+std::uint32_t CoPlayIndex::count(int a, int b) const
+{
+    if (a < 0 || static_cast<size_t>(a) >= partners.size())
+    {
+        return 0;
+    }
+
+    for (const Neighbour& neighbour : partners[a])
+    {
+        if (neighbour.songID == b)
+        {
+            return neighbour.count;
+        }
+    }
+
+    return 0;
+}
+
+std::uint64_t CoPlayIndex::getVersion() const
+{
+    return version;
+}
+
+std::uint64_t CoPlayIndex::getEpoch() const
+{
+    return epoch;
+}
+
+size_t CoPlayIndex::memoryUsage() const
+{
+    size_t bytes = partners.capacity() * sizeof(std::vector<Neighbour>);
+
+    for (const std::vector<Neighbour>& row : partners)
+    {
+        bytes += row.capacity() * sizeof(Neighbour);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,608 @@
+#include "ListeningLog.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* File identification and format version */
+static constexpr std::uint32_t LOG_MAGIC   = 0x474C504D;   /* "MPLG" */
+static constexpr std::uint32_t LOG_VERSION = 1;
+
+/* The header occupies one page so blocks stay page aligned */
+static constexpr std::uint64_t HEADER_BYTES = 4096;
+
+/* Bytes per event: timestamp + song ID + seconds + skip flag */
+static constexpr std::uint64_t EVENT_BYTES = 8 + 4 + 4 + 1;
+static constexpr std::uint64_t BLOCK_BYTES = ListeningLog::BLOCK_EVENTS * EVENT_BYTES;
+
+/* Minimum blocks added whenever the file has to grow (~1 MB) */
+static constexpr std::uint64_t GROW_BLOCKS = 16;
+
+/* =============================================================
+ * GROUPING HELPERS
+ * ============================================================= */
+
+/* Assigns a dense group number to each distinct key of the songs */
+template <typename KeyOf>
+static SongGrouping groupSongs(const MusicLibrary& library, KeyOf keyOf)
+{
+    SongGrouping grouping;
+    std::unordered_map<std::string, std::int32_t> groupByName;
+
+    for (size_t i = 0; i < library.getSongCount(); ++i)
+    {
+        const Song& song = library.getSongByIndex(i);
+
+        if (song.id < 0)
+        {
+            continue;
+        }
+
+        const std::string& key = keyOf(song);
+        auto inserted = groupByName.emplace(key, static_cast<std::int32_t>(grouping.names.size()));
+
+        if (inserted.second)
+        {
+            grouping.names.push_back(key);
+        }
+
+        if (static_cast<size_t>(song.id) >= grouping.groupOfSong.size())
+        {
+            grouping.groupOfSong.resize(song.id + 1, -1);
+        }
+
+        grouping.groupOfSong[song.id] = inserted.first->second;
+    }
+
+    return grouping;
+}
+
+SongGrouping groupSongsByArtist(const MusicLibrary& library)
+{
+    return groupSongs(library, [](const Song& song) -> const std::string& { return song.artist; });
+}
+
+SongGrouping groupSongsByAlbum(const MusicLibrary& library)
+{
+    return groupSongs(library, [](const Song& song) -> const std::string& { return song.album; });
+}
+
+/* =============================================================
+ * MAPPING
+ * ============================================================= */
+
+ListeningLog::~ListeningLog()
+{
+    close();
+}
+
+ListeningLog::Header* ListeningLog::header() const
+{
+    return reinterpret_cast<Header*>(base);
+}
+
+std::int64_t* ListeningLog::timeColumn(size_t block) const
+{
+    return reinterpret_cast<std::int64_t*>(base + HEADER_BYTES + block * BLOCK_BYTES);
+}
+
+std::int32_t* ListeningLog::songColumn(size_t block) const
+{
+    return reinterpret_cast<std::int32_t*>(timeColumn(block) + BLOCK_EVENTS);
+}
+
+std::int32_t* ListeningLog::secondsColumn(size_t block) const
+{
+    return songColumn(block) + BLOCK_EVENTS;
+}
+
+std::uint8_t* ListeningLog::skipColumn(size_t block) const
+{
+    return reinterpret_cast<std::uint8_t*>(secondsColumn(block) + BLOCK_EVENTS);
+}
+
+size_t ListeningLog::blockCount() const
+{
+    return static_cast<size_t>((header()->eventCount + BLOCK_EVENTS - 1) / BLOCK_EVENTS);
+}
+
+size_t ListeningLog::eventsInBlock(size_t block) const
+{
+    std::uint64_t first = static_cast<std::uint64_t>(block) * BLOCK_EVENTS;
+    std::uint64_t left = header()->eventCount - first;
+
+    return static_cast<size_t>(left < BLOCK_EVENTS ? left : BLOCK_EVENTS);
+}
+
+bool ListeningLog::map(std::uint64_t bytes)
+{
+#ifdef _WIN32
+    /* Creating a mapping larger than the file extends the file */
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE,
+                                       static_cast<DWORD>(bytes >> 32),
+                                       static_cast<DWORD>(bytes & 0xFFFFFFFFu), NULL);
+
+    if (mappingHandle == NULL)
+    {
+        mappingHandle = nullptr;
+        return false;
+    }
+
+    base = static_cast<unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+
+    if (base == nullptr)
+    {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+        return false;
+    }
+#else
+    struct stat info {};
+
+    if (fstat(fileDescriptor, &info) != 0)
+    {
+        return false;
+    }
+
+    if (static_cast<std::uint64_t>(info.st_size) < bytes &&
+        ftruncate(fileDescriptor, static_cast<off_t>(bytes)) != 0)
+    {
+        return false;
+    }
+
+    void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    base = static_cast<unsigned char*>(view);
+#endif
+
+    mappedBytes = bytes;
+    return true;
+}
+
+void ListeningLog::unmap()
+{
+    if (base == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    FlushViewOfFile(base, 0);
+    UnmapViewOfFile(base);
+    CloseHandle(mappingHandle);
+    mappingHandle = nullptr;
+#else
+    munmap(base, mappedBytes);
+#endif
+
+    base = nullptr;
+    mappedBytes = 0;
+}
+
+bool ListeningLog::open(const std::string& filePath)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base != nullptr)
+    {
+        return false;
+    }
+
+    std::uint64_t fileBytes = 0;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                                NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(handle, &size);
+    fileBytes = static_cast<std::uint64_t>(size.QuadPart);
+    fileHandle = handle;
+#else
+    fileDescriptor = ::open(filePath.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat info {};
+    fstat(fileDescriptor, &info);
+    fileBytes = static_cast<std::uint64_t>(info.st_size);
+#endif
+
+    bool fresh = (fileBytes == 0);
+    std::uint64_t bytes = fresh ? HEADER_BYTES + GROW_BLOCKS * BLOCK_BYTES : fileBytes;
+
+    if (bytes < HEADER_BYTES || !map(bytes))
+    {
+        closeFile();
+        return false;
+    }
+
+    if (fresh)
+    {
+        *header() = Header { LOG_MAGIC, LOG_VERSION, 0, BLOCK_EVENTS, -1 };
+    }
+
+    const Header* h = header();
+    std::uint64_t capacity = (mappedBytes - HEADER_BYTES) / BLOCK_BYTES * BLOCK_EVENTS;
+
+    if (h->magic != LOG_MAGIC || h->version != LOG_VERSION ||
+        h->blockEvents != BLOCK_EVENTS || h->eventCount > capacity)
+    {
+        std::cerr << "[Warning] Not a listening log: " << filePath << "\n";
+        unmap();
+        closeFile();
+        return false;
+    }
+
+    /* Rebuild per-block time ranges used to prune scans */
+    blockRanges.assign(blockCount(), BlockRange { 0, -1 });
+
+    for (size_t b = 0; b < blockRanges.size(); ++b)
+    {
+        const std::int64_t* times = timeColumn(b);
+        size_t n = eventsInBlock(b);
+
+        std::int64_t lo = times[0];
+        std::int64_t hi = times[0];
+
+        for (size_t i = 1; i < n; ++i)
+        {
+            lo = (times[i] < lo) ? times[i] : lo;
+            hi = (times[i] > hi) ? times[i] : hi;
+        }
+
+        blockRanges[b] = BlockRange { lo, hi };
+    }
+
+    return true;
+}
+
+void ListeningLog::closeFile()
+{
+#ifdef _WIN32
+    if (fileHandle != nullptr)
+    {
+        CloseHandle(fileHandle);
+        fileHandle = nullptr;
+    }
+#else
+    if (fileDescriptor >= 0)
+    {
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+}
+
+void ListeningLog::close()
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr)
+    {
+        return;
+    }
+
+    unmap();
+    closeFile();
+    blockRanges.clear();
+}
+
+bool ListeningLog::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return base != nullptr;
+}
+
+/* =============================================================
+ * APPEND & ACCESS
+ * ============================================================= */
+
+void ListeningLog::append(const ListeningEvent& event)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr || event.songID < 0)
+    {
+        return;
+    }
+
+    std::uint64_t index = header()->eventCount;
+    size_t block = static_cast<size_t>(index / BLOCK_EVENTS);
+    size_t offset = static_cast<size_t>(index % BLOCK_EVENTS);
+
+    /* Grow the file when the next block does not fit into the mapping */
+    if (HEADER_BYTES + (block + 1) * BLOCK_BYTES > mappedBytes)
+    {
+        std::uint64_t oldBytes = mappedBytes;
+
+        /* Grow by a quarter of the current size so remaps stay rare */
+        std::uint64_t growBlocks = (block / 4 > GROW_BLOCKS) ? block / 4 : GROW_BLOCKS;
+
+        unmap();
+
+        if (!map(oldBytes + growBlocks * BLOCK_BYTES))
+        {
+            std::cerr << "[Warning] Listening log could not grow; event dropped.\n";
+
+            if (!map(oldBytes))
+            {
+                closeFile();
+            }
+
+            return;
+        }
+    }
+
+    /* Write the fields first; bumping the count publishes the event */
+    timeColumn(block)[offset] = event.timestamp;
+    songColumn(block)[offset] = event.songID;
+    secondsColumn(block)[offset] = event.secondsListened;
+    skipColumn(block)[offset] = event.skipped ? 1 : 0;
+
+    if (event.songID > header()->maxSongID)
+    {
+        header()->maxSongID = event.songID;
+    }
+
+    header()->eventCount = index + 1;
+
+    if (offset == 0)
+    {
+        blockRanges.push_back(BlockRange { event.timestamp, event.timestamp });
+    }
+    else
+    {
+        BlockRange& range = blockRanges[block];
+        range.minTime = (event.timestamp < range.minTime) ? event.timestamp : range.minTime;
+        range.maxTime = (event.timestamp > range.maxTime) ? event.timestamp : range.maxTime;
+    }
+}
+
+size_t ListeningLog::size() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return (base == nullptr) ? 0 : static_cast<size_t>(header()->eventCount);
+}
+
+bool ListeningLog::getEvent(size_t index, ListeningEvent& event) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    /* Positions past the last event, or blocks outside the mapping, hold nothing */
+    if (base == nullptr || index >= header()->eventCount)
+    {
+        return false;
+    }
+
+    size_t block = index / BLOCK_EVENTS;
+    size_t offset = index % BLOCK_EVENTS;
+
+    if (HEADER_BYTES + (block + 1) * BLOCK_BYTES > mappedBytes)
+    {
+        return false;
+    }
+
+    event.songID = songColumn(block)[offset];
+    event.timestamp = timeColumn(block)[offset];
+    event.secondsListened = secondsColumn(block)[offset];
+    event.skipped = skipColumn(block)[offset] != 0;
+
+    return true;
+}
+
+size_t ListeningLog::readEvents(size_t first, size_t count, std::vector<ListeningEvent>& events) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    events.clear();
+
+    size_t total = (base == nullptr) ? 0 : static_cast<size_t>(header()->eventCount);
+
+    if (first >= total)
+    {
+        return 0;
+    }
+
+    size_t last = (total - first < count) ? total : first + count;
+    events.resize(last - first);
+
+    /* Block by block, column by column */
+    for (size_t index = first; index < last; )
+    {
+        size_t block = index / BLOCK_EVENTS;
+        size_t offset = index % BLOCK_EVENTS;
+        size_t n = std::min(BLOCK_EVENTS - offset, last - index);
+
+        const std::int32_t* songs = songColumn(block) + offset;
+        const std::int64_t* times = timeColumn(block) + offset;
+        const std::int32_t* seconds = secondsColumn(block) + offset;
+        const std::uint8_t* skipped = skipColumn(block) + offset;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            ListeningEvent& event = events[index - first + i];
+            event.songID = songs[i];
+            event.timestamp = times[i];
+            event.secondsListened = seconds[i];
+            event.skipped = skipped[i] != 0;
+        }
+
+        index += n;
+    }
+
+    return events.size();
+}
+
+/* =============================================================
+ * QUERIES
+ * ============================================================= */
+
+template <typename Visitor>
+void ListeningLog::forEachBlock(std::int64_t from, std::int64_t to, Visitor visit) const
+{
+    for (size_t b = 0; b < blockRanges.size(); ++b)
+    {
+        /* Skip blocks entirely outside the window */
+        if (blockRanges[b].maxTime < from || blockRanges[b].minTime >= to)
+        {
+            continue;
+        }
+
+        visit(b, eventsInBlock(b));
+    }
+}
+
+std::vector<std::uint64_t> ListeningLog::playsPerSong(std::int64_t from, std::int64_t to) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr || header()->maxSongID < 0)
+    {
+        return {};
+    }
+
+    std::vector<std::uint64_t> counts(header()->maxSongID + 1, 0);
+
+    forEachBlock(from, to, [&](size_t block, size_t n)
+    {
+        const std::int64_t* times = timeColumn(block);
+        const std::int32_t* songs = songColumn(block);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            counts[songs[i]] += static_cast<std::uint64_t>((times[i] >= from) & (times[i] < to));
+        }
+    });
+
+    return counts;
+}
+
+std::vector<std::uint64_t> ListeningLog::skipsPerSong(std::int64_t from, std::int64_t to) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr || header()->maxSongID < 0)
+    {
+        return {};
+    }
+
+    std::vector<std::uint64_t> counts(header()->maxSongID + 1, 0);
+
+    forEachBlock(from, to, [&](size_t block, size_t n)
+    {
+        const std::int64_t* times = timeColumn(block);
+        const std::int32_t* songs = songColumn(block);
+        const std::uint8_t* skipped = skipColumn(block);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            counts[songs[i]] += static_cast<std::uint64_t>((times[i] >= from) & (times[i] < to) & skipped[i]);
+        }
+    });
+
+    return counts;
+}
+
+std::vector<std::uint64_t> ListeningLog::playsPerGroup(const SongGrouping& grouping,
+                                                       std::int64_t from, std::int64_t to) const
+{
+    /* Fold song counts into groups; the scan itself stays per song */
+    std::vector<std::uint64_t> songCounts = playsPerSong(from, to);
+    std::vector<std::uint64_t> counts(grouping.names.size(), 0);
+
+    size_t limit = songCounts.size() < grouping.groupOfSong.size()
+                 ? songCounts.size() : grouping.groupOfSong.size();
+
+    for (size_t id = 0; id < limit; ++id)
+    {
+        std::int32_t group = grouping.groupOfSong[id];
+
+        if (group >= 0)
+        {
+            counts[group] += songCounts[id];
+        }
+    }
+
+    return counts;
+}
+
+double ListeningLog::skipRate(std::int64_t from, std::int64_t to) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr)
+    {
+        return 0.0;
+    }
+
+    std::uint64_t total = 0;
+    std::uint64_t skips = 0;
+
+    forEachBlock(from, to, [&](size_t block, size_t n)
+    {
+        const std::int64_t* times = timeColumn(block);
+        const std::uint8_t* skipped = skipColumn(block);
+
+        /* Branch-free so the loop vectorizes */
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::uint64_t inside = (times[i] >= from) & (times[i] < to);
+            total += inside;
+            skips += inside & skipped[i];
+        }
+    });
+
+    return (total == 0) ? 0.0 : static_cast<double>(skips) / static_cast<double>(total);
+}
+
+double ListeningLog::skipRate(int songID, std::int64_t from, std::int64_t to) const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (base == nullptr)
+    {
+        return 0.0;
+    }
+
+    std::uint64_t total = 0;
+    std::uint64_t skips = 0;
+
+    forEachBlock(from, to, [&](size_t block, size_t n)
+    {
+        const std::int64_t* times = timeColumn(block);
+        const std::int32_t* songs = songColumn(block);
+        const std::uint8_t* skipped = skipColumn(block);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::uint64_t inside = (times[i] >= from) & (times[i] < to) & (songs[i] == songID);
+            total += inside;
+            skips += inside & skipped[i];
+        }
+    });
+
+    return (total == 0) ? 0.0 : static_cast<double>(skips) / static_cast<double>(total);
+}
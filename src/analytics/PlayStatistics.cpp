@@ -0,0 +1,276 @@
+#include "PlayStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+/* Rescale before exp(age / tau) gets anywhere near overflow */
+static constexpr double MAX_LOG_WEIGHT = 600.0;
+
+/* Decay constants of the windows, in seconds */
+static constexpr double WINDOW_SECONDS[] = { 3600.0, 86400.0, 604800.0 };
+
+/* Songs, artists, albums */
+static constexpr size_t DIMENSIONS = 3;
+
+/* =============================================================
+ * DecayedTopK
+ * ============================================================= */
+
+DecayedTopK::DecayedTopK(size_t capacity, double tauSeconds, size_t width, size_t depth)
+    : capacity(capacity), width(1), depth(depth), tau(tauSeconds)
+{
+    /* Round width up to a power of two so buckets are a mask */
+    while (this->width < width)
+    {
+        this->width <<= 1;
+    }
+
+    sketch.assign(this->width * depth, 0.0);
+    heap.reserve(capacity);
+}
+
+size_t DecayedTopK::bucket(int key, size_t row) const
+{
+    /* SplitMix64 finalizer, seeded per row */
+    std::uint64_t x = static_cast<std::uint32_t>(key) + (row + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x = x ^ (x >> 31);
+
+    return row * width + static_cast<size_t>(x & (width - 1));
+}
+
+void DecayedTopK::swapCandidates(size_t a, size_t b)
+{
+    std::swap(heap[a], heap[b]);
+    heapPosition[heap[a].key] = a;
+    heapPosition[heap[b].key] = b;
+}
+
+void DecayedTopK::siftUp(size_t i)
+{
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+
+        if (heap[parent].weight <= heap[i].weight)
+        {
+            break;
+        }
+
+        swapCandidates(i, parent);
+        i = parent;
+    }
+}
+
+void DecayedTopK::siftDown(size_t i)
+{
+    while (true)
+    {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+
+        if (left < heap.size() && heap[left].weight < heap[smallest].weight)
+        {
+            smallest = left;
+        }
+
+        if (right < heap.size() && heap[right].weight < heap[smallest].weight)
+        {
+            smallest = right;
+        }
+
+        if (smallest == i)
+        {
+            break;
+        }
+
+        swapCandidates(i, smallest);
+        i = smallest;
+    }
+}
+
+void DecayedTopK::rescale(double newLandmark)
+{
+    /* Uniform scaling keeps the heap order intact */
+    double factor = std::exp((landmark - newLandmark) / tau);
+
+    for (double& counter : sketch)
+    {
+        counter *= factor;
+    }
+
+    for (Candidate& candidate : heap)
+    {
+        candidate.weight *= factor;
+    }
+
+    landmark = newLandmark;
+}
+
+void DecayedTopK::add(int key, double now)
+{
+    if (!started)
+    {
+        landmark = now;
+        started = true;
+    }
+
+    if ((now - landmark) / tau > MAX_LOG_WEIGHT)
+    {
+        rescale(now);
+    }
+
+    double increment = std::exp((now - landmark) / tau);
+
+    /* Conservative update: only raise the counters that define the minimum */
+    double current = sketch[bucket(key, 0)];
+
+    for (size_t row = 1; row < depth; ++row)
+    {
+        current = std::min(current, sketch[bucket(key, row)]);
+    }
+
+    double updated = current + increment;
+
+    for (size_t row = 0; row < depth; ++row)
+    {
+        double& counter = sketch[bucket(key, row)];
+        counter = std::max(counter, updated);
+    }
+
+    /* Space-saving step on the candidate heap */
+    auto found = heapPosition.find(key);
+
+    if (found != heapPosition.end())
+    {
+        heap[found->second].weight = updated;
+        siftDown(found->second);
+    }
+    else if (heap.size() < capacity)
+    {
+        heap.push_back({ key, updated });
+        heapPosition[key] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+    }
+    else if (capacity > 0 && updated > heap[0].weight)
+    {
+        heapPosition.erase(heap[0].key);
+        heap[0] = { key, updated };
+        heapPosition[key] = 0;
+        siftDown(0);
+    }
+}
+
+double DecayedTopK::estimate(int key, double now) const
+{
+    if (!started)
+    {
+        return 0.0;
+    }
+
+    double value = sketch[bucket(key, 0)];
+
+    for (size_t row = 1; row < depth; ++row)
+    {
+        value = std::min(value, sketch[bucket(key, row)]);
+    }
+
+    return value * std::exp((landmark - now) / tau);
+}
+
+std::vector<TopItem> DecayedTopK::top(double now) const
+{
+    std::vector<TopItem> items;
+    items.reserve(heap.size());
+
+    double scale = started ? std::exp((landmark - now) / tau) : 0.0;
+
+    for (const Candidate& candidate : heap)
+    {
+        items.push_back({ candidate.key, candidate.weight * scale });
+    }
+
+    std::sort(items.begin(), items.end(), [](const TopItem& a, const TopItem& b)
+    {
+        return a.score > b.score;
+    });
+
+    return items;
+}
+
+/* =============================================================
+ * PlayStatistics
+ * ============================================================= */
+
+PlayStatistics::PlayStatistics()
+{
+    for (double seconds : WINDOW_SECONDS)
+    {
+        for (size_t d = 0; d < DIMENSIONS; ++d)
+        {
+            trackers.emplace_back(TOP_K, seconds);
+        }
+    }
+}
+
+void PlayStatistics::initialize(const MusicLibrary& library)
+{
+    artists = groupSongsByArtist(library);
+    albums = groupSongsByAlbum(library);
+}
+
+const DecayedTopK& PlayStatistics::tracker(StatsWindow window, size_t dimension) const
+{
+    return trackers[static_cast<size_t>(window) * DIMENSIONS + dimension];
+}
+
+void PlayStatistics::recordPlay(int songID, std::int64_t now)
+{
+    double t = static_cast<double>(now);
+
+    int artist = (songID >= 0 && static_cast<size_t>(songID) < artists.groupOfSong.size())
+               ? artists.groupOfSong[songID] : -1;
+    int album = (songID >= 0 && static_cast<size_t>(songID) < albums.groupOfSong.size())
+              ? albums.groupOfSong[songID] : -1;
+
+    for (size_t w = 0; w < trackers.size(); w += DIMENSIONS)
+    {
+        trackers[w].add(songID, t);
+
+        if (artist >= 0)
+        {
+            trackers[w + 1].add(artist, t);
+        }
+
+        if (album >= 0)
+        {
+            trackers[w + 2].add(album, t);
+        }
+    }
+}
+
+std::vector<TopItem> PlayStatistics::topSongs(StatsWindow window, std::int64_t now) const
+{
+    return tracker(window, 0).top(static_cast<double>(now));
+}
+
+std::vector<TopItem> PlayStatistics::topArtists(StatsWindow window, std::int64_t now) const
+{
+    return tracker(window, 1).top(static_cast<double>(now));
+}
+
+std::vector<TopItem> PlayStatistics::topAlbums(StatsWindow window, std::int64_t now) const
+{
+    return tracker(window, 2).top(static_cast<double>(now));
+}
+
+const std::string& PlayStatistics::artistName(int group) const
+{
+    return artists.names.at(group);
+}
+
+const std::string& PlayStatistics::albumName(int group) const
+{
+    return albums.names.at(group);
+}
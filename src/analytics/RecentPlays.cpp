@@ -0,0 +1,120 @@
+#include "RecentPlays.h"
+#include <algorithm>
+
+void RecentPlays::initialize(const MusicLibrary& library)
+{
+    int maxID = -1;
+
+    for (size_t i = 0; i < library.getSongCount(); ++i)
+    {
+        maxID = std::max(maxID, library.getSongByIndex(i).id);
+    }
+
+    entries.assign(static_cast<size_t>(maxID + 1), Entry { 0, 0 });
+    playCount = 0;
+}
+
+void RecentPlays::setWindow(std::uint32_t plays, std::int64_t seconds)
+{
+    windowPlays = plays;
+    windowSeconds = (seconds > 0) ? seconds : 0;
+}
+
+std::uint32_t RecentPlays::getWindowPlays() const
+{
+    return windowPlays;
+}
+
+std::int64_t RecentPlays::getWindowSeconds() const
+{
+    return windowSeconds;
+}
+
+bool RecentPlays::isActive() const
+{
+    return windowPlays > 0 || windowSeconds > 0;
+}
+
+void RecentPlays::recordPlay(int songID, std::int64_t now)
+{
+    if (songID < 0)
+    {
+        return;
+    }
+
+    if (static_cast<size_t>(songID) >= entries.size())
+    {
+        entries.resize(static_cast<size_t>(songID) + 1, Entry { 0, 0 });
+    }
+
+    /* Time 0 means "never", so a play at the epoch is nudged forward */
+    std::uint32_t playedAt = (now > 0) ? static_cast<std::uint32_t>(now) : 1;
+
+    entries[songID] = { playedAt, ++playCount };
+}
+
+void RecentPlays::load(const ListeningLog& log, std::int64_t now)
+{
+    for (Entry& entry : entries)
+    {
+        entry = { 0, 0 };
+    }
+
+    playCount = 0;
+
+    if (!isActive())
+    {
+        return;
+    }
+
+    /*
+     * Walk back until both the play window and the time window are
+     * covered, then replay forward so play numbers keep their order.
+     */
+    size_t first = log.size();
+    std::uint32_t taken = 0;
+
+    ListeningEvent event;
+
+    while (first > 0 && log.getEvent(first - 1, event))
+    {
+        bool playsCovered = taken >= windowPlays;
+        bool timeCovered = windowSeconds == 0 || event.timestamp <= now - windowSeconds;
+
+        if (playsCovered && timeCovered)
+        {
+            break;
+        }
+
+        --first;
+        ++taken;
+    }
+
+    for (size_t i = first; log.getEvent(i, event); ++i)
+    {
+        recordPlay(event.songID, event.timestamp);
+    }
+}
+
+bool RecentPlays::isRecent(int songID, std::int64_t now) const
+{
+    if (songID < 0 || static_cast<size_t>(songID) >= entries.size())
+    {
+        return false;
+    }
+
+    const Entry& entry = entries[songID];
+
+    if (entry.playedAt == 0)
+    {
+        return false;
+    }
+
+    /* Unsigned subtraction stays correct after playCount wraps */
+    if (playCount - entry.playNumber < windowPlays)
+    {
+        return true;
+    }
+
+    return windowSeconds > 0 && now - static_cast<std::int64_t>(entry.playedAt) < windowSeconds;
+}
@@ -1,4 +1,5 @@
 #include "MusicLibrary.h"
+#include "SongTags.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -48,6 +49,9 @@ void MusicLibrary::loadLibraryFromCSV(const std::string& filePath)
             /* Parse file path from the last column */
             std::getline(ss, song.path);
 
+            /* Tempo and key come from sample-pack style names */
+            tagSongFromName(song);
+
             addSong(song);
         }
         catch (const std::exception& e)
@@ -68,6 +72,7 @@ void MusicLibrary::addSong(const Song& song)
 {
     /* Store the song in the main container */
     songs.push_back(song);
+    ++version;
 }
 
 const Song& MusicLibrary::getSongByIndex(size_t index) const
@@ -94,6 +99,18 @@ Song* MusicLibrary::findSongByID(int id)
     return it->second;
 }
 
+const Song* MusicLibrary::findSongByID(int id) const
+{
+    auto it = songByID.find(id);
+
+    if (it == songByID.end())
+    {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
 Song* MusicLibrary::findSongByTitle(const std::string& title)
 {
     /* Locate a single song by its title */
@@ -139,6 +156,11 @@ size_t MusicLibrary::getSongCount() const
     return songs.size();
 }
 
+std::uint64_t MusicLibrary::getVersion() const
+{
+    return version;
+}
+
 void MusicLibrary::initializeSongByID()
 {
     /* Map IDs to song references */
@@ -0,0 +1,184 @@
+#include "SongTags.h"
+#include <cctype>
+#include <vector>
+
+/* Splits a name into tokens at '_', '-', ' ' and '.' */
+static std::vector<std::string> tokenize(const std::string& name)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+
+    for (char c : name)
+    {
+        if (c == '_' || c == '-' || c == ' ' || c == '.')
+        {
+            if (!token.empty())
+            {
+                tokens.push_back(token);
+                token.clear();
+            }
+        }
+        else
+        {
+            token += c;
+        }
+    }
+
+    if (!token.empty())
+    {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+/* Reads a tempo token; false unless it is a plausible BPM */
+static bool parseTempo(const std::string& token, int& bpm)
+{
+    if (token.empty() || token.size() > 3 || token[0] == '0')
+    {
+        return false;
+    }
+
+    int value = 0;
+
+    for (char c : token)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+        {
+            return false;
+        }
+
+        value = value * 10 + (c - '0');
+    }
+
+    if (value < MIN_BPM || value > MAX_BPM)
+    {
+        return false;
+    }
+
+    bpm = value;
+    return true;
+}
+
+bool parseKey(const std::string& token, CamelotKey& key)
+{
+    /* Pitch class of each natural note, C = 0 */
+    static const int NOTE_PITCH[] = { 9, 11, 0, 2, 4, 5, 7 };    /* A B C D E F G */
+
+    if (token.empty() || token[0] < 'A' || token[0] > 'G')
+    {
+        return false;
+    }
+
+    int pitch = NOTE_PITCH[token[0] - 'A'];
+    size_t i = 1;
+
+    if (i < token.size() && token[i] == '#')
+    {
+        pitch += 1;
+        ++i;
+    }
+    else if (i < token.size() && token[i] == 'b')
+    {
+        pitch += 11;
+        ++i;
+    }
+
+    /* A bare "M" is left out: "FM" is far more often a synth than F minor */
+    std::string mode;
+
+    for (; i < token.size(); ++i)
+    {
+        mode += static_cast<char>(std::tolower(static_cast<unsigned char>(token[i])));
+    }
+
+    bool major;
+
+    if (mode.empty() || mode == "maj" || mode == "major")
+    {
+        major = true;
+    }
+    else if ((mode == "m" && token.back() == 'm') || mode == "min" || mode == "minor")
+    {
+        major = false;
+    }
+    else
+    {
+        return false;
+    }
+
+    /*
+     * 8B is C major and each step clockwise is a fifth up; a minor key
+     * shares the number of its relative major, three semitones above.
+     */
+    int majorPitch = major ? pitch % 12 : (pitch + 3) % 12;
+
+    key.number = (majorPitch * 7 + 7) % 12 + 1;
+    key.major = major;
+    return true;
+}
+
+bool parseTempoAndKey(const std::string& name, int& bpm, CamelotKey& key)
+{
+    bool foundTempo = false;
+    bool foundKey = false;
+
+    for (const std::string& token : tokenize(name))
+    {
+        if (!foundTempo && parseTempo(token, bpm))
+        {
+            foundTempo = true;
+        }
+        else if (!foundKey && parseKey(token, key))
+        {
+            foundKey = true;
+        }
+    }
+
+    return foundTempo || foundKey;
+}
+
+void tagSongFromName(Song& song)
+{
+    parseTempoAndKey(song.title, song.bpm, song.key);
+
+    if (song.bpm != 0 && song.key.number != 0)
+    {
+        return;
+    }
+
+    /* File name without folders and extension */
+    size_t slash = song.path.find_last_of("\\/");
+    std::string file = song.path.substr((slash == std::string::npos) ? 0 : slash + 1);
+    size_t dot = file.rfind('.');
+
+    if (dot != std::string::npos)
+    {
+        file.erase(dot);
+    }
+
+    int bpm = 0;
+    CamelotKey key;
+    parseTempoAndKey(file, bpm, key);
+
+    if (song.bpm == 0)
+    {
+        song.bpm = bpm;
+    }
+
+    if (song.key.number == 0)
+    {
+        song.key = key;
+    }
+}
+
+std::string camelotName(const CamelotKey& key)
+{
+    if (key.number == 0)
+    {
+        return "-";
+    }
+
+    return std::to_string(key.number) + (key.major ? "B" : "A");
+}
@@ -2,8 +2,10 @@
 #include <string>
 #include <limits>
 #include <iomanip>
+#include <random>
 
 #include "MusicPlayer.h"
+#include "SongTags.h"
 
 /*
  * Print full song details in a readable format
@@ -21,9 +23,25 @@ void printSongDetails(const Song* s)
     std::cout << " Artist   : " << s->artist << "\n";
     std::cout << " Album    : " << s->album << "\n";
     std::cout << " Duration : " << s->duration << " s\n";
+
+    if (s->bpm != 0 || s->key.number != 0)
+    {
+        std::cout << " Tempo    : " << s->bpm << " BPM, key " << camelotName(s->key) << "\n";
+    }
+
     std::cout << "------------------------------------------------------------\n";
 }
 
+/*
+ * Map a menu choice (1-3) to a Play Next lane
+ */
+PlayNextLane laneFromChoice(int choice)
+{
+    return (choice == 1) ? PlayNextLane::Urgent
+         : (choice == 3) ? PlayNextLane::Suggested
+         : PlayNextLane::Requested;
+}
+
 /*
  * Display the interactive menu
  */
@@ -48,9 +66,16 @@ void printMenu()
     std::cout << " 19. Find by Artist         20. Find by Album\n";
 
     std::cout << "\n [ ADVANCED ]\n";
-    std::cout << " 21. Enable Smart Playlist (BFS)\n";
-    std::cout << " 22. Disable Smart Playlist (BFS)\n";
+    std::cout << " 21. Enable Smart Playlist\n";
+    std::cout << " 22. Disable Smart Playlist\n";
     std::cout << " 23. Enable Repeat          24. Disable Repeat\n";
+    std::cout << " 25. View Up Next           26. Most Played\n";
+    std::cout << " 27. Cancel Play Next       28. Change Play Next Priority\n";
+    std::cout << " 29. Recently Played Window 30. Smart Mix from Recent Plays\n";
+    std::cout << " 31. Start Smart Radio      32. Stop Smart Radio\n";
+    std::cout << " 33. Timed Playlist         34. Batch Playlist Benchmark\n";
+    std::cout << " 35. Analyze Song Audio     36. Similar Sounding Songs\n";
+    std::cout << " 37. Play Next Stress Test\n";
     std::cout << "===================================================\n";
     std::cout << "Select option: ";
 }
@@ -140,18 +165,7 @@ int main()
                 std::cout << "Enter Song ID to add: ";
                 std::cin >> id;
 
-                Song* s = player.getLibrary().findSongByID(id);
-
-                if (s)
-                {
-                    player.getPlaybackQueue().addSong(*s);
-                    std::cout << "Added '" << s->title << "' to queue.\n";
-                }
-                else
-                {
-                    std::cout << "Song ID not found.\n";
-                }
-
+                player.addSongToQueue(id);
                 break;
             }
 
@@ -162,28 +176,13 @@ int main()
                 std::cout << "Enter Album name: ";
                 std::getline(std::cin, album);
 
-                addAlbumToQueue(album, player.getLibrary(),player.getPlaybackQueue());
+                player.addAlbumToQueue(album);
                 break;
             }
 
             case 9:
             {
-                std::vector<Song>& allSongs = player.getLibrary().getSongs();
-
-                if (allSongs.empty())
-                {
-                    std::cout << "Library is empty.\n";
-                }
-                else
-                {
-                    for (Song& s : allSongs)
-                    {
-                        player.getPlaybackQueue().addSong(s);
-                    }
-
-                    std::cout << "Added " << allSongs.size() << " songs to queue.\n";
-                }
-
+                player.addLibraryToQueue();
                 break;
             }
 
@@ -194,7 +193,7 @@ int main()
                 std::cout << "Enter Song ID to remove: ";
                 std::cin >> id;
 
-                player.getPlaybackQueue().removeSongById(id);
+                player.removeSongFromQueue(id);
                 std::cout << "Remove request processed.\n";
                 break;
             }
@@ -217,10 +216,15 @@ int main()
             {
                 int id;
 
+                int lane;
+
                 std::cout << "Enter Song ID to add to Play Next: ";
                 std::cin >> id;
 
-                player.addSongToPlayNext(id);
+                std::cout << "Priority (1 = urgent, 2 = requested, 3 = suggested): ";
+                std::cin >> lane;
+
+                player.addSongToPlayNext(id, laneFromChoice(lane));
                 break;
             }
 
@@ -233,7 +237,37 @@ int main()
 
             case 15:
             {
-                player.enableShuffle();
+                int mode;
+
+                std::cout << "Mode (1 = random, 2 = seeded, 3 = seeded with a given seed, 4 = artist spread, 5 = favourites): ";
+                std::cin >> mode;
+
+                if (mode == 1)
+                {
+                    player.enableShuffle(ShuffleMode::Random);
+                }
+                else if (mode == 4)
+                {
+                    player.enableShuffle(ShuffleMode::Spread);
+                }
+                else if (mode == 5)
+                {
+                    player.enableShuffle(ShuffleMode::Weighted);
+                }
+                else if (mode == 3)
+                {
+                    std::uint64_t seed;
+
+                    std::cout << "Enter seed: ";
+                    std::cin >> seed;
+
+                    player.enableShuffleWithSeed(seed);
+                }
+                else
+                {
+                    player.enableShuffle(ShuffleMode::Seeded);
+                }
+
                 break;
             }
 
@@ -339,7 +373,15 @@ int main()
                 std::cout << "Max Playlist Size: ";
                 std::cin >> maxSize;
 
-                player.enableSmartPlaylist(startID, maxSize);
+                int mode;
+
+                std::cout << "Mode (1 = best match, 2 = breadth-first, 3 = harmonic mix): ";
+                std::cin >> mode;
+
+                player.enableSmartPlaylist(startID, maxSize,
+                                           (mode == 2) ? SmartPlaylistMode::Breadth
+                                         : (mode == 3) ? SmartPlaylistMode::Harmonic
+                                         : SmartPlaylistMode::BestFirst);
                 break;
             }
 
@@ -361,6 +403,276 @@ int main()
                 break;
             }
 
+            case 25:
+            {
+                std::cout << "\n--- UP NEXT ---\n";
+
+                for (const UpcomingSong& next : player.peekUpcoming(10))
+                {
+                    const char* source = next.source == UpcomingSource::Repeat   ? "Repeat"
+                                       : next.source == UpcomingSource::PlayNext ? "Play Next"
+                                       : next.source == UpcomingSource::Radio    ? "Radio"
+                                       : "Queue";
+
+                    std::cout << "[" << source << "] " << next.song.id
+                              << " - " << next.song.title << "\n";
+                }
+
+                break;
+            }
+
+            case 26:
+            {
+                int window;
+
+                std::cout << "Window (1 = hour, 2 = day, 3 = week): ";
+                std::cin >> window;
+
+                StatsWindow statsWindow = (window == 1) ? StatsWindow::Hour
+                                        : (window == 2) ? StatsWindow::Day
+                                        : StatsWindow::Week;
+
+                player.printMostPlayed(statsWindow, 10);
+                break;
+            }
+
+            case 27:
+            {
+                int id;
+
+                std::cout << "Enter Song ID to remove from Play Next: ";
+                std::cin >> id;
+
+                player.cancelPlayNext(id);
+                break;
+            }
+
+            case 28:
+            {
+                int id;
+                int lane;
+
+                std::cout << "Enter Song ID: ";
+                std::cin >> id;
+
+                std::cout << "New priority (1 = urgent, 2 = requested, 3 = suggested): ";
+                std::cin >> lane;
+
+                player.setPlayNextLane(id, laneFromChoice(lane));
+                break;
+            }
+
+            case 29:
+            {
+                long long plays;
+                long long hours;
+
+                /* Read signed values so that "-1" is rejected instead of wrapping around */
+                std::cout << "Hold back songs from the last N plays (0 = off): ";
+
+                if (!(std::cin >> plays) || plays < 0 || plays > std::numeric_limits<std::uint32_t>::max())
+                {
+                    std::cin.clear();
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cerr << "[Error] Number of plays must be a whole number from 0 to "
+                              << std::numeric_limits<std::uint32_t>::max() << ".\n";
+                    break;
+                }
+
+                std::cout << "...or played in the last M hours (0 = off): ";
+
+                if (!(std::cin >> hours) || hours < 0 || hours > std::numeric_limits<std::int64_t>::max() / 3600)
+                {
+                    std::cin.clear();
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cerr << "[Error] Number of hours must be a whole number of 0 or more.\n";
+                    break;
+                }
+
+                player.setRecentlyPlayedWindow(static_cast<std::uint32_t>(plays), static_cast<std::int64_t>(hours) * 3600);
+                std::cout << "Recently played window updated.\n";
+                break;
+            }
+
+            case 30:
+            {
+                size_t seedCount;
+                int maxSize;
+
+                std::cout << "Number of recent songs to seed from: ";
+                std::cin >> seedCount;
+
+                std::cout << "Max Playlist Size: ";
+                std::cin >> maxSize;
+
+                player.enableSmartMixFromHistory(seedCount, maxSize);
+                break;
+            }
+
+            case 31:
+            {
+                int startID;
+
+                std::cout << "Start Song ID: ";
+                std::cin >> startID;
+
+                player.enableSmartRadio(startID);
+                break;
+            }
+
+            case 32:
+            {
+                player.disableSmartRadio();
+                break;
+            }
+
+            case 33:
+            {
+                int startID;
+                int minutes;
+                int tolerance;
+                std::string artist;
+
+                std::cout << "Start Song ID (0 = whole library): ";
+                std::cin >> startID;
+
+                std::cout << "Length in Minutes: ";
+                std::cin >> minutes;
+
+                std::cout << "Tolerance in Seconds: ";
+                std::cin >> tolerance;
+
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+                std::cout << "Only Artist (empty = any): ";
+                std::getline(std::cin, artist);
+
+                if (artist.empty())
+                {
+                    player.enableTimedPlaylist(startID, minutes * 60, tolerance);
+                }
+                else
+                {
+                    player.enableTimedPlaylist(startID, minutes * 60, tolerance,
+                                               [&artist](const Song& song) { return song.artist == artist; });
+                }
+
+                break;
+            }
+
+            case 34:
+            {
+                /* Every job and its playlist are held in memory until the batch ends */
+                constexpr long long MAX_JOBS = 1000000;
+
+                long long jobCount;
+                int maxSize;
+                int mode;
+                int shuffle;
+
+                /* Read a signed value so that "-1" is rejected instead of wrapping around */
+                std::cout << "Number of Playlists: ";
+
+                if (!(std::cin >> jobCount) || jobCount < 1 || jobCount > MAX_JOBS)
+                {
+                    std::cin.clear();
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cerr << "[Error] Number of playlists must be a whole number from 1 to " << MAX_JOBS << ".\n";
+                    break;
+                }
+
+                std::cout << "Playlist Size: ";
+                std::cin >> maxSize;
+
+                std::cout << "Mode (1 = best match, 2 = breadth-first, 3 = harmonic mix): ";
+                std::cin >> mode;
+
+                std::cout << "Shuffle each playlist (1 = yes, 0 = no): ";
+                std::cin >> shuffle;
+
+                const MusicLibrary& library = player.getLibrary();
+
+                if (library.getSongCount() == 0)
+                {
+                    std::cout << "Library is empty.\n";
+                    break;
+                }
+
+                /* Random seeds stand in for user profiles */
+                std::mt19937_64 gen(std::random_device {}());
+                std::vector<PlaylistJob> jobs(static_cast<size_t>(jobCount));
+
+                for (PlaylistJob& job : jobs)
+                {
+                    job.seedID = library.getSongByIndex(gen() % library.getSongCount()).id;
+                    job.size = maxSize;
+                    job.mode = (mode == 2) ? SmartPlaylistMode::Breadth
+                             : (mode == 3) ? SmartPlaylistMode::Harmonic
+                             : SmartPlaylistMode::BestFirst;
+                    job.shuffleSeed = (shuffle == 1) ? (gen() | 1) : 0;
+                }
+
+                std::vector<std::vector<std::uint32_t>> playlists;
+                BatchReport report = player.generatePlaylistBatch(jobs, playlists);
+
+                std::cout << report.jobs << " playlists (" << report.failed << " failed, "
+                          << report.songs << " songs) on " << report.threads << " threads in "
+                          << static_cast<long long>(report.seconds * 1000) << " ms: "
+                          << static_cast<long long>(report.jobsPerSecond) << " playlists/s\n";
+                break;
+            }
+
+            case 35:
+            {
+                player.analyzeLibraryAudio();
+                break;
+            }
+
+            case 36:
+            {
+                int songID;
+                size_t count;
+
+                std::cout << "Song ID: ";
+                std::cin >> songID;
+
+                std::cout << "Number of Songs: ";
+                std::cin >> count;
+
+                player.printSimilarSounding(songID, count);
+                break;
+            }
+
+            case 37:
+            {
+                size_t producers;
+                size_t songsPerProducer;
+
+                std::cout << "Number of Producer Threads: ";
+                std::cin >> producers;
+
+                std::cout << "Songs per Producer: ";
+                std::cin >> songsPerProducer;
+
+                PlayNextStressReport report = stressPlayNextQueue(producers, songsPerProducer);
+
+                std::cout << report.songs << " songs from " << report.producers << " producers in "
+                          << static_cast<long long>(report.seconds * 1000) << " ms: "
+                          << static_cast<long long>(report.songsPerSecond) << " songs/s, "
+                          << report.fullRetries << " full retries\n";
+
+                if (report.lost + report.duplicated + report.reordered == 0)
+                {
+                    std::cout << "Every song arrived once and in order.\n";
+                }
+                else
+                {
+                    std::cerr << "[Error] " << report.lost << " lost, " << report.duplicated << " duplicated, "
+                              << report.reordered << " out of order.\n";
+                }
+                break;
+            }
+
             default:
             {
                 std::cout << "Invalid option. Please try again.\n";
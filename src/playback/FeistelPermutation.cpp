@@ -0,0 +1,59 @@
+#include "FeistelPermutation.h"
+
+/* SplitMix64 finalizer, used both to derive keys and as round function */
+static std::uint64_t mix(std::uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+FeistelPermutation::FeistelPermutation(std::uint64_t size, std::uint64_t seed)
+    : domain(size)
+{
+    /* Smallest 2 * halfBits covering the domain */
+    while (halfBits < 32 && (static_cast<std::uint64_t>(1) << (2 * halfBits)) < size)
+    {
+        ++halfBits;
+    }
+
+    halfMask = (static_cast<std::uint64_t>(1) << halfBits) - 1;
+
+    for (size_t r = 0; r < ROUNDS; ++r)
+    {
+        roundKeys[r] = mix(seed + (r + 1) * 0x9E3779B97F4A7C15ull);
+    }
+}
+
+std::uint64_t FeistelPermutation::encrypt(std::uint64_t value) const
+{
+    std::uint64_t left = value >> halfBits;
+    std::uint64_t right = value & halfMask;
+
+    for (size_t r = 0; r < ROUNDS; ++r)
+    {
+        std::uint64_t next = left ^ (mix(right ^ roundKeys[r]) & halfMask);
+        left = right;
+        right = next;
+    }
+
+    return (left << halfBits) | right;
+}
+
+std::uint64_t FeistelPermutation::operator()(std::uint64_t index) const
+{
+    /* The network is a bijection, so walking from an in-range value ends in range */
+    std::uint64_t value = encrypt(index);
+
+    while (value >= domain)
+    {
+        value = encrypt(value);
+    }
+
+    return value;
+}
+
+std::uint64_t FeistelPermutation::size() const
+{
+    return domain;
+}
@@ -1,54 +1,279 @@
 #include "PlayNextQueue.h"
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <thread>
 
-void PlayNextQueue::addSong(const Song& song)
+PlayNextQueue::PlayNextQueue(size_t capacity)
 {
-    /* Append a new song to the end of the FIFO queue */
-    queue.push(song);
+    /* Round up to a power of two so positions map to slots with a mask */
+    size_t slots = 2;
+
+    while (slots < capacity)
+    {
+        slots <<= 1;
+    }
+
+    cells.reset(new Cell[slots]);
+    mask = slots - 1;
+
+    /* Slot i is free for the producer that claims position i */
+    for (size_t i = 0; i < slots; ++i)
+    {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+        cells[i].song = nullptr;
+    }
+}
+
+bool PlayNextQueue::addSong(const Song& song)
+{
+    size_t pos = tail.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        Cell& cell = cells[pos & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+        if (diff == 0)
+        {
+            /* Slot is free for this position; try to claim it */
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.song = &song;
+
+                /* Publish the slot to the consumer */
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The consumer has not freed this slot yet: queue is full */
+            return false;
+        }
+        else
+        {
+            /* Another producer claimed this position; retry with a fresh one */
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
 }
 
 Song PlayNextQueue::playNext()
 {
+    const Song* song = pop();
+
     /* Notify user if attempting to play from an empty queue */
-    if (queue.empty())
+    if (song == nullptr)
     {
         std::cout << "PlayNext queue is empty";
+        return Song();
     }
 
     /* Retrieve the song at the front of the queue */
-    Song nextSong = queue.front();
-    
-    /* Remove the retrieved song from the queue */
-    queue.pop();
+    return *song;
+}
+
+const Song* PlayNextQueue::pop()
+{
+    size_t pos = head.load(std::memory_order_relaxed);
+    Cell& cell = cells[pos & mask];
+
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+    {
+        return nullptr;
+    }
 
-    return nextSong;
+    const Song* song = cell.song;
+
+    /* Hand the slot back to producers one lap later */
+    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+    head.store(pos + 1, std::memory_order_release);
+
+    return song;
 }
 
 bool PlayNextQueue::isEmpty() const
 {
-    /* Check if there are any songs remaining in the queue */
-    return queue.empty();
+    /* Check if the front slot holds a published song */
+    return peek(0) == nullptr;
 }
 
-void PlayNextQueue::printAllSongs() const
+size_t PlayNextQueue::size() const
 {
-    /* Copy the queue to a temporary container for non-destructive iteration */
-    std::queue<Song> tempQueue = queue;
+    size_t front = head.load(std::memory_order_acquire);
+    size_t back = tail.load(std::memory_order_acquire);
+
+    return (back > front) ? back - front : 0;
+}
+
+size_t PlayNextQueue::capacity() const
+{
+    return mask + 1;
+}
+
+const Song* PlayNextQueue::peek(size_t offset) const
+{
+    size_t front = head.load(std::memory_order_acquire);
+
+    if (offset > mask)
+    {
+        return nullptr;
+    }
+
+    size_t pos = front + offset;
+    const Cell& cell = cells[pos & mask];
 
-    while (!tempQueue.empty())
+    /* A claimed but not yet published slot counts as empty */
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+    {
+        return nullptr;
+    }
+
+    return cell.song;
+}
+
+void PlayNextQueue::printAllSongs() const
+{
+    /* Walk published slots in place; nothing is copied */
+    for (size_t i = 0; const Song* song = peek(i); ++i)
     {
-        /* Access the current front song for display */
-        const Song& song = tempQueue.front();
-        
         /* Output formatted song details to the console */
-        std::cout << "ID: " << song.id
-                  << " | Title: " << song.title
-                  << " | Artist: " << song.artist
-                  << " | Album: " << song.album
-                  << " | Duration: " << song.duration << " s"
+        std::cout << "ID: " << song->id
+                  << " | Title: " << song->title
+                  << " | Artist: " << song->artist
+                  << " | Album: " << song->album
+                  << " | Duration: " << song->duration << " s"
                   << '\n';
-                  
-        /* Remove the processed song from the temporary copy */
-        tempQueue.pop();
     }
-}
\ No newline at end of file
+}
+
+std::vector<int> PlayNextQueue::getSongIDs() const
+{
+    std::vector<int> ids;
+
+    for (size_t i = 0; const Song* song = peek(i); ++i)
+    {
+        ids.push_back(song->id);
+    }
+
+    return ids;
+}
+
+PlayNextStressReport stressPlayNextQueue(size_t producers, size_t songsPerProducer, size_t capacity)
+{
+    PlayNextStressReport report;
+    report.producers = producers;
+    report.songs = producers * songsPerProducer;
+
+    if (report.songs == 0)
+    {
+        return report;
+    }
+
+    /* Song i * songsPerProducer + k is the k-th song of producer i */
+    std::vector<Song> songs(report.songs);
+
+    for (size_t i = 0; i < songs.size(); ++i)
+    {
+        songs[i].id = static_cast<int>(i);
+    }
+
+    PlayNextQueue queue(capacity);
+    std::atomic<bool> start {false};
+    std::atomic<size_t> fullRetries {0};
+    std::atomic<size_t> finished {0};
+    std::vector<std::thread> threads;
+
+    threads.reserve(producers);
+
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]()
+        {
+            size_t retries = 0;
+
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+
+            for (size_t k = 0; k < songsPerProducer; ++k)
+            {
+                while (!queue.addSong(songs[p * songsPerProducer + k]))
+                {
+                    ++retries;
+                    std::this_thread::yield();
+                }
+            }
+
+            fullRetries += retries;
+            finished.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    /* Times each song came out, and the next song expected from each producer */
+    std::vector<std::uint8_t> popped(report.songs, 0);
+    std::vector<size_t> nextOf(producers, 0);
+    size_t received = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+
+    /*
+     * Stop once every song arrived, or when the queue is empty after all
+     * producers returned: their adds are published by then, so whatever
+     * is missing was lost.
+     */
+    while (received < report.songs)
+    {
+        bool producersDone = finished.load(std::memory_order_acquire) == producers;
+        const Song* song = queue.pop();
+
+        if (song == nullptr)
+        {
+            if (producersDone)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        size_t id = static_cast<size_t>(song->id);
+        size_t producer = id / songsPerProducer;
+        size_t sequence = id % songsPerProducer;
+
+        if (popped[id]++ != 0)
+        {
+            ++report.duplicated;
+        }
+        else if (sequence != nextOf[producer])
+        {
+            ++report.reordered;
+        }
+
+        nextOf[producer] = sequence + 1;
+        ++received;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (std::uint8_t count : popped)
+    {
+        report.lost += (count == 0) ? 1 : 0;
+    }
+
+    report.fullRetries = fullRetries.load();
+    report.seconds = std::chrono::duration<double>(end - begin).count();
+    report.songsPerSecond = (report.seconds > 0.0) ? static_cast<double>(received) / report.seconds : 0.0;
+
+    return report;
+}
@@ -1,80 +1,184 @@
 #include "PlaybackHistory.h"
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
-/* Limit history size to avoid performance issues with stack operations */
-static const size_t MAX_HISTORY_SIZE = 200;
+PlaybackHistory::PlaybackHistory(size_t capacity) : capacity(0)
+{
+    relayout(capacity);
+}
 
-void PlaybackHistory::pushSong(const Song& song)
+size_t PlaybackHistory::slotAt(size_t offset) const
+{
+    size_t slot = tail + offset;
+    return (slot >= ring.size()) ? slot - ring.size() : slot;
+}
+
+void PlaybackHistory::evictOldest()
 {
-    std::stack<Song> tempStack;
+    /* Skip tombstones left at the old end of the ring */
+    while (!ring[tail].live)
+    {
+        tail = slotAt(1);
+        --used;
+    }
 
-    /* Filter out duplicates by moving non-matching songs to temp stack */
-    while (!history.empty())
+    slotByID.erase(ring[tail].song.id);
+    ring[tail].live = false;
+
+    tail = slotAt(1);
+    --used;
+    --liveCount;
+}
+
+void PlaybackHistory::relayout(size_t newCapacity)
+{
+    /* A history that cannot hold one song would make "Back" useless */
+    if (newCapacity == 0)
     {
-        Song current = history.top();
-        history.pop();
+        newCapacity = 1;
+    }
+
+    std::vector<Slot> oldRing;
+    oldRing.swap(ring);
+
+    size_t oldTail = tail;
+    size_t oldUsed = used;
+
+    /* Keep only the newest songs that fit into the new capacity */
+    size_t skip = (liveCount > newCapacity) ? liveCount - newCapacity : 0;
 
-        if (current.id != song.id)
+    ring.assign(2 * newCapacity, Slot());
+    capacity = newCapacity;
+    tail = 0;
+    used = 0;
+    liveCount = 0;
+    slotByID.clear();
+
+    for (size_t i = 0; i < oldUsed; ++i)
+    {
+        Slot& slot = oldRing[(oldTail + i) % oldRing.size()];
+
+        if (!slot.live)
+        {
+            continue;
+        }
+
+        if (skip > 0)
         {
-            tempStack.push(current);
+            --skip;
+            continue;
         }
+
+        ring[used].song = std::move(slot.song);
+        ring[used].live = true;
+        slotByID[ring[used].song.id] = used;
+        ++used;
+        ++liveCount;
+    }
+}
+
+void PlaybackHistory::setCapacity(size_t newCapacity)
+{
+    relayout(newCapacity);
+}
+
+size_t PlaybackHistory::getCapacity() const
+{
+    return capacity;
+}
+
+size_t PlaybackHistory::size() const
+{
+    return liveCount;
+}
+
+void PlaybackHistory::pushSong(const Song& song)
+{
+    /* Remove an earlier occurrence by turning its slot into a tombstone */
+    auto found = slotByID.find(song.id);
+
+    if (found != slotByID.end())
+    {
+        ring[found->second].live = false;
+        slotByID.erase(found);
+        --liveCount;
     }
 
-    /* Enforce size limit by trimming oldest entries from temp stack */
-    while (tempStack.size() >= MAX_HISTORY_SIZE)
+    /* Enforce size limit by evicting the oldest entry */
+    while (liveCount >= capacity)
     {
-        tempStack.pop(); 
+        evictOldest();
     }
 
-    /* Restore filtered history back to main stack */
-    while (!tempStack.empty())
+    /* Ring full of tombstones: squeeze them out, amortized O(1) */
+    if (used == ring.size())
     {
-        history.push(tempStack.top());
-        tempStack.pop();
+        relayout(capacity);
     }
 
     /* Add new song to the top */
-    history.push(song);
+    size_t slot = slotAt(used);
+
+    ring[slot].song = song;
+    ring[slot].live = true;
+    slotByID[song.id] = slot;
+
+    ++used;
+    ++liveCount;
 }
 
 Song PlaybackHistory::playPreviousSong()
 {
-    /* Prevent undefined behavior when accessing empty stack */
-    if (history.empty())
+    /* Prevent undefined behavior when accessing empty history */
+    if (liveCount == 0)
     {
         throw std::runtime_error("Playback history is empty");
     }
 
-    Song previousSong = history.top();
-    history.pop();
+    /* Skip tombstones at the newest end of the ring */
+    while (!ring[slotAt(used - 1)].live)
+    {
+        --used;
+    }
+
+    Slot& top = ring[slotAt(used - 1)];
+
+    slotByID.erase(top.song.id);
+    top.live = false;
+    --used;
+    --liveCount;
 
-    return previousSong;
+    return std::move(top.song);
 }
 
 bool PlaybackHistory::isEmpty() const
 {
-    return history.empty();
+    return liveCount == 0;
 }
 
 void PlaybackHistory::printHistory() const
 {
-    /* Use a copy to iterate without modifying the actual stack */
-    std::stack<Song> tempStack = history;
-
-    if (tempStack.empty())
+    if (liveCount == 0)
     {
         std::cout << "Playback history is empty.\n";
         return;
     }
 
-    std::cout << "--- Recent Playback History (Max " << MAX_HISTORY_SIZE << ") ---\n";
+    std::cout << "--- Recent Playback History (Max " << capacity << ") ---\n";
 
     /* Display from Most Recent (top) to Oldest (bottom) */
-    while (!tempStack.empty())
+    for (size_t i = used; i > 0; --i)
     {
-        const Song& song = tempStack.top();
-        
+        const Slot& slot = ring[slotAt(i - 1)];
+
+        if (!slot.live)
+        {
+            continue;
+        }
+
+        const Song& song = slot.song;
+
         /* Format output for each song entry */
         std::cout << "ID: " << song.id
                   << " | Title: " << song.title
@@ -82,7 +186,23 @@ void PlaybackHistory::printHistory() const
                   << " | Album: " << song.album
                   << " | Duration: " << song.duration << " s"
                   << '\n';
-        
-        tempStack.pop();
     }
-}
\ No newline at end of file
+}
+
+std::vector<int> PlaybackHistory::getSongIDs() const
+{
+    std::vector<int> ids;
+    ids.reserve(liveCount);
+
+    for (size_t i = 0; i < used; ++i)
+    {
+        const Slot& slot = ring[slotAt(i)];
+
+        if (slot.live)
+        {
+            ids.push_back(slot.song.id);
+        }
+    }
+
+    return ids;
+}
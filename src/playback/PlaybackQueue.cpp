@@ -4,17 +4,21 @@
 void PlaybackQueue::addSong(const Song& song)
 {
     /* Avoid duplicates by checking if the song ID already exists in queue */
-    for (const auto& s : queue)
+    if (songIndex.count(song.id) != 0)
     {
-        if (s.id == song.id)
-        {
-            /* Exit if song is already present */
-            return;
-        }
+        /* Exit if song is already present */
+        return;
     }
 
     queue.push_back(song);
 
+    /* Register the new node in the ID index and the timeline */
+    auto node = std::prev(queue.end());
+    size_t slot = timeline.append(song.duration);
+
+    setSlotNode(slot, node);
+    songIndex[song.id] = IndexEntry { node, slot };
+
     /* Set the first added song as the current playback entry */
     if (queue.size() == 1)
     {
@@ -22,28 +26,76 @@ void PlaybackQueue::addSong(const Song& song)
     }
 }
 
+void PlaybackQueue::insertSong(const Song& song, size_t position)
+{
+    /* Avoid duplicates by checking if the song ID already exists in queue */
+    if (songIndex.count(song.id) != 0)
+    {
+        return;
+    }
+
+    if (position > queue.size())
+    {
+        position = queue.size();
+    }
+
+    /* The node currently at the position is the one to insert before */
+    bool takesCurrent = (current != queue.end() && position == getCurrentIndex());
+    auto target = (position < queue.size()) ? slotNodes[timeline.slotAtPosition(position)] : queue.end();
+
+    auto node = queue.insert(target, song);
+    size_t slot = timeline.insertAt(position, song.duration);
+
+    setSlotNode(slot, node);
+    songIndex[song.id] = IndexEntry { node, slot };
+
+    if (takesCurrent || queue.size() == 1)
+    {
+        current = node;
+    }
+}
+
+void PlaybackQueue::setSlotNode(size_t slot, std::list<Song>::iterator node)
+{
+    if (slot >= slotNodes.size())
+    {
+        slotNodes.resize(slot + 1);
+    }
+
+    slotNodes[slot] = node;
+}
+
+void PlaybackQueue::reserve(size_t count)
+{
+    songIndex.reserve(count);
+    slotNodes.reserve(count);
+}
+
 void PlaybackQueue::removeSongById(int songId)
 {
-    for (auto it = queue.begin(); it != queue.end(); ++it)
+    /* Locate the node directly through the ID index */
+    auto found = songIndex.find(songId);
+
+    if (found != songIndex.end())
     {
-        if (it->id == songId)
+        auto it = found->second.node;
+
+        timeline.erase(found->second.slot);
+        songIndex.erase(found);
+
+        /* Safeguard current iterator if it points to the song being removed */
+        if (it == current)
+        {
+            auto next = std::next(it);
+            queue.erase(it);
+
+            /* Point to next available song or wrap around to the beginning */
+            current = (next != queue.end()) ? next : queue.begin();
+        }
+        else
         {
-            /* Safeguard current iterator if it points to the song being removed */
-            if (it == current)
-            {
-                auto next = std::next(it);
-                queue.erase(it);
-
-                /* Point to next available song or wrap around to the beginning */
-                current = (next != queue.end()) ? next : queue.begin();
-            }
-            else
-            {
-                /* Remove non-active song without affecting current pointer */
-                queue.erase(it);
-            }
-
-            break;
+            /* Remove non-active song without affecting current pointer */
+            queue.erase(it);
         }
     }
 
@@ -54,6 +106,38 @@ void PlaybackQueue::removeSongById(int songId)
     }
 }
 
+bool PlaybackQueue::moveSong(int songId, size_t position)
+{
+    auto found = songIndex.find(songId);
+
+    if (found == songIndex.end())
+    {
+        return false;
+    }
+
+    auto node = found->second.node;
+    size_t last = queue.size() - 1;
+
+    if (position > last)
+    {
+        position = last;
+    }
+
+    /* Take the song out of the timeline; positions now exclude it */
+    timeline.erase(found->second.slot);
+
+    /* Find the node the moved song must be inserted before */
+    auto target = (position < last) ? slotNodes[timeline.slotAtPosition(position)] : queue.end();
+
+    /* Relink the node; iterators, including current, stay valid */
+    queue.splice(target, queue, node);
+
+    found->second.slot = timeline.insertAt(position, node->duration);
+    setSlotNode(found->second.slot, node);
+
+    return true;
+}
+
 const Song& PlaybackQueue::getCurrentSong()
 {
     /* Warning message if current song is accessed on empty queue */
@@ -102,30 +186,144 @@ void addAlbumToQueue(std::string& albumName,
     }
 }
 
-PlaybackQueue::PlaybackQueue(const PlaybackQueue& other) : queue(other.queue)
+size_t PlaybackQueue::size() const
 {
-    /* Preserve playback position by copying iterator offset */
-    if (other.current == other.queue.end())
+    return queue.size();
+}
+
+size_t PlaybackQueue::getCurrentIndex() const
+{
+    if (current == queue.end())
+    {
+        return queue.size();
+    }
+
+    /* Position equals the number of live slots before the current one */
+    return timeline.countBefore(songIndex.at(current->id).slot);
+}
+
+void PlaybackQueue::setCurrentIndex(size_t index)
+{
+    /* Clear the current song when the position does not exist */
+    if (index >= queue.size())
     {
         current = queue.end();
+        return;
+    }
+
+    current = slotNodes[timeline.slotAtPosition(index)];
+}
+
+std::vector<int> PlaybackQueue::getSongIDs() const
+{
+    std::vector<int> ids;
+    ids.reserve(queue.size());
+
+    for (const auto& song : queue)
+    {
+        ids.push_back(song.id);
     }
-    else
+
+    return ids;
+}
+
+void PlaybackQueue::peekUpcoming(size_t count, std::vector<const Song*>& out) const
+{
+    if (queue.empty() || current == queue.end())
     {
-        size_t offset = 0;
+        return;
+    }
 
-        for (auto it = other.queue.begin(); it != other.current; ++it)
-        {
-            ++offset;
-        }
+    std::list<Song>::const_iterator it = current;
 
-        current = queue.begin();
-        for (size_t i = 0; i < offset; ++i)
+    /* Walk forward from the cursor, looping back to the start at the end */
+    for (size_t i = 0; i < count; ++i)
+    {
+        out.push_back(&*it);
+
+        if (++it == queue.end())
         {
-            ++current;
+            it = queue.begin();
         }
     }
 }
 
+long long PlaybackQueue::totalDuration() const
+{
+    return timeline.totalDuration();
+}
+
+long long PlaybackQueue::remainingDuration() const
+{
+    if (current == queue.end())
+    {
+        return 0;
+    }
+
+    return timeline.totalDuration() - timeline.durationBefore(songIndex.at(current->id).slot);
+}
+
+const Song* PlaybackQueue::songAtTime(long long seconds) const
+{
+    size_t slot = timeline.slotAtTime(seconds);
+
+    if (slot >= timeline.slotCount())
+    {
+        return nullptr;
+    }
+
+    return &*slotNodes[slot];
+}
+
+long long PlaybackQueue::startTimeOf(size_t position) const
+{
+    size_t slot = timeline.slotAtPosition(position);
+
+    if (slot >= timeline.slotCount())
+    {
+        return timeline.totalDuration();
+    }
+
+    return timeline.durationBefore(slot);
+}
+
+bool PlaybackQueue::skipToTime(long long seconds)
+{
+    size_t slot = timeline.slotAtTime(seconds);
+
+    if (slot >= timeline.slotCount())
+    {
+        return false;
+    }
+
+    current = slotNodes[slot];
+    return true;
+}
+
+void PlaybackQueue::rebuildTimeline()
+{
+    std::vector<int> durations;
+    durations.reserve(queue.size());
+
+    slotNodes.clear();
+    slotNodes.reserve(queue.size());
+
+    /* Hand out slots again in current list order */
+    for (auto it = queue.begin(); it != queue.end(); ++it)
+    {
+        songIndex[it->id].slot = slotNodes.size();
+        slotNodes.push_back(it);
+        durations.push_back(it->duration);
+    }
+
+    timeline.build(durations);
+}
+
+PlaybackQueue::PlaybackQueue(const PlaybackQueue& other) : queue(other.queue)
+{
+    rebuildFrom(other);
+}
+
 
 PlaybackQueue& PlaybackQueue::operator=(const PlaybackQueue& other)
 {
@@ -136,29 +334,33 @@ PlaybackQueue& PlaybackQueue::operator=(const PlaybackQueue& other)
     }
 
     queue = other.queue;
+    rebuildFrom(other);
+
+    return *this;
+}
+
+void PlaybackQueue::rebuildFrom(const PlaybackQueue& other)
+{
+    /* Re-point the ID index at the copied nodes */
+    songIndex.clear();
+    songIndex.reserve(queue.size());
 
     /* Preserve playback position by copying iterator offset */
-    if (other.current == other.queue.end())
-    {
-        current = queue.end();
-    }
-    else
-    {
-        size_t offset = 0;
+    current = queue.end();
 
-        for (auto it = other.queue.begin(); it != other.current; ++it)
-        {
-            ++offset;
-        }
+    auto source = other.queue.begin();
 
-        current = queue.begin();
-        for (size_t i = 0; i < offset; ++i)
+    for (auto it = queue.begin(); it != queue.end(); ++it, ++source)
+    {
+        songIndex[it->id] = IndexEntry { it, 0 };
+
+        if (source == std::list<Song>::const_iterator(other.current))
         {
-            ++current;
+            current = it;
         }
     }
 
-    return *this;
+    rebuildTimeline();
 }
 
 
@@ -0,0 +1,291 @@
+#include "PriorityPlayNextQueue.h"
+#include <iostream>
+#include <queue>
+
+static const char* laneName(PlayNextLane lane)
+{
+    switch (lane)
+    {
+        case PlayNextLane::Urgent:    return "Urgent";
+        case PlayNextLane::Requested: return "Requested";
+        default:                      return "Suggested";
+    }
+}
+
+std::uint64_t PriorityPlayNextQueue::makeKey(PlayNextLane lane)
+{
+    return (static_cast<std::uint64_t>(lane) << LANE_SHIFT) | nextSequence++;
+}
+
+void PriorityPlayNextQueue::place(size_t slot, const Entry& entry)
+{
+    heap[slot] = entry;
+    position[entry.song->id] = slot;
+}
+
+void PriorityPlayNextQueue::siftUp(size_t slot)
+{
+    Entry moving = heap[slot];
+
+    /* Shift parents down instead of swapping, then drop the entry in once */
+    while (slot > 0)
+    {
+        size_t parent = (slot - 1) / ARITY;
+
+        if (heap[parent].key <= moving.key)
+        {
+            break;
+        }
+
+        place(slot, heap[parent]);
+        slot = parent;
+    }
+
+    place(slot, moving);
+}
+
+void PriorityPlayNextQueue::siftDown(size_t slot)
+{
+    Entry moving = heap[slot];
+    size_t count = heap.size();
+
+    while (true)
+    {
+        size_t first = slot * ARITY + 1;
+
+        if (first >= count)
+        {
+            break;
+        }
+
+        size_t last = (first + ARITY < count) ? first + ARITY : count;
+        size_t smallest = first;
+
+        for (size_t child = first + 1; child < last; ++child)
+        {
+            if (heap[child].key < heap[smallest].key)
+            {
+                smallest = child;
+            }
+        }
+
+        if (moving.key <= heap[smallest].key)
+        {
+            break;
+        }
+
+        place(slot, heap[smallest]);
+        slot = smallest;
+    }
+
+    place(slot, moving);
+}
+
+void PriorityPlayNextQueue::eraseAt(size_t slot)
+{
+    position.erase(heap[slot].song->id);
+
+    Entry last = heap.back();
+    heap.pop_back();
+
+    if (slot == heap.size())
+    {
+        return;
+    }
+
+    /* Refill the hole with the last entry and restore heap order */
+    place(slot, last);
+
+    if (slot > 0 && heap[(slot - 1) / ARITY].key > last.key)
+    {
+        siftUp(slot);
+    }
+    else
+    {
+        siftDown(slot);
+    }
+}
+
+bool PriorityPlayNextQueue::push(const Song& song, PlayNextLane lane)
+{
+    auto found = position.find(song.id);
+
+    if (found != position.end())
+    {
+        if (laneOf(song.id) != lane)
+        {
+            setLane(song.id, lane);
+        }
+
+        return false;
+    }
+
+    heap.push_back({ &song, makeKey(lane) });
+    position[song.id] = heap.size() - 1;
+    siftUp(heap.size() - 1);
+
+    return true;
+}
+
+Song PriorityPlayNextQueue::playNext()
+{
+    /* Notify user if attempting to play from an empty queue */
+    if (heap.empty())
+    {
+        std::cout << "PlayNext queue is empty";
+        return Song();
+    }
+
+    Song nextSong = *heap[0].song;
+    eraseAt(0);
+
+    return nextSong;
+}
+
+const Song* PriorityPlayNextQueue::front() const
+{
+    return heap.empty() ? nullptr : heap[0].song;
+}
+
+bool PriorityPlayNextQueue::cancel(int songID)
+{
+    auto found = position.find(songID);
+
+    if (found == position.end())
+    {
+        return false;
+    }
+
+    eraseAt(found->second);
+    return true;
+}
+
+bool PriorityPlayNextQueue::setLane(int songID, PlayNextLane lane)
+{
+    auto found = position.find(songID);
+
+    if (found == position.end())
+    {
+        return false;
+    }
+
+    size_t slot = found->second;
+    std::uint64_t oldKey = heap[slot].key;
+
+    /* A song already in the lane keeps its place */
+    if (static_cast<PlayNextLane>(oldKey >> LANE_SHIFT) == lane)
+    {
+        return true;
+    }
+
+    /* A new sequence number puts the song at the back of its new lane */
+    heap[slot].key = makeKey(lane);
+
+    if (heap[slot].key < oldKey)
+    {
+        siftUp(slot);
+    }
+    else
+    {
+        siftDown(slot);
+    }
+
+    return true;
+}
+
+bool PriorityPlayNextQueue::contains(int songID) const
+{
+    return position.count(songID) != 0;
+}
+
+PlayNextLane PriorityPlayNextQueue::laneOf(int songID) const
+{
+    auto found = position.find(songID);
+
+    if (found == position.end())
+    {
+        return PlayNextLane::Requested;
+    }
+
+    return static_cast<PlayNextLane>(heap[found->second].key >> LANE_SHIFT);
+}
+
+bool PriorityPlayNextQueue::isEmpty() const
+{
+    return heap.empty();
+}
+
+size_t PriorityPlayNextQueue::size() const
+{
+    return heap.size();
+}
+
+void PriorityPlayNextQueue::peekUpcoming(size_t count, std::vector<const Song*>& out) const
+{
+    /*
+     * Best-first walk of the heap: a song can only be next once its
+     * parent has been taken, so the frontier never exceeds
+     * count * (ARITY - 1) + 1 slots.
+     */
+    auto later = [this](size_t a, size_t b) { return heap[a].key > heap[b].key; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> frontier(later);
+
+    if (!heap.empty() && count > 0)
+    {
+        frontier.push(0);
+    }
+
+    while (!frontier.empty() && count > 0)
+    {
+        size_t slot = frontier.top();
+        frontier.pop();
+
+        out.push_back(heap[slot].song);
+        --count;
+
+        for (size_t child = slot * ARITY + 1; child <= slot * ARITY + ARITY && child < heap.size(); ++child)
+        {
+            frontier.push(child);
+        }
+    }
+}
+
+void PriorityPlayNextQueue::printAllSongs() const
+{
+    std::vector<const Song*> songs;
+    peekUpcoming(heap.size(), songs);
+
+    for (const Song* song : songs)
+    {
+        /* Output formatted song details to the console */
+        std::cout << "[" << laneName(laneOf(song->id)) << "]"
+                  << " ID: " << song->id
+                  << " | Title: " << song->title
+                  << " | Artist: " << song->artist
+                  << " | Album: " << song->album
+                  << " | Duration: " << song->duration << " s"
+                  << '\n';
+    }
+}
+
+std::vector<int> PriorityPlayNextQueue::getSongIDs() const
+{
+    std::vector<const Song*> songs;
+    peekUpcoming(heap.size(), songs);
+
+    std::vector<int> ids;
+    ids.reserve(songs.size());
+
+    for (const Song* song : songs)
+    {
+        ids.push_back(song->id);
+    }
+
+    return ids;
+}
+
+void PriorityPlayNextQueue::clear()
+{
+    heap.clear();
+    position.clear();
+}
@@ -0,0 +1,41 @@
+#include "QueueBatch.h"
+
+void QueueBatch::addSong(int songID)
+{
+    edits.push_back({ QueueEditType::Add, songID, 0 });
+}
+
+void QueueBatch::removeSong(int songID)
+{
+    edits.push_back({ QueueEditType::Remove, songID, 0 });
+}
+
+void QueueBatch::moveSong(int songID, size_t position)
+{
+    edits.push_back({ QueueEditType::Move, songID, position });
+}
+
+void QueueBatch::playNext(int songID)
+{
+    edits.push_back({ QueueEditType::PlayNext, songID, 0 });
+}
+
+const std::vector<QueueEdit>& QueueBatch::getEdits() const
+{
+    return edits;
+}
+
+size_t QueueBatch::size() const
+{
+    return edits.size();
+}
+
+bool QueueBatch::isEmpty() const
+{
+    return edits.empty();
+}
+
+void QueueBatch::clear()
+{
+    edits.clear();
+}
@@ -1,58 +1,512 @@
 #include "ShuffleManager.h"
-#include <iostream> 
+#include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <queue>
 #include <random>
+#include <unordered_map>
+
+/* Song fields kept apart by Spread mode, outermost first */
+static std::string Song::* const SPREAD_FIELDS[] = { &Song::artist, &Song::album };
+static constexpr size_t SPREAD_LEVELS = sizeof(SPREAD_FIELDS) / sizeof(SPREAD_FIELDS[0]);
+
+/* Maximum random shift of a spread position, as a fraction of its spacing */
+static constexpr double SPREAD_JITTER = 0.1;
+
+/* Smallest weight a Weighted mode song can have */
+static constexpr double MIN_WEIGHT = 1e-6;
+
+/* Current unix time, for recently-played checks */
+static std::int64_t unixNow()
+{
+    return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+}
+
+void ShuffleManager::setRecentPlays(const RecentPlays* recent)
+{
+    recentPlays = recent;
+}
+
+void ShuffleManager::holdBackRecent()
+{
+    freshCount = shuffledSongs.size();
+
+    if (recentPlays == nullptr || !recentPlays->isActive())
+    {
+        return;
+    }
+
+    std::int64_t now = unixNow();
+    auto isFresh = [&](const Song* song) { return !recentPlays->isRecent(song->id, now); };
+
+    if (mode != ShuffleMode::Weighted)
+    {
+        /* Stable, so Seeded orders depend only on which songs are held back */
+        auto held = std::stable_partition(shuffledSongs.begin(), shuffledSongs.end(), isFresh);
+
+        freshCount = static_cast<size_t>(held - shuffledSongs.begin());
+        return;
+    }
+
+    /* Weights travel with their songs */
+    std::vector<std::pair<Song*, double>> pairs;
+    pairs.reserve(shuffledSongs.size());
+
+    for (size_t i = 0; i < shuffledSongs.size(); ++i)
+    {
+        pairs.emplace_back(shuffledSongs[i], weights[i]);
+    }
+
+    auto held = std::stable_partition(pairs.begin(), pairs.end(),
+                                      [&](const std::pair<Song*, double>& p) { return isFresh(p.first); });
+
+    freshCount = static_cast<size_t>(held - pairs.begin());
+
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        shuffledSongs[i] = pairs[i].first;
+        weights[i] = pairs[i].second;
+    }
+}
 
 void ShuffleManager::initialize(const std::vector<Song*>& playlist)
 {
     shuffledSongs = playlist;
-    playedSongIDs.clear();
+    mode = ShuffleMode::Random;
+    drawn = 0;
+    cursor = 0;
+    clearWeighted();
+    holdBackRecent();
 
     /* Initialize Mersenne Twister engine with a hardware random seed */
     std::random_device rd;
     gen = std::mt19937(rd());
 }
 
-Song* ShuffleManager::getNextSong()
+void ShuffleManager::initialize(const std::vector<Song*>& playlist, std::uint64_t seed)
+{
+    shuffledSongs = playlist;
+    mode = ShuffleMode::Seeded;
+    drawn = 0;
+    cursor = 0;
+    clearWeighted();
+    holdBackRecent();
+
+    this->seed = seed;
+    permutation = FeistelPermutation(freshCount, seed);
+    recentPermutation = FeistelPermutation(playlist.size() - freshCount, seed);
+
+    /* Later insertions are reproducible from the seed as well */
+    std::seed_seq sequence { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) };
+    gen.seed(sequence);
+}
+
+void ShuffleManager::initializeSpread(const std::vector<Song*>& playlist)
 {
-    /* Return nullptr if the source playlist is empty */
-    if (shuffledSongs.empty())
+    shuffledSongs = playlist;
+    mode = ShuffleMode::Spread;
+    cursor = 0;
+    clearWeighted();
+
+    std::random_device rd;
+    gen = std::mt19937(rd());
+
+    holdBackRecent();
+
+    /* Spread each part on its own so held back songs stay at the end */
+    std::vector<Song*> held(shuffledSongs.begin() + freshCount, shuffledSongs.end());
+    shuffledSongs.resize(freshCount);
+
+    spreadSongs(shuffledSongs, 0);
+    spreadSongs(held, 0);
+
+    shuffledSongs.insert(shuffledSongs.end(), held.begin(), held.end());
+
+    /* The whole order is known, so every position counts as drawn */
+    drawn = shuffledSongs.size();
+}
+
+void ShuffleManager::initializeWeighted(const std::vector<Song*>& playlist, const std::vector<double>& songWeights)
+{
+    shuffledSongs = playlist;
+    mode = ShuffleMode::Weighted;
+    drawn = 0;
+    cursor = 0;
+    clearWeighted();
+
+    weights.resize(playlist.size());
+
+    for (size_t i = 0; i < playlist.size(); ++i)
     {
-        return nullptr;
+        double w = (i < songWeights.size()) ? songWeights[i] : 1.0;
+        weights[i] = (w > MIN_WEIGHT) ? w : MIN_WEIGHT;
+    }
+
+    taken.assign(playlist.size(), false);
+    weightedOrder.reserve(playlist.size());
+
+    std::random_device rd;
+    gen = std::mt19937(rd());
+
+    holdBackRecent();
+    startPhase(0, freshCount);
+}
+
+void ShuffleManager::clearWeighted()
+{
+    std::vector<double>().swap(weights);
+    std::vector<bool>().swap(taken);
+    std::vector<size_t>().swap(weightedOrder);
+    std::unordered_map<int, size_t>().swap(indexOfSong);
+    aliasTable.clear();
+    weightTree.clear();
+    treeActive = false;
+    phaseBegin = phaseEnd = 0;
+    phaseWeight = takenWeight = 0.0;
+}
+
+void ShuffleManager::startPhase(size_t begin, size_t end)
+{
+    phaseBegin = begin;
+    phaseEnd = end;
+    phaseWeight = 0.0;
+    takenWeight = 0.0;
+    treeActive = false;
+    weightTree.clear();
+
+    std::vector<double> phase(weights.begin() + begin, weights.begin() + end);
+
+    for (double w : phase)
+    {
+        phaseWeight += w;
+    }
+
+    aliasTable.build(phase);
+}
+
+void ShuffleManager::switchToTree()
+{
+    std::vector<double> phase(weights.begin() + phaseBegin, weights.begin() + phaseEnd);
+
+    for (size_t i = 0; i < phase.size(); ++i)
+    {
+        if (taken[phaseBegin + i])
+        {
+            phase[i] = 0.0;
+        }
+    }
+
+    weightTree.build(phase);
+    aliasTable.clear();
+    treeActive = true;
+}
+
+void ShuffleManager::drawWeighted()
+{
+    /* Held back songs are drawn once the fresh ones run out */
+    if (drawn == phaseEnd)
+    {
+        startPhase(phaseEnd, shuffledSongs.size());
+    }
+
+    /* Past half the weight, the alias table would mostly hit taken songs */
+    if (!treeActive && takenWeight * 2.0 > phaseWeight)
+    {
+        switchToTree();
+    }
+
+    size_t idx;
+
+    if (!treeActive)
+    {
+        do
+        {
+            idx = phaseBegin + aliasTable.sample(gen);
+        }
+        while (taken[idx]);
+
+        takenWeight += weights[idx];
+    }
+    else
+    {
+        idx = phaseBegin + weightTree.sample(gen);
+        weightTree.set(idx - phaseBegin, 0.0);
+    }
+
+    taken[idx] = true;
+    weightedOrder.push_back(idx);
+    ++drawn;
+}
+
+bool ShuffleManager::setWeight(int songID, double weight)
+{
+    if (mode != ShuffleMode::Weighted)
+    {
+        return false;
+    }
+
+    if (indexOfSong.empty())
+    {
+        indexOfSong.reserve(shuffledSongs.size());
+
+        for (size_t i = 0; i < shuffledSongs.size(); ++i)
+        {
+            indexOfSong.emplace(shuffledSongs[i]->id, i);
+        }
+    }
+
+    auto it = indexOfSong.find(songID);
+
+    if (it == indexOfSong.end())
+    {
+        return false;
+    }
+
+    size_t idx = it->second;
+    weights[idx] = (weight > MIN_WEIGHT) ? weight : MIN_WEIGHT;
+
+    /* Drawn songs keep their place; later phases read weights when they start */
+    if (taken[idx] || idx < phaseBegin || idx >= phaseEnd)
+    {
+        return true;
+    }
+
+    /* The alias table cannot change, so the rest of the phase moves to the tree */
+    if (treeActive)
+    {
+        weightTree.set(idx - phaseBegin, weights[idx]);
+    }
+    else
+    {
+        switchToTree();
+    }
+
+    return true;
+}
+
+void ShuffleManager::spreadSongs(std::vector<Song*>& songs, size_t level)
+{
+    size_t n = songs.size();
+
+    if (n < 2)
+    {
+        return;
     }
 
+    /* Below the last field, order is uniformly random */
+    if (level == SPREAD_LEVELS)
+    {
+        std::shuffle(songs.begin(), songs.end(), gen);
+        return;
+    }
+
+    std::string Song::* field = SPREAD_FIELDS[level];
+
+    /* Split into groups sharing the field value */
+    std::unordered_map<std::string, size_t> groupOf;
+    std::vector<std::vector<Song*>> groups;
+
+    for (Song* song : songs)
+    {
+        auto inserted = groupOf.emplace(song->*field, groups.size());
+
+        if (inserted.second)
+        {
+            groups.emplace_back();
+        }
+
+        groups[inserted.first->second].push_back(song);
+    }
+
+    /* A single group has nothing to be spread from */
+    if (groups.size() == 1)
+    {
+        spreadSongs(songs, level + 1);
+        return;
+    }
+
+    /* Lay each group out evenly over [0, n) from a random offset */
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<double> spacing(groups.size());
+    std::vector<double> offset(groups.size());
+
+    struct Head
+    {
+        double position;
+        size_t group;
+        size_t index;
+    };
+
+    auto later = [](const Head& a, const Head& b) { return a.position > b.position; };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        spreadSongs(groups[g], level + 1);
+
+        spacing[g] = static_cast<double>(n) / groups[g].size();
+        offset[g] = unit(gen) * spacing[g];
+        heads.push({ offset[g], g, 0 });
+    }
+
+    /* k-way merge on position; only one song per group is in the heap */
+    songs.clear();
+
+    while (!heads.empty())
+    {
+        Head head = heads.top();
+        heads.pop();
+
+        songs.push_back(groups[head.group][head.index]);
+
+        if (++head.index < groups[head.group].size())
+        {
+            /* Jitter stays well below the spacing, so groups keep their order */
+            double jitter = (2.0 * unit(gen) - 1.0) * SPREAD_JITTER;
+
+            head.position = offset[head.group] + (head.index + jitter) * spacing[head.group];
+            heads.push(head);
+        }
+    }
+}
+
+size_t ShuffleManager::seededIndex(size_t k) const
+{
+    if (k < freshCount)
+    {
+        return permutation(k);
+    }
+
+    return freshCount + recentPermutation(k - freshCount);
+}
+
+void ShuffleManager::drawOne()
+{
+    /* Pick uniformly among the songs not drawn yet, fresh songs first */
+    size_t last = (drawn < freshCount) ? freshCount - 1 : shuffledSongs.size() - 1;
+    std::uniform_int_distribution<size_t> dist(drawn, last);
+    size_t idx = dist(gen);
+
+    /* Move the pick to the end of the drawn prefix */
+    std::swap(shuffledSongs[drawn], shuffledSongs[idx]);
+    ++drawn;
+}
+
+Song* ShuffleManager::getNextSong()
+{
     /* Return nullptr if all songs in the current cycle have been played */
-    if (playedSongIDs.size() == shuffledSongs.size())
+    Song* song = at(cursor);
+
+    if (song != nullptr)
     {
-        return nullptr;
+        ++cursor;
     }
 
-    /* Define a uniform distribution for valid index range */
-    std::uniform_int_distribution<> dist(0, shuffledSongs.size() - 1);
+    return song;
+}
 
-    while (true)
+Song* ShuffleManager::next()
+{
+    return getNextSong();
+}
+
+Song* ShuffleManager::at(size_t k)
+{
+    if (k >= shuffledSongs.size())
     {
-        /* Generate a random index to pick a candidate song */
-        int idx = dist(gen);
+        return nullptr;
+    }
 
-        /* Extract ID for uniqueness check using the played set */
-        int id = shuffledSongs[idx]->id;
+    if (mode == ShuffleMode::Seeded)
+    {
+        return shuffledSongs[seededIndex(k)];
+    }
 
-        /* Check if the song has already been played in this cycle */
-        if (playedSongIDs.find(id) == playedSongIDs.end())
+    if (mode == ShuffleMode::Weighted)
+    {
+        while (drawn <= k)
         {
-            /* Mark as played and return the song pointer */
-            playedSongIDs.insert(id);  
-            return shuffledSongs[idx];
+            drawWeighted();
         }
+
+        return shuffledSongs[weightedOrder[k]];
+    }
+
+    /* Random positions only exist once drawn */
+    while (drawn <= k)
+    {
+        drawOne();
+    }
+
+    return shuffledSongs[k];
+}
+
+void ShuffleManager::seek(size_t k)
+{
+    cursor = std::min(k, shuffledSongs.size());
+}
+
+size_t ShuffleManager::position() const
+{
+    return cursor;
+}
+
+size_t ShuffleManager::size() const
+{
+    return shuffledSongs.size();
+}
+
+ShuffleMode ShuffleManager::getMode() const
+{
+    return mode;
+}
+
+std::uint64_t ShuffleManager::getSeed() const
+{
+    return seed;
+}
+
+size_t ShuffleManager::insertSong(PlaybackQueue& queue, const Song& song)
+{
+    /* Songs before the cursor have been played; without a cursor none have */
+    size_t first = queue.getCurrentIndex();
+
+    if (first == queue.size())
+    {
+        first = 0;
     }
+
+    /* Any of the gaps from the cursor to the end is equally likely */
+    std::uniform_int_distribution<size_t> dist(first, queue.size());
+    size_t position = dist(gen);
+
+    /* Recently heard songs wait until the rest has played */
+    if (recentPlays != nullptr && recentPlays->isRecent(song.id, unixNow()))
+    {
+        position = queue.size();
+    }
+
+    queue.insertSong(song, position);
+
+    return position;
 }
 
 void ShuffleManager::printAllSongs() const
 {
     /* Iterate and print details for all songs in the shuffle list */
-    for (const Song* song : shuffledSongs)
+    for (size_t k = 0; k < shuffledSongs.size(); ++k)
     {
+       /* Weighted positions only exist once drawn */
+       if (mode == ShuffleMode::Weighted && k >= weightedOrder.size())
+       {
+           break;
+       }
+
+       /* Seeded shuffles keep the playlist order and map positions instead */
+       const Song* song = (mode == ShuffleMode::Seeded)   ? shuffledSongs[seededIndex(k)]
+                        : (mode == ShuffleMode::Weighted) ? shuffledSongs[weightedOrder[k]]
+                                                          : shuffledSongs[k];
+
        std::cout << "ID: " << song->id
                  << " | Title: " << song->title
                  << " | Artist: " << song->artist
@@ -60,4 +514,4 @@ void ShuffleManager::printAllSongs() const
                  << " | Duration: " << song->duration << " s"
                  << '\n';
     }
-}
\ No newline at end of file
+}
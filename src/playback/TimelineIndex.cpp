@@ -0,0 +1,387 @@
+#include "TimelineIndex.h"
+
+TimelineIndex::TimelineIndex()
+{
+    clear();
+}
+
+void TimelineIndex::clear()
+{
+    nodes.clear();
+    freeSlots.clear();
+    root = NONE;
+}
+
+size_t TimelineIndex::countOf(size_t node) const
+{
+    return (node == NONE) ? 0 : nodes[node].count;
+}
+
+long long TimelineIndex::secondsOf(size_t node) const
+{
+    return (node == NONE) ? 0 : nodes[node].seconds;
+}
+
+void TimelineIndex::update(size_t node)
+{
+    Node& n = nodes[node];
+
+    n.count = 1 + countOf(n.left) + countOf(n.right);
+    n.seconds = n.duration + secondsOf(n.left) + secondsOf(n.right);
+}
+
+void TimelineIndex::rotateUp(size_t node)
+{
+    size_t parent = nodes[node].parent;
+    size_t grand = nodes[parent].parent;
+
+    /* The child subtree that changes sides keeps its in-order position */
+    if (nodes[parent].left == node)
+    {
+        size_t moved = nodes[node].right;
+
+        nodes[parent].left = moved;
+        nodes[node].right = parent;
+
+        if (moved != NONE)
+        {
+            nodes[moved].parent = parent;
+        }
+    }
+    else
+    {
+        size_t moved = nodes[node].left;
+
+        nodes[parent].right = moved;
+        nodes[node].left = parent;
+
+        if (moved != NONE)
+        {
+            nodes[moved].parent = parent;
+        }
+    }
+
+    nodes[parent].parent = node;
+    nodes[node].parent = grand;
+
+    if (grand == NONE)
+    {
+        root = node;
+    }
+    else if (nodes[grand].left == parent)
+    {
+        nodes[grand].left = node;
+    }
+    else
+    {
+        nodes[grand].right = node;
+    }
+
+    update(parent);
+    update(node);
+}
+
+size_t TimelineIndex::allocate(int duration)
+{
+    /* xorshift32 */
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    Node node { NONE, NONE, NONE, 1, duration, duration, randomState };
+
+    if (!freeSlots.empty())
+    {
+        size_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        nodes[slot] = node;
+        return slot;
+    }
+
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+void TimelineIndex::build(const std::vector<int>& durations)
+{
+    clear();
+    nodes.reserve(durations.size());
+
+    /*
+     * Linear-time Cartesian tree construction: the stack holds the
+     * right spine, and each new node adopts the popped lower-priority
+     * part of it as its left subtree.
+     */
+    std::vector<size_t> spine;
+
+    for (int duration : durations)
+    {
+        size_t node = allocate(duration);
+        size_t last = NONE;
+
+        while (!spine.empty() && nodes[spine.back()].priority < nodes[node].priority)
+        {
+            last = spine.back();
+            spine.pop_back();
+        }
+
+        nodes[node].left = last;
+
+        if (last != NONE)
+        {
+            nodes[last].parent = node;
+        }
+
+        if (!spine.empty())
+        {
+            nodes[spine.back()].right = node;
+            nodes[node].parent = spine.back();
+        }
+
+        spine.push_back(node);
+    }
+
+    if (spine.empty())
+    {
+        return;
+    }
+
+    root = spine.front();
+
+    /* Fill in subtree totals, children before parents */
+    std::vector<size_t> order;
+    order.reserve(nodes.size());
+    order.push_back(root);
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const Node& n = nodes[order[i]];
+
+        if (n.left != NONE)
+        {
+            order.push_back(n.left);
+        }
+
+        if (n.right != NONE)
+        {
+            order.push_back(n.right);
+        }
+    }
+
+    for (size_t i = order.size(); i-- > 0; )
+    {
+        update(order[i]);
+    }
+}
+
+size_t TimelineIndex::append(int duration)
+{
+    return insertAt(liveCount(), duration);
+}
+
+size_t TimelineIndex::insertAt(size_t position, int duration)
+{
+    size_t node = allocate(duration);
+
+    if (root == NONE)
+    {
+        root = node;
+        return node;
+    }
+
+    /* Descend to the leaf gap that has position entries before it */
+    size_t parent = root;
+
+    while (true)
+    {
+        size_t leftCount = countOf(nodes[parent].left);
+
+        if (position <= leftCount)
+        {
+            if (nodes[parent].left == NONE)
+            {
+                nodes[parent].left = node;
+                break;
+            }
+
+            parent = nodes[parent].left;
+        }
+        else
+        {
+            position -= leftCount + 1;
+
+            if (nodes[parent].right == NONE)
+            {
+                nodes[parent].right = node;
+                break;
+            }
+
+            parent = nodes[parent].right;
+        }
+    }
+
+    nodes[node].parent = parent;
+
+    for (size_t up = parent; up != NONE; up = nodes[up].parent)
+    {
+        nodes[up].count += 1;
+        nodes[up].seconds += duration;
+    }
+
+    /* Restore heap order on priorities */
+    while (nodes[node].parent != NONE && nodes[nodes[node].parent].priority < nodes[node].priority)
+    {
+        rotateUp(node);
+    }
+
+    return node;
+}
+
+void TimelineIndex::erase(size_t slot)
+{
+    /* Rotate the node down until it is a leaf */
+    while (nodes[slot].left != NONE || nodes[slot].right != NONE)
+    {
+        size_t left = nodes[slot].left;
+        size_t right = nodes[slot].right;
+
+        if (right == NONE || (left != NONE && nodes[left].priority > nodes[right].priority))
+        {
+            rotateUp(left);
+        }
+        else
+        {
+            rotateUp(right);
+        }
+    }
+
+    size_t parent = nodes[slot].parent;
+
+    if (parent == NONE)
+    {
+        root = NONE;
+    }
+    else if (nodes[parent].left == slot)
+    {
+        nodes[parent].left = NONE;
+    }
+    else
+    {
+        nodes[parent].right = NONE;
+    }
+
+    for (size_t up = parent; up != NONE; up = nodes[up].parent)
+    {
+        nodes[up].count -= 1;
+        nodes[up].seconds -= nodes[slot].duration;
+    }
+
+    freeSlots.push_back(slot);
+}
+
+size_t TimelineIndex::slotCount() const
+{
+    return nodes.size();
+}
+
+size_t TimelineIndex::liveCount() const
+{
+    return countOf(root);
+}
+
+long long TimelineIndex::totalDuration() const
+{
+    return secondsOf(root);
+}
+
+long long TimelineIndex::durationBefore(size_t slot) const
+{
+    long long sum = secondsOf(nodes[slot].left);
+
+    /* Every ancestor reached from its right side lies before the slot */
+    for (size_t node = slot, up = nodes[slot].parent; up != NONE; node = up, up = nodes[up].parent)
+    {
+        if (nodes[up].right == node)
+        {
+            sum += secondsOf(nodes[up].left) + nodes[up].duration;
+        }
+    }
+
+    return sum;
+}
+
+size_t TimelineIndex::countBefore(size_t slot) const
+{
+    size_t count = countOf(nodes[slot].left);
+
+    for (size_t node = slot, up = nodes[slot].parent; up != NONE; node = up, up = nodes[up].parent)
+    {
+        if (nodes[up].right == node)
+        {
+            count += countOf(nodes[up].left) + 1;
+        }
+    }
+
+    return count;
+}
+
+size_t TimelineIndex::slotAtTime(long long seconds) const
+{
+    if (seconds < 0 || seconds >= totalDuration())
+    {
+        return slotCount();
+    }
+
+    size_t node = root;
+
+    while (node != NONE)
+    {
+        const Node& n = nodes[node];
+        long long leftSeconds = secondsOf(n.left);
+
+        if (seconds < leftSeconds)
+        {
+            node = n.left;
+        }
+        else if (seconds < leftSeconds + n.duration)
+        {
+            return node;
+        }
+        else
+        {
+            seconds -= leftSeconds + n.duration;
+            node = n.right;
+        }
+    }
+
+    return slotCount();
+}
+
+size_t TimelineIndex::slotAtPosition(size_t position) const
+{
+    if (position >= liveCount())
+    {
+        return slotCount();
+    }
+
+    size_t node = root;
+
+    while (true)
+    {
+        size_t leftCount = countOf(nodes[node].left);
+
+        if (position < leftCount)
+        {
+            node = nodes[node].left;
+        }
+        else if (position == leftCount)
+        {
+            return node;
+        }
+        else
+        {
+            position -= leftCount + 1;
+            node = nodes[node].right;
+        }
+    }
+}
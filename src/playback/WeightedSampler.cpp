@@ -0,0 +1,249 @@
+#include "WeightedSampler.h"
+
+/* =============================================================
+ * ALIAS TABLE
+ * ============================================================= */
+
+void AliasTable::build(const std::vector<double>& weights)
+{
+    clear();
+
+    size_t n = weights.size();
+    double sum = 0.0;
+
+    for (double w : weights)
+    {
+        sum += (w > 0.0) ? w : 0.0;
+    }
+
+    if (n == 0 || !(sum > 0.0) || n > UINT32_MAX)
+    {
+        return;
+    }
+
+    /* Scale so the average column holds exactly 1 */
+    probability.resize(n);
+    alias.resize(n);
+
+    std::vector<std::uint32_t> small;
+    std::vector<std::uint32_t> large;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        double w = (weights[i] > 0.0) ? weights[i] : 0.0;
+        probability[i] = w * static_cast<double>(n) / sum;
+
+        if (probability[i] < 1.0)
+        {
+            small.push_back(static_cast<std::uint32_t>(i));
+        }
+        else
+        {
+            large.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    /* Vose: top up each short column with mass from a tall one */
+    while (!small.empty() && !large.empty())
+    {
+        std::uint32_t s = small.back();
+        std::uint32_t l = large.back();
+        small.pop_back();
+        large.pop_back();
+
+        alias[s] = l;
+        probability[l] -= 1.0 - probability[s];
+
+        if (probability[l] < 1.0)
+        {
+            small.push_back(l);
+        }
+        else
+        {
+            large.push_back(l);
+        }
+    }
+
+    /* Whatever is left is full up to rounding */
+    for (std::uint32_t i : small)
+    {
+        probability[i] = 1.0;
+        alias[i] = i;
+    }
+
+    for (std::uint32_t i : large)
+    {
+        probability[i] = 1.0;
+        alias[i] = i;
+    }
+}
+
+size_t AliasTable::sample(std::mt19937& gen) const
+{
+    if (probability.empty())
+    {
+        return 0;
+    }
+
+    std::uniform_int_distribution<size_t> column(0, probability.size() - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    size_t i = column(gen);
+
+    return (coin(gen) < probability[i]) ? i : alias[i];
+}
+
+size_t AliasTable::size() const
+{
+    return probability.size();
+}
+
+void AliasTable::clear()
+{
+    std::vector<double>().swap(probability);
+    std::vector<std::uint32_t>().swap(alias);
+}
+
+/* =============================================================
+ * WEIGHT TREE
+ * ============================================================= */
+
+void WeightTree::build(const std::vector<double>& initial)
+{
+    weights.resize(initial.size());
+    positive = 0;
+
+    for (size_t i = 0; i < initial.size(); ++i)
+    {
+        weights[i] = (initial[i] > 0.0) ? initial[i] : 0.0;
+        positive += (weights[i] > 0.0);
+    }
+
+    rebuild();
+}
+
+void WeightTree::rebuild()
+{
+    size_t n = weights.size();
+    tree.assign(n + 1, 0.0);
+
+    /* Each node pushes its finished sum to its parent: O(n) */
+    for (size_t i = 1; i <= n; ++i)
+    {
+        tree[i] += weights[i - 1];
+
+        size_t parent = i + (i & (~i + 1));
+
+        if (parent <= n)
+        {
+            tree[parent] += tree[i];
+        }
+    }
+
+    topStep = 1;
+
+    while (topStep * 2 <= n)
+    {
+        topStep *= 2;
+    }
+}
+
+void WeightTree::set(size_t i, double weight)
+{
+    if (weight < 0.0)
+    {
+        weight = 0.0;
+    }
+
+    double delta = weight - weights[i];
+
+    positive -= (weights[i] > 0.0);
+    positive += (weight > 0.0);
+    weights[i] = weight;
+
+    for (size_t j = i + 1; j < tree.size(); j += j & (~j + 1))
+    {
+        tree[j] += delta;
+    }
+}
+
+double WeightTree::weight(size_t i) const
+{
+    return weights[i];
+}
+
+double WeightTree::prefix(size_t count) const
+{
+    double sum = 0.0;
+
+    for (size_t j = count; j > 0; j -= j & (~j + 1))
+    {
+        sum += tree[j];
+    }
+
+    return sum;
+}
+
+double WeightTree::total() const
+{
+    return prefix(weights.size());
+}
+
+size_t WeightTree::sample(std::mt19937& gen)
+{
+    size_t n = weights.size();
+
+    if (positive == 0)
+    {
+        return n;
+    }
+
+    for (size_t attempt = 1; ; ++attempt)
+    {
+        /* Repeated misses mean the sums drifted; recompute them */
+        if (attempt % 4 == 0)
+        {
+            rebuild();
+        }
+
+        double sum = total();
+
+        if (!(sum > 0.0))
+        {
+            continue;
+        }
+
+        std::uniform_real_distribution<double> dist(0.0, sum);
+        double target = dist(gen);
+
+        /* Find the entry whose weight interval contains target */
+        size_t pos = 0;
+
+        for (size_t step = topStep; step > 0; step >>= 1)
+        {
+            if (pos + step <= n && tree[pos + step] <= target)
+            {
+                pos += step;
+                target -= tree[pos];
+            }
+        }
+
+        if (pos < n && weights[pos] > 0.0)
+        {
+            return pos;
+        }
+    }
+}
+
+size_t WeightTree::size() const
+{
+    return weights.size();
+}
+
+void WeightTree::clear()
+{
+    std::vector<double>().swap(tree);
+    std::vector<double>().swap(weights);
+    positive = 0;
+    topStep = 0;
+}
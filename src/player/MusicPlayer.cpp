@@ -3,6 +3,10 @@
 #include <atomic>
 #include <condition_variable>
 #include <chrono> 
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <random>
 #include <thread>      
 #include <windows.h>
 
@@ -27,6 +31,22 @@ static Song audioSong;                 /* The song object currently held by the
 static constexpr int LOOP_DELAY_MS = 100;
 static constexpr int RESUME_DELAY_MS = 50;
 
+/* Songs kept for the "Back" button; push cost does not depend on it */
+static constexpr size_t HISTORY_CAPACITY = 5000;
+
+/* Default recently-played window: last 50 plays or last 2 hours */
+static constexpr std::uint32_t RECENT_WINDOW_PLAYS = 50;
+static constexpr std::int64_t RECENT_WINDOW_SECONDS = 2 * 3600;
+
+/* Plays and skips this far back shape Weighted shuffles (90 days) */
+static constexpr std::int64_t WEIGHT_HISTORY_SECONDS = 90 * 86400;
+
+/* Session persistence files */
+static const char* const SESSION_JOURNAL_PATH    = "data/session.journal";
+static const char* const SESSION_CHECKPOINT_PATH = "data/session.checkpoint";
+static const char* const LISTENING_LOG_PATH      = "data/listening.log";
+static const char* const ACOUSTIC_FEATURES_PATH  = "data/acoustic.features";
+
 /* Forward declaration */
 static void audioThreadFunc(MusicPlayer* player);
 
@@ -35,10 +55,40 @@ static void audioThreadFunc(MusicPlayer* player);
  * ============================================================= */
 
 MusicPlayer::MusicPlayer()
+    : sessionJournal(SESSION_JOURNAL_PATH, SESSION_CHECKPOINT_PATH)
 {
     /* Load music library from CSV at initialization. */
     library.loadLibraryFromCSV("data/playlist.csv");
 
+    playbackHistory.setCapacity(HISTORY_CAPACITY);
+    playStatistics.initialize(library);
+
+    /* Analytics are optional; playback works without the log. */
+    if (!listeningLog.open(LISTENING_LOG_PATH))
+    {
+        std::cerr << "[Warning] Listening log unavailable: " << LISTENING_LOG_PATH << "\n";
+    }
+
+    /* Remember what was heard before this run, too. */
+    recentPlays.initialize(library);
+    recentPlays.setWindow(RECENT_WINDOW_PLAYS, RECENT_WINDOW_SECONDS);
+
+    if (listeningLog.isOpen())
+    {
+        recentPlays.load(listeningLog, std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    }
+
+    shuffleManager.setRecentPlays(&recentPlays);
+
+    /* Restore the previous session before the audio thread can advance it. */
+    restoreSession();
+    currentStartedAt = std::chrono::system_clock::now();
+
+    if (hasCurrentSong)
+    {
+        recentPlays.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
+    }
+
     /* Start the background audio processing thread. */
     static std::thread audioThread(audioThreadFunc, this);
     audioThread.detach();
@@ -46,6 +96,8 @@ MusicPlayer::MusicPlayer()
 
 void MusicPlayer::selectAndPlaySong(int songID)
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Find the requested song in the library. */
     Song* song = library.findSongByID(songID);
 
@@ -59,23 +111,44 @@ void MusicPlayer::selectAndPlaySong(int songID)
     /* If a song is currently playing, push it to playback history. */
     if (hasCurrentSong)
     {
+        logListeningEvent();
         playbackHistory.pushSong(currentSong);
+        recordOperation(JournalOp::HistoryPush, currentSong.id);
     }
 
     /* Update current song state. */
     currentSong = *song;
+    currentStartedAt = std::chrono::system_clock::now();
+    playStatistics.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
+    recentPlays.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
     hasCurrentSong = true;
     isPaused = false;
+    recordOperation(JournalOp::SetCurrent, currentSong.id);
 
-    /* Add selected song to the playback queue. */
-    playbackQueue.addSong(currentSong);
+    /* Add selected song to the playback queue (and the unshuffled order while shuffled). */
+    queueSong(*song, true);
 
     /* Trigger playback. */
     playSong(currentSong);
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+/* Journal operation that queues a song in a Play Next lane */
+static JournalOp playNextAddOp(PlayNextLane lane)
+{
+    switch (lane)
+    {
+        case PlayNextLane::Urgent:    return JournalOp::PlayNextUrgent;
+        case PlayNextLane::Suggested: return JournalOp::PlayNextSuggested;
+        default:                      return JournalOp::PlayNextAdd;
+    }
 }
 
-void MusicPlayer::addSongToPlayNext(int id)
+void MusicPlayer::addSongToPlayNext(int id, PlayNextLane lane)
 {
+    /* The library is read-only after loading, so no state lock is needed */
     Song* song = library.findSongByID(id);
 
     /* ERROR HANDLING */
@@ -85,13 +158,101 @@ void MusicPlayer::addSongToPlayNext(int id)
         return; 
     }
 
-    /* Add song to the high-priority queue. */
-    playNextQueue.addSong(*song);
+    if (lane != PlayNextLane::Requested)
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+
+        /* Earlier requests keep their place ahead of this song */
+        drainPlayNextInbox();
+        playNextQueue.push(*song, lane);
+        recordOperation(playNextAddOp(lane), song->id);
+
+        lock.unlock();
+        publishQueueChange();
+        std::cout << "Added '" << song->title << "' to Play Next queue.\n";
+        return;
+    }
+
+    /*
+     * Add song to the inbox without taking stateMutex,
+     * so remote producers never wait for the audio thread.
+     */
+    if (!playNextInbox.addSong(*song))
+    {
+        std::cerr << "[Error] Play Next queue is full.\n";
+        return;
+    }
+
+    publishQueueChange();
     std::cout << "Added '" << song->title << "' to Play Next queue.\n";
 }
 
+void MusicPlayer::cancelPlayNext(int songID)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    drainPlayNextInbox();
+
+    if (!playNextQueue.cancel(songID))
+    {
+        std::cerr << "[Warning] Song ID " << songID << " is not in the Play Next queue.\n";
+        return;
+    }
+
+    recordOperation(JournalOp::PlayNextCancel, songID);
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Removed song " << songID << " from Play Next queue.\n";
+}
+
+void MusicPlayer::setPlayNextLane(int songID, PlayNextLane lane)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    drainPlayNextInbox();
+
+    if (!playNextQueue.contains(songID))
+    {
+        std::cerr << "[Warning] Song ID " << songID << " is not in the Play Next queue.\n";
+        return;
+    }
+
+    /* Nothing moves, so nothing is journaled */
+    if (playNextQueue.laneOf(songID) == lane)
+    {
+        return;
+    }
+
+    playNextQueue.setLane(songID, lane);
+
+    /* Queueing a song that is already queued moves it to the new lane */
+    recordOperation(playNextAddOp(lane), songID);
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+void MusicPlayer::drainPlayNextInbox() const
+{
+    /*
+     * Journaled here rather than by addSongToPlayNext, so the records
+     * follow queue order and a drained song is never journaled after
+     * its pop or after a checkpoint that already holds it.
+     */
+    while (const Song* song = playNextInbox.pop())
+    {
+        playNextQueue.push(*song, PlayNextLane::Requested);
+        sessionJournal.append(JournalOp::PlayNextAdd, song->id);
+    }
+}
+
 void MusicPlayer::printPlayNextQueue() const
 {
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    drainPlayNextInbox();
+
     std::cout << "\n--- PLAY NEXT QUEUE ---\n";
 
     if (playNextQueue.isEmpty())
@@ -103,9 +264,215 @@ void MusicPlayer::printPlayNextQueue() const
     playNextQueue.printAllSongs();
 }
 
+void MusicPlayer::addSongToQueue(int songID)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    Song* song = library.findSongByID(songID);
+
+    if (song == nullptr)
+    {
+        std::cerr << "[Error] Cannot add to queue: Song ID " << songID << " not found.\n";
+        return;
+    }
+
+    queueSong(*song, true);
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Added '" << song->title << "' to queue.\n";
+}
+
+void MusicPlayer::addAlbumToQueue(const std::string& albumName)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    /* Journal each song individually; albums are small */
+    for (Song* song : library.findSongsByAlbum(albumName))
+    {
+        queueSong(*song, true);
+    }
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+void MusicPlayer::addLibraryToQueue()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    std::vector<Song>& allSongs = library.getSongs();
+
+    if (allSongs.empty())
+    {
+        std::cout << "Library is empty.\n";
+        return;
+    }
+
+    for (Song& s : allSongs)
+    {
+        queueSong(s, false);
+    }
+
+    /* One checkpoint is cheaper than journaling every song */
+    checkpointSession();
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Added " << allSongs.size() << " songs to queue.\n";
+}
+
+void MusicPlayer::removeSongFromQueue(int songID)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    dequeueSong(songID);
+    recordOperation(JournalOp::QueueRemove, songID);
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+void MusicPlayer::applyBatch(const QueueBatch& batch)
+{
+    if (batch.isEmpty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    size_t skipped = 0;
+
+    /* Earlier Play Next requests stay ahead of the batch's ones */
+    drainPlayNextInbox();
+
+    /* Collect the journal records of every edit; they are written together */
+    batchRecords.clear();
+    batchOpen = true;
+
+    for (const QueueEdit& edit : batch.getEdits())
+    {
+        Song* song = nullptr;
+
+        switch (edit.type)
+        {
+            case QueueEditType::Add:
+                if ((song = library.findSongByID(edit.songID)) != nullptr)
+                {
+                    queueSong(*song, true);
+                }
+                else
+                {
+                    ++skipped;
+                }
+                break;
+
+            case QueueEditType::Remove:
+                dequeueSong(edit.songID);
+                recordOperation(JournalOp::QueueRemove, edit.songID);
+                break;
+
+            case QueueEditType::Move:
+                if (!playbackQueue.moveSong(edit.songID, edit.position))
+                {
+                    ++skipped;
+                }
+                else
+                {
+                    recordOperation(JournalOp::QueueMove, edit.songID);
+                    recordOperation(JournalOp::QueueMoveTo, static_cast<int>(edit.position));
+                }
+                break;
+
+            case QueueEditType::PlayNext:
+                if ((song = library.findSongByID(edit.songID)) == nullptr)
+                {
+                    ++skipped;
+                }
+                else
+                {
+                    playNextQueue.push(*song, PlayNextLane::Requested);
+                    recordOperation(JournalOp::PlayNextAdd, edit.songID);
+                }
+                break;
+        }
+    }
+
+    /* One framed write, so a crash keeps all of the batch or none */
+    batchOpen = false;
+    sessionJournal.appendBatch(batchRecords);
+
+    if (sessionJournal.needsCheckpoint())
+    {
+        checkpointSession();
+    }
+
+    lock.unlock();
+    publishQueueChange();
+
+    if (skipped > 0)
+    {
+        std::cerr << "[Warning] Skipped " << skipped << " batch edits with unknown songs.\n";
+    }
+}
+
+void MusicPlayer::setQueueChangedListener(std::function<void(std::uint64_t)> listener)
+{
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    queueChangedListener = std::move(listener);
+}
+
+std::uint64_t MusicPlayer::getQueueVersion() const
+{
+    return queueVersion;
+}
+
+void MusicPlayer::publishQueueChange()
+{
+    std::function<void(std::uint64_t)> listener;
+
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listener = queueChangedListener;
+    }
+
+    std::uint64_t version = ++queueVersion;
+
+    if (listener)
+    {
+        listener(version);
+    }
+}
+
+void MusicPlayer::enableShuffle(ShuffleMode mode)
+{
+    std::uint64_t seed = 0;
+
+    if (mode == ShuffleMode::Seeded)
+    {
+        std::random_device rd;
+        seed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    }
+
+    startShuffle(mode, seed);
+}
+
+void MusicPlayer::enableShuffleWithSeed(std::uint64_t seed)
+{
+    startShuffle(ShuffleMode::Seeded, seed);
+}
+
+std::uint64_t MusicPlayer::getShuffleSeed() const
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return shuffleSeed;
+}
 
-void MusicPlayer::enableShuffle()
+void MusicPlayer::startShuffle(ShuffleMode mode, std::uint64_t seed)
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Prevent enabling Shuffle twice */
     if (shuffleEnabled)
     {
@@ -113,6 +480,9 @@ void MusicPlayer::enableShuffle()
         return;
     }
 
+    shuffleMode = mode;
+    shuffleSeed = seed;
+
     /* Save original queue if no mode is active */
     if (!baseQueueSaved)
     {
@@ -132,11 +502,26 @@ void MusicPlayer::enableShuffle()
         playbackQueue = applyShuffle(baseQueue);
     }
 
-    std::cout << "Shuffle enabled.\n";
+    /* Mode switches replace whole queues, so snapshot instead of journaling */
+    checkpointSession();
+
+    lock.unlock();
+    publishQueueChange();
+
+    if (mode == ShuffleMode::Seeded)
+    {
+        std::cout << "Shuffle enabled (seed " << seed << ").\n";
+    }
+    else
+    {
+        std::cout << "Shuffle enabled.\n";
+    }
 }
 
 void MusicPlayer::disableShuffle()
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Prevent disabling if Shuffle is not active */
     if (!shuffleEnabled)
     {
@@ -158,12 +543,69 @@ void MusicPlayer::disableShuffle()
         baseQueueSaved = false;
     }
 
+    /* Mode switches replace whole queues, so snapshot instead of journaling */
+    checkpointSession();
+
+    lock.unlock();
+    publishQueueChange();
     std::cout << "Shuffle disabled.\n";
 }
 
 
-void MusicPlayer::enableSmartPlaylist(int startSongID, int maxSize)
+/*
+ * Smart playlist cache parameters: one kind per generator, mixed with
+ * whatever else decides the order it produces.
+ */
+static constexpr std::uint64_t CACHE_BREADTH = 1;
+static constexpr std::uint64_t CACHE_BEST_FIRST = 2;
+static constexpr std::uint64_t CACHE_MIX = 3;
+static constexpr std::uint64_t CACHE_MIX_AFTER_SEEDS = 4;
+
+/* Timed playlists pick from this many neighbours, at most a few per artist */
+static constexpr size_t TIMED_POOL_SIZE = 20000;
+static constexpr size_t TIMED_MAX_PER_ARTIST = 4;
+
+static std::uint64_t mixCacheParameter(std::uint64_t parameters, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    return (parameters ^ bits) * 1099511628211ull;
+}
+
+/* Builds a queue from library indices */
+static PlaybackQueue queueFromIndices(const MusicLibrary& library, const std::vector<std::uint32_t>& songs)
+{
+    PlaybackQueue queue;
+
+    for (std::uint32_t song : songs)
+    {
+        queue.addSong(library.getSongByIndex(song));
+    }
+
+    return queue;
+}
+
+std::uint64_t MusicPlayer::bestFirstCacheParameters() const
+{
+    const ScoreWeights& weights = songScorer.getWeights();
+    std::uint64_t parameters = CACHE_BEST_FIRST;
+
+    for (double value : { weights.sameArtist, weights.sameAlbum, weights.duration,
+                          weights.coPlay, weights.durationScale,
+                          static_cast<double>(SMART_FRONTIER_SIZE),
+                          static_cast<double>(coPlayIndex.getEpoch()) })
+    {
+        parameters = mixCacheParameter(parameters, value);
+    }
+
+    return parameters;
+}
+
+void MusicPlayer::enableSmartPlaylist(int startSongID, int maxSize, SmartPlaylistMode mode)
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Prevent enabling SmartPlaylist twice */
     if (smartPlaylistEnabled)
     {
@@ -181,6 +623,13 @@ void MusicPlayer::enableSmartPlaylist(int startSongID, int maxSize)
         return;
     }
 
+    /* Harmonic mixes go by the seed's tempo and key */
+    if (mode == SmartPlaylistMode::Harmonic && (startSong->bpm == 0 || startSong->key.number == 0))
+    {
+        std::cerr << "[Error] Start song has no tempo or key.\n";
+        return;
+    }
+
     /* Save original queue only once */
     if (!baseQueueSaved)
     {
@@ -189,65 +638,874 @@ void MusicPlayer::enableSmartPlaylist(int startSongID, int maxSize)
     }
 
     /* Generate SmartPlaylist queue */
-    smartQueue = generateSmartPlaylist(*startSong, library, maxSize);
-    smartPlaylistEnabled = true;
+    refreshSimilarityGraph();
 
-    /* Apply shuffle on top of SmartPlaylist if active */
-    if (shuffleEnabled)
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    SmartPlaylistCache::Key key;
+    key.libraryVersion = library.getVersion();
+    key.seeds.push_back({ startSongID, 1.0 });
+
+    if (mode == SmartPlaylistMode::BestFirst)
     {
-        playbackQueue = applyShuffle(smartQueue);
+        loadCoPlayIndex();
+
+        key.parameters = bestFirstCacheParameters();
+    }
+    else if (mode == SmartPlaylistMode::Harmonic)
+    {
+        refreshHarmonicIndex();
     }
     else
     {
-        playbackQueue = smartQueue;
+        key.parameters = CACHE_BREADTH;
     }
 
-    std::cout << "Smart playlist enabled.\n";
-}
+    /*
+     * Cached best-first and breadth-first playlists are unfiltered;
+     * recently played songs are left out here, except the start song,
+     * which always leads.
+     */
+    std::uint32_t startIndex = static_cast<std::uint32_t>(startSong - &library.getSongByIndex(0));
 
-void MusicPlayer::disableSmartPlaylist()
-{
-    /* Prevent disabling if SmartPlaylist is not active */
-    if (!smartPlaylistEnabled)
+    auto accept = [&](std::uint32_t song)
     {
-        std::cerr << "[Info] Smart playlist not enabled.\n";
-        return;
-    }
+        return song == startIndex || !recentPlays.isRecent(library.getSongByIndex(song).id, now);
+    };
 
-    /* Disable SmartPlaylist */
-    smartPlaylistEnabled = false;
+    auto makeGenerator = [&]() -> std::unique_ptr<PlaylistGenerator>
+    {
+        if (mode == SmartPlaylistMode::BestFirst)
+        {
+            return std::make_unique<BestFirstGenerator>(*startSong, library, similarityGraph, songScorer,
+                                                        &coPlayIndex);
+        }
 
-    /* Restore Shuffle if still enabled */
-    if (shuffleEnabled)
+        return std::make_unique<BreadthFirstGenerator>(*startSong, library, similarityGraph);
+    };
+
+    std::vector<std::uint32_t> songs;
+    size_t count = static_cast<size_t>(std::max(maxSize, 1));
+
+    if (mode == SmartPlaylistMode::Harmonic)
     {
-        playbackQueue = applyShuffle(baseQueue);
+        /*
+         * Dropping recent songs from a finished chain would join songs
+         * never checked as key / tempo neighbours, so the walk skips them
+         * itself. That ties the chain to the current recent plays, so it
+         * is not cached.
+         */
+        HarmonicGenerator generator(*startSong, library, harmonicIndex, HARMONIC_SONGS_PER_KEY, &recentPlays, now);
+        std::uint32_t song;
+
+        songs.reserve(count);
+
+        while (songs.size() < count && generator.next(song))
+        {
+            songs.push_back(song);
+        }
     }
     else
     {
-        playbackQueue = baseQueue;
-        baseQueueSaved = false;
+        /* Best-first scores read the co-play counts, which change with every play */
+        std::uint64_t inputVersion = (mode == SmartPlaylistMode::BestFirst) ? coPlayIndex.getVersion() : 0;
+        smartPlaylistCache.fetch(key, count, accept, makeGenerator, songs, inputVersion);
     }
 
-    std::cout << "Smart playlist disabled.\n";
+    smartQueue = queueFromIndices(library, songs);
+
+    installSmartQueue();
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Smart playlist enabled.\n";
 }
 
-PlaybackQueue MusicPlayer::applyShuffle(PlaybackQueue& source)
+void MusicPlayer::enableSmartMix(const std::vector<int>& seedIDs, const std::vector<double>& weights, int maxSize,
+                                 bool includeSeeds)
 {
-    /* Initialize ShuffleManager and prepare playlist */
-    ShuffleManager shuffleManager;
-    std::vector<Song*> playlist;
+    std::unique_lock<std::mutex> lock(stateMutex);
 
-    /* Push all songs from the source queue into the playlist vector */
-    for (Song& s : source.getQueue())
+    /* Prevent enabling SmartPlaylist twice */
+    if (smartPlaylistEnabled)
     {
-        playlist.push_back(&s);
+        std::cerr << "[Info] Smart playlist already enabled.\n";
+        return;
+    }
+
+    /* Collect the seeds that exist; missing weights count as 1 */
+    std::vector<PlaylistSeed> seeds;
+
+    for (size_t i = 0; i < seedIDs.size(); ++i)
+    {
+        const Song* song = library.findSongByID(seedIDs[i]);
+
+        if (song == nullptr)
+        {
+            std::cerr << "[Warning] Seed song " << seedIDs[i] << " not found, skipped.\n";
+            continue;
+        }
+
+        seeds.push_back({ song, (i < weights.size()) ? weights[i] : 1.0 });
+    }
+
+    if (seeds.empty())
+    {
+        std::cerr << "[Error] No seed songs found.\n";
+        return;
+    }
+
+    refreshSimilarityGraph();
+
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    SmartPlaylistCache::Key key;
+    key.parameters = includeSeeds ? CACHE_MIX : CACHE_MIX_AFTER_SEEDS;
+    key.libraryVersion = library.getVersion();
+
+    /* Seed indices, sorted, so the filter below can keep every seed */
+    std::vector<std::uint32_t> seedIndices;
+
+    for (const PlaylistSeed& seed : seeds)
+    {
+        key.seeds.push_back({ seed.song->id, seed.weight });
+        seedIndices.push_back(static_cast<std::uint32_t>(seed.song - &library.getSongByIndex(0)));
+    }
+
+    std::sort(key.seeds.begin(), key.seeds.end());
+    std::sort(seedIndices.begin(), seedIndices.end());
+
+    auto accept = [&](std::uint32_t song)
+    {
+        return std::binary_search(seedIndices.begin(), seedIndices.end(), song)
+            || !recentPlays.isRecent(library.getSongByIndex(song).id, now);
+    };
+
+    size_t count = static_cast<size_t>(std::max(maxSize, 0));
+    size_t length;
+    std::vector<std::uint32_t> songs;
+
+    /*
+     * Multi-seed interleaving depends on the length, so it cannot resume.
+     * A miss is generated without stateMutex, like a batch, so playback
+     * is not held up while the pool is busy.
+     */
+    if (!smartPlaylistCache.lookupWhole(key, count, accept, songs, length))
+    {
+        WorkStealingPool& pool = getWorkerPool();
+        acquireSharedIndexes();
+
+        while (true)
+        {
+            lock.unlock();
+
+            std::vector<std::uint32_t> indices;
+            std::exception_ptr error;
+
+            {
+                std::lock_guard<std::mutex> poolLock(poolMutex);
+
+                try
+                {
+                    PlaybackQueue mix = generateMultiSeedPlaylist(seeds, library, similarityGraph,
+                                                                  static_cast<int>(length), pool,
+                                                                  nullptr, 0, includeSeeds);
+
+                    for (int id : mix.getSongIDs())
+                    {
+                        indices.push_back(static_cast<std::uint32_t>(library.findSongByID(id)
+                                                                     - &library.getSongByIndex(0)));
+                    }
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            lock.lock();
+
+            if (error)
+            {
+                releaseSharedIndexes();
+                std::rethrow_exception(error);
+            }
+
+            if (smartPlaylistCache.storeWhole(key, count, accept, std::move(indices), length, songs))
+            {
+                break;
+            }
+
+            length *= 2;
+        }
+
+        releaseSharedIndexes();
+
+        /* Another request may have turned it on meanwhile */
+        if (smartPlaylistEnabled)
+        {
+            std::cerr << "[Info] Smart playlist already enabled.\n";
+            return;
+        }
+    }
+
+    /* Save original queue only once */
+    if (!baseQueueSaved)
+    {
+        baseQueue = playbackQueue;
+        baseQueueSaved = true;
+    }
+
+    smartQueue = queueFromIndices(library, songs);
+
+    installSmartQueue();
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Smart mix enabled (" << seeds.size() << " seeds).\n";
+}
+
+void MusicPlayer::enableSmartMixFromHistory(size_t seedCount, int maxSize)
+{
+    std::vector<int> seedIDs;
+    std::vector<double> weights;
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        /* Most recent first, weighted seedCount down to 1 */
+        std::vector<int> history = playbackHistory.getSongIDs();
+
+        if (hasCurrentSong)
+        {
+            history.push_back(currentSong.id);
+        }
+
+        for (size_t i = history.size(); i-- > 0 && seedIDs.size() < seedCount; )
+        {
+            seedIDs.push_back(history[i]);
+            weights.push_back(static_cast<double>(seedCount - seedIDs.size() + 1));
+        }
+    }
+
+    if (seedIDs.empty())
+    {
+        std::cerr << "[Error] Nothing played yet to seed a mix from.\n";
+        return;
+    }
+
+    /* The seeds were just heard, so the mix starts with what follows them */
+    enableSmartMix(seedIDs, weights, maxSize, false);
+}
+
+void MusicPlayer::enableTimedPlaylist(int startSongID, int targetSeconds, int toleranceSeconds,
+                                      const std::function<bool(const Song&)>& filter)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    /* Prevent enabling SmartPlaylist twice */
+    if (smartPlaylistEnabled)
+    {
+        std::cerr << "[Info] Smart playlist already enabled.\n";
+        return;
+    }
+
+    if (targetSeconds <= 0)
+    {
+        std::cerr << "[Error] Target length must be positive.\n";
+        return;
+    }
+
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+    /*
+     * Candidates, best first: the seed's neighbourhood by similarity,
+     * or the whole library in random order.
+     */
+    std::vector<std::uint32_t> order;
+
+    if (startSongID != 0)
+    {
+        Song* startSong = library.findSongByID(startSongID);
+
+        if (startSong == nullptr)
+        {
+            std::cerr << "[Error] Start song not found.\n";
+            return;
+        }
+
+        refreshSimilarityGraph();
+        loadCoPlayIndex();
+
+        /* Same cache entry as the best-first smart playlist of this seed */
+        SmartPlaylistCache::Key key;
+        key.parameters = bestFirstCacheParameters();
+        key.libraryVersion = library.getVersion();
+        key.seeds.push_back({ startSongID, 1.0 });
+
+        auto accept = [](std::uint32_t) { return true; };
+
+        auto makeGenerator = [&]() -> std::unique_ptr<PlaylistGenerator>
+        {
+            return std::make_unique<BestFirstGenerator>(*startSong, library, similarityGraph, songScorer,
+                                                        &coPlayIndex);
+        };
+
+        smartPlaylistCache.fetch(key, TIMED_POOL_SIZE, accept, makeGenerator, order, coPlayIndex.getVersion());
+    }
+    else
+    {
+        order.resize(library.getSongCount());
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::shuffle(order.begin(), order.end(), gen);
+    }
+
+    std::vector<const Song*> candidates;
+    candidates.reserve(order.size());
+
+    for (std::uint32_t index : order)
+    {
+        const Song& song = library.getSongByIndex(index);
+
+        if (recentPlays.isRecent(song.id, now) || (filter && !filter(song)))
+        {
+            continue;
+        }
+
+        candidates.push_back(&song);
+    }
+
+    DurationTarget target;
+    target.seconds = targetSeconds;
+    target.tolerance = toleranceSeconds;
+    target.maxPerArtist = TIMED_MAX_PER_ARTIST;
+
+    int total = 0;
+    PlaybackQueue timed = generateTimedPlaylist(candidates, target, &total);
+
+    if (timed.size() == 0)
+    {
+        std::cerr << "[Error] No songs fit the target length.\n";
+        return;
+    }
+
+    /* Save original queue only once */
+    if (!baseQueueSaved)
+    {
+        baseQueue = playbackQueue;
+        baseQueueSaved = true;
+    }
+
+    smartQueue = timed;
+
+    installSmartQueue();
+
+    lock.unlock();
+    publishQueueChange();
+
+    std::cout << "Timed playlist enabled: " << smartQueue.size() << " songs, "
+              << total / 60 << "m " << total % 60 << "s.\n";
+
+    if (total < targetSeconds - std::max(toleranceSeconds, 0))
+    {
+        std::cerr << "[Warning] " << (targetSeconds - total) << "s short of the target.\n";
+    }
+}
+
+void MusicPlayer::acquireSharedIndexes()
+{
+    ++sharedIndexReaders;
+}
+
+void MusicPlayer::releaseSharedIndexes()
+{
+    /* Fold in the plays logged while the indexes were shared */
+    if (--sharedIndexReaders == 0)
+    {
+        for (const ListeningEvent& event : deferredCoPlays)
+        {
+            coPlayIndex.record(event);
+        }
+
+        deferredCoPlays.clear();
+    }
+}
+
+BatchReport MusicPlayer::generatePlaylistBatch(const std::vector<PlaylistJob>& jobs,
+                                               std::vector<std::vector<std::uint32_t>>& playlists)
+{
+    bool harmonic = std::any_of(jobs.begin(), jobs.end(), [](const PlaylistJob& job)
+    {
+        return job.mode == SmartPlaylistMode::Harmonic;
+    });
+
+    WorkStealingPool* pool;
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        /* Bring every shared structure up to date before the workers read it */
+        refreshSimilarityGraph();
+        loadCoPlayIndex();
+
+        if (harmonic)
+        {
+            refreshHarmonicIndex();
+        }
+
+        pool = &getWorkerPool();
+        acquireSharedIndexes();
+    }
+
+    /* The batch runs without stateMutex, so playback is not held up */
+    BatchReport report;
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> poolLock(poolMutex);
+
+        try
+        {
+            report = ::generatePlaylistBatch(jobs, library, similarityGraph, songScorer, *pool, playlists,
+                                             &coPlayIndex, harmonic ? &harmonicIndex : nullptr);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        releaseSharedIndexes();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return report;
+}
+
+void MusicPlayer::analyzeLibraryAudio()
+{
+    /*
+     * Copy what the workers need, so the player stays usable meanwhile.
+     */
+    std::vector<int> ids;
+    std::vector<std::string> paths;
+    WorkStealingPool* pool;
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        for (size_t i = 0; i < library.getSongCount(); ++i)
+        {
+            ids.push_back(library.getSongByIndex(i).id);
+            paths.push_back(library.getSongByIndex(i).path);
+        }
+
+        pool = &getWorkerPool();
+    }
+
+    std::vector<FeatureVector> features(ids.size());
+    std::vector<char> analysed(ids.size(), 0);
+    std::vector<std::string> failures(ids.size());
+    std::vector<double> durations(ids.size(), 0.0);
+    std::atomic<size_t> nextSong {0};
+
+    std::unique_lock<std::mutex> poolLock(poolMutex);
+
+    auto started = std::chrono::steady_clock::now();
+
+    /* One task per worker, each with its own analyzer and decode buffer */
+    for (size_t t = 0; t < pool->threadCount(); ++t)
+    {
+        pool->submit([&]()
+        {
+            AudioAnalyzer analyzer;
+            AudioClip clip;
+
+            for (size_t i; (i = nextSong.fetch_add(1)) < ids.size(); )
+            {
+                /* One bad file must not end the whole run */
+                try
+                {
+                    if (decodeWav(paths[i], clip) && analyzer.analyze(clip, features[i]))
+                    {
+                        analysed[i] = 1;
+                        durations[i] = static_cast<double>(clip.samples.size()) / clip.sampleRate;
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    failures[i] = e.what();
+                }
+            }
+        });
+    }
+
+    pool->wait();
+    poolLock.unlock();
+
+    double audioSeconds = 0.0;
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (!failures[i].empty())
+        {
+            std::cerr << "[Warning] Could not analyse " << paths[i] << ": " << failures[i] << "\n";
+        }
+
+        audioSeconds += durations[i];
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    /*
+     * Add the results to a copy and cluster it without stateMutex,
+     * since k-means over a large catalog takes a while.
+     */
+    std::lock_guard<std::mutex> updateLock(acousticUpdateMutex);
+    AcousticIndex updated;
+
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+
+        loadAcousticIndex(lock);
+        updated = acousticIndex;
+    }
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (analysed[i])
+        {
+            updated.add(ids[i], features[i]);
+            ++count;
+        }
+    }
+
+    if (updated.size() >= AcousticIndex::APPROXIMATE_THRESHOLD)
+    {
+        updated.buildApproximate();
+    }
+
+    if (!updated.save(ACOUSTIC_FEATURES_PATH))
+    {
+        std::cerr << "[Warning] Could not save acoustic features: " << ACOUSTIC_FEATURES_PATH << "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        /* The old index is freed once the lock is gone */
+        std::swap(acousticIndex, updated);
+    }
+
+    std::cout << "Analysed " << count << " of " << ids.size() << " songs ("
+              << static_cast<long long>(audioSeconds)
+              << " s of audio) in " << static_cast<long long>(seconds * 1000) << " ms";
+
+    if (seconds > 0.0 && count > 0)
+    {
+        /* Throughput of one worker, so it does not grow with the thread count */
+        std::cout << ", " << static_cast<long long>(audioSeconds / seconds / pool->threadCount())
+                  << "x realtime per thread";
+    }
+
+    std::cout << ".\n";
+}
+
+void MusicPlayer::printSimilarSounding(int songID, size_t count)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    loadAcousticIndex(lock);
+
+    FeatureVector features;
+
+    if (!acousticIndex.featuresOf(songID, features))
+    {
+        std::cerr << "[Error] Song " << songID << " has not been analysed.\n";
+        return;
+    }
+
+    /* One extra: the song itself comes first */
+    std::vector<AcousticIndex::Match> matches;
+    acousticIndex.nearestApproximate(features, count + 1, matches);
+
+    size_t shown = 0;
+
+    for (const AcousticIndex::Match& match : matches)
+    {
+        const Song* song = library.findSongByID(match.songID);
+
+        if (match.songID == songID || song == nullptr || shown == count)
+        {
+            continue;
+        }
+
+        std::cout << "  " << (++shown) << ". " << song->title << " - " << song->artist
+                  << " (distance " << match.distance << ")\n";
+    }
+
+    if (shown == 0)
+    {
+        std::cout << "No other analysed songs.\n";
+    }
+}
+
+void MusicPlayer::loadAcousticIndex(std::unique_lock<std::mutex>& lock)
+{
+    if (acousticIndexLoaded)
+    {
+        return;
+    }
+
+    /* Read and cluster without stateMutex; a missing file just means nothing was analysed yet */
+    lock.unlock();
+
+    AcousticIndex loaded;
+    loaded.load(ACOUSTIC_FEATURES_PATH);
+
+    if (loaded.size() >= AcousticIndex::APPROXIMATE_THRESHOLD)
+    {
+        loaded.buildApproximate();
+    }
+
+    lock.lock();
+
+    /* Another caller may have loaded it meanwhile */
+    if (!acousticIndexLoaded)
+    {
+        std::swap(acousticIndex, loaded);
+        acousticIndexLoaded = true;
+    }
+}
+
+void MusicPlayer::refreshSimilarityGraph()
+{
+    if (!similarityGraph.isCurrent(library))
+    {
+        /* Cached generators point into the old graph */
+        smartPlaylistCache.clear();
+        similarityGraph.build(library);
+    }
+}
+
+void MusicPlayer::refreshHarmonicIndex()
+{
+    if (!harmonicIndex.isCurrent(library))
+    {
+        harmonicIndex.build(library);
+    }
+}
+
+void MusicPlayer::loadCoPlayIndex()
+{
+    /* One streaming pass over the log; later plays are folded in as they are logged */
+    if (!coPlayIndexLoaded && listeningLog.isOpen())
+    {
+        coPlayIndex.build(listeningLog);
+        coPlayIndexLoaded = true;
+    }
+}
+
+WorkStealingPool& MusicPlayer::getWorkerPool()
+{
+    /* Threads are only started once something needs them */
+    if (!workerPool)
+    {
+        workerPool = std::make_unique<WorkStealingPool>();
+    }
+
+    return *workerPool;
+}
+
+void MusicPlayer::installSmartQueue()
+{
+    smartPlaylistEnabled = true;
+
+    /* Apply shuffle on top of SmartPlaylist if active */
+    if (shuffleEnabled)
+    {
+        playbackQueue = applyShuffle(smartQueue);
+    }
+    else
+    {
+        playbackQueue = smartQueue;
+    }
+
+    /* Mode switches replace whole queues, so snapshot instead of journaling */
+    checkpointSession();
+}
+
+void MusicPlayer::disableSmartPlaylist()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    /* Prevent disabling if SmartPlaylist is not active */
+    if (!smartPlaylistEnabled)
+    {
+        std::cerr << "[Info] Smart playlist not enabled.\n";
+        return;
+    }
+
+    /* Disable SmartPlaylist */
+    smartPlaylistEnabled = false;
+
+    /* Restore Shuffle if still enabled */
+    if (shuffleEnabled)
+    {
+        playbackQueue = applyShuffle(baseQueue);
+    }
+    else
+    {
+        playbackQueue = baseQueue;
+        baseQueueSaved = false;
+    }
+
+    /* Mode switches replace whole queues, so snapshot instead of journaling */
+    checkpointSession();
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Smart playlist disabled.\n";
+}
+
+void MusicPlayer::enableSmartRadio(int startSongID)
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    if (smartRadio)
+    {
+        std::cerr << "[Info] Smart radio already on.\n";
+        return;
+    }
+
+    Song* startSong = library.findSongByID(startSongID);
+
+    if (startSong == nullptr)
+    {
+        std::cerr << "[Error] Start song not found.\n";
+        return;
+    }
+
+    refreshSimilarityGraph();
+    loadCoPlayIndex();
+
+    /* Only the first few songs are chosen now; the rest as they play */
+    smartRadio = std::make_unique<SmartRadio>(*startSong, library, similarityGraph, songScorer,
+                                              &coPlayIndex, &recentPlays);
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Smart radio on.\n";
+}
+
+void MusicPlayer::disableSmartRadio()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    if (!smartRadio)
+    {
+        std::cerr << "[Info] Smart radio not on.\n";
+        return;
+    }
+
+    smartRadio.reset();
+
+    lock.unlock();
+    publishQueueChange();
+    std::cout << "Smart radio off.\n";
+}
+
+PlaybackQueue& MusicPlayer::shuffleSource()
+{
+    return smartPlaylistEnabled ? smartQueue : baseQueue;
+}
+
+void MusicPlayer::queueSong(Song& song, bool journal)
+{
+    size_t before = playbackQueue.size();
+    size_t position = before;
+
+    if (!shuffleEnabled)
+    {
+        playbackQueue.addSong(song);
+    }
+    else
+    {
+        /* Keep the unshuffled order for when shuffle is turned off */
+        shuffleSource().addSong(song);
+        position = shuffleManager.insertSong(playbackQueue, song);
+    }
+
+    /* Songs already queued are left alone and need no record */
+    if (!journal || playbackQueue.size() == before)
+    {
+        return;
+    }
+
+    recordOperation(JournalOp::QueueAdd, song.id);
+
+    if (shuffleEnabled)
+    {
+        recordOperation(JournalOp::QueueInsertAt, static_cast<int>(position));
+    }
+}
+
+void MusicPlayer::dequeueSong(int songID)
+{
+    playbackQueue.removeSongById(songID);
+
+    if (shuffleEnabled)
+    {
+        shuffleSource().removeSongById(songID);
+    }
+}
+
+PlaybackQueue MusicPlayer::applyShuffle(PlaybackQueue& source)
+{
+    /* Prepare playlist for the ShuffleManager */
+    std::vector<Song*> playlist;
+    playlist.reserve(source.size());
+
+    /* Push all songs from the source queue into the playlist vector */
+    for (Song& s : source.getQueue())
+    {
+        playlist.push_back(&s);
     }
 
     /* Initialize and generate shuffled queue */
-    shuffleManager.initialize(playlist);
+    if (shuffleMode == ShuffleMode::Seeded)
+    {
+        shuffleManager.initialize(playlist, shuffleSeed);
+    }
+    else if (shuffleMode == ShuffleMode::Spread)
+    {
+        shuffleManager.initializeSpread(playlist);
+    }
+    else if (shuffleMode == ShuffleMode::Weighted)
+    {
+        shuffleManager.initializeWeighted(playlist, shuffleWeights(playlist));
+    }
+    else
+    {
+        shuffleManager.initialize(playlist);
+    }
 
     /* Create a new PlaybackQueue with the shuffled songs */
     PlaybackQueue result;
+    result.reserve(playlist.size());
 
     /* Add all shuffled songs to the result queue */
     while (Song* s = shuffleManager.getNextSong())
@@ -258,40 +1516,96 @@ PlaybackQueue MusicPlayer::applyShuffle(PlaybackQueue& source)
     return result;
 }
 
+std::vector<double> MusicPlayer::shuffleWeights(const std::vector<Song*>& playlist) const
+{
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+    /* One pass over each column instead of one query per song */
+    std::vector<std::uint64_t> plays = listeningLog.playsPerSong(now - WEIGHT_HISTORY_SECONDS, now + 1);
+    std::vector<std::uint64_t> skips = listeningLog.skipsPerSong(now - WEIGHT_HISTORY_SECONDS, now + 1);
+
+    std::vector<double> weights(playlist.size(), 1.0);
+
+    for (size_t i = 0; i < playlist.size(); ++i)
+    {
+        int id = playlist[i]->id;
+
+        if (id < 0 || static_cast<size_t>(id) >= plays.size())
+        {
+            continue;
+        }
+
+        /* Unheard songs weigh 1; each full listen adds 1, each skip divides */
+        double skipped = static_cast<double>(skips[id]);
+        double finished = static_cast<double>(plays[id]) - skipped;
+
+        weights[i] = (1.0 + finished) / (1.0 + skipped);
+    }
+
+    return weights;
+}
+
 void MusicPlayer::enableRepeat()
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Enable continuous replay of the current song */
     repeatEnabled = true;
+    recordOperation(JournalOp::SetRepeat, 1);
+    lock.unlock();
+    publishQueueChange();
     std::cout << "Repeat enabled.\n";
 }
 
 void MusicPlayer::disableRepeat()
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Disable continuous replay and allow normal playlist progression */
     repeatEnabled = false;
+    recordOperation(JournalOp::SetRepeat, 0);
+    lock.unlock();
+    publishQueueChange();
     std::cout << "Repeat disabled.\n";
 }
 
 void MusicPlayer::playNext()
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* Archive current song to history. */
     if (hasCurrentSong)
     {
+        logListeningEvent();
         playbackHistory.pushSong(currentSong);
+        recordOperation(JournalOp::HistoryPush, currentSong.id);
     }
 
-    /* Priority 1: Check the "Play Next" specific queue. */
+    /* Library index of the song the smart radio plays, if it is next */
+    std::uint32_t radioSong;
+
+    /* Priority 1: Check the "Play Next" specific queue, most urgent lane first. */
+    drainPlayNextInbox();
+
     if (!playNextQueue.isEmpty())
     {
         std::cout << "Playing from PlayNextQueue...\n";
         currentSong = playNextQueue.playNext();
+        recordOperation(JournalOp::PlayNextPop);
+    }
+    /* Priority 2: The smart radio, which never runs out. */
+    else if (smartRadio && smartRadio->next(radioSong))
+    {
+        std::cout << "Playing from Smart Radio...\n";
+        currentSong = library.getSongByIndex(radioSong);
     }
-    /* Priority 2: Continue with the standard playback queue. */
+    /* Priority 3: Continue with the standard playback queue. */
     else if (!playbackQueue.isEmpty())
     {
         std::cout << "Playing from PlaybackQueue...\n";      
         currentSong = playbackQueue.getCurrentSong();
         playbackQueue.playNext();
+        recordOperation(JournalOp::QueueAdvance);
     }
     else
     {
@@ -300,15 +1614,24 @@ void MusicPlayer::playNext()
         return;
     }
 
+    currentStartedAt = std::chrono::system_clock::now();
+    playStatistics.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
+    recentPlays.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
     hasCurrentSong = true;
     isPaused = false;
+    recordOperation(JournalOp::SetCurrent, currentSong.id);
 
     /* Trigger playback. */
     playSong(currentSong);
+
+    lock.unlock();
+    publishQueueChange();
 }
 
 void MusicPlayer::playPrevious()
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     /* ERROR HANDLING */
     if (playbackHistory.isEmpty())
     {
@@ -316,11 +1639,73 @@ void MusicPlayer::playPrevious()
         return;
     }
 
+    if (hasCurrentSong)
+    {
+        logListeningEvent();
+    }
+
     /* Retrieve last song (LIFO). */
     currentSong = playbackHistory.playPreviousSong();
+    currentStartedAt = std::chrono::system_clock::now();
+    recentPlays.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
     hasCurrentSong = true;
+    recordOperation(JournalOp::HistoryPop);
+    recordOperation(JournalOp::SetCurrent, currentSong.id);
 
     playSong(currentSong);
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+std::vector<UpcomingSong> MusicPlayer::peekUpcoming(size_t count) const
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    std::vector<UpcomingSong> upcoming;
+    upcoming.reserve(count);
+
+    /* Repeat replays the current song when it finishes naturally */
+    if (repeatEnabled && hasCurrentSong && upcoming.size() < count)
+    {
+        upcoming.push_back({ currentSong, UpcomingSource::Repeat });
+    }
+
+    /* Priority 1: the "Play Next" queue in lane order */
+    drainPlayNextInbox();
+
+    std::vector<const Song*> queued;
+    playNextQueue.peekUpcoming(count - upcoming.size(), queued);
+
+    for (const Song* song : queued)
+    {
+        upcoming.push_back({ *song, UpcomingSource::PlayNext });
+    }
+
+    /* Priority 2: the radio's prefetched songs; the queue waits behind it */
+    if (smartRadio)
+    {
+        std::vector<std::uint32_t> radioSongs;
+        smartRadio->peek(count - upcoming.size(), radioSongs);
+
+        for (std::uint32_t song : radioSongs)
+        {
+            upcoming.push_back({ library.getSongByIndex(song), UpcomingSource::Radio });
+        }
+
+        return upcoming;
+    }
+
+    /* Priority 3: the playback queue from its cursor, wrapping around */
+    queued.clear();
+    playbackQueue.peekUpcoming(count - upcoming.size(), queued);
+
+    for (const Song* song : queued)
+    {
+        upcoming.push_back({ *song, UpcomingSource::Queue });
+    }
+
+    return upcoming;
 }
 
 /* --- Getters & Setters --- */
@@ -335,7 +1720,7 @@ PlaybackQueue& MusicPlayer::getPlaybackQueue()
     return playbackQueue;
 }
 
-PlayNextQueue& MusicPlayer::getPlayNextQueue()
+PriorityPlayNextQueue& MusicPlayer::getPlayNextQueue()
 {
     return playNextQueue;
 }
@@ -345,9 +1730,376 @@ PlaybackHistory& MusicPlayer::getPlaybackHistory()
     return playbackHistory;
 }
 
+const ListeningLog& MusicPlayer::getListeningLog() const
+{
+    return listeningLog;
+}
+
+const PlayStatistics& MusicPlayer::getPlayStatistics() const
+{
+    return playStatistics;
+}
+
+void MusicPlayer::printMostPlayed(StatsWindow window, size_t count) const
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    std::int64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+    std::vector<TopItem> songs = playStatistics.topSongs(window, now);
+    std::vector<TopItem> artists = playStatistics.topArtists(window, now);
+    std::vector<TopItem> albums = playStatistics.topAlbums(window, now);
+
+    std::cout << "Top songs:\n";
+    for (size_t i = 0; i < songs.size() && i < count; ++i)
+    {
+        const Song* song = library.findSongByID(songs[i].id);
+        std::cout << "  " << (i + 1) << ". " << (song ? song->title : "?")
+                  << " (" << songs[i].score << ")\n";
+    }
+
+    std::cout << "Top artists:\n";
+    for (size_t i = 0; i < artists.size() && i < count; ++i)
+    {
+        std::cout << "  " << (i + 1) << ". " << playStatistics.artistName(artists[i].id)
+                  << " (" << artists[i].score << ")\n";
+    }
+
+    std::cout << "Top albums:\n";
+    for (size_t i = 0; i < albums.size() && i < count; ++i)
+    {
+        std::cout << "  " << (i + 1) << ". " << playStatistics.albumName(albums[i].id)
+                  << " (" << albums[i].score << ")\n";
+    }
+}
+
+void MusicPlayer::setRecentlyPlayedWindow(std::uint32_t plays, std::int64_t seconds)
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    recentPlays.setWindow(plays, seconds);
+
+    /* A wider window may reach plays that were never loaded */
+    if (listeningLog.isOpen())
+    {
+        recentPlays.load(listeningLog, std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    }
+
+    /* The song playing now started after the last logged event */
+    if (hasCurrentSong)
+    {
+        recentPlays.recordPlay(currentSong.id, std::chrono::system_clock::to_time_t(currentStartedAt));
+    }
+}
+
+void MusicPlayer::logListeningEvent()
+{
+    auto now = std::chrono::system_clock::now();
+    auto listened = std::chrono::duration_cast<std::chrono::seconds>(now - currentStartedAt).count();
+
+    /* Wall-clock time includes pauses, so cap it at the song length */
+    if (listened > currentSong.duration)
+    {
+        listened = currentSong.duration;
+    }
+
+    ListeningEvent event;
+    event.songID = currentSong.id;
+    event.timestamp = std::chrono::duration_cast<std::chrono::seconds>(currentStartedAt.time_since_epoch()).count();
+    event.secondsListened = static_cast<int>(listened);
+
+    /* One second of slack for the audio thread's polling interval */
+    event.skipped = listened + 1 < currentSong.duration;
+
+    listeningLog.append(event);
+
+    /* Before the first load the log has it; afterwards it is folded in here */
+    if (coPlayIndexLoaded && sharedIndexReaders > 0)
+    {
+        deferredCoPlays.push_back(event);
+    }
+    else if (coPlayIndexLoaded)
+    {
+        coPlayIndex.record(event);
+    }
+}
+
 void MusicPlayer::setPlaybackQueue(PlaybackQueue& pb)
 {
+    std::unique_lock<std::mutex> lock(stateMutex);
+
     playbackQueue = pb;
+    checkpointSession();
+
+    lock.unlock();
+    publishQueueChange();
+}
+
+/* =============================================================
+ * SESSION PERSISTENCE
+ * ============================================================= */
+
+/* Converts a queue into its journal representation */
+static QueueSnapshot snapshotQueue(const PlaybackQueue& queue)
+{
+    QueueSnapshot snapshot;
+    snapshot.songIDs = queue.getSongIDs();
+    snapshot.currentIndex = queue.getCurrentIndex();
+    return snapshot;
+}
+
+/* Rebuilds a queue from its journal representation */
+static void restoreQueue(const QueueSnapshot& snapshot, MusicLibrary& library, PlaybackQueue& queue)
+{
+    queue = PlaybackQueue();
+
+    /* Stays out of range (no current song) unless a position is found */
+    size_t currentIndex = static_cast<size_t>(-1);
+
+    for (size_t i = 0; i < snapshot.songIDs.size(); ++i)
+    {
+        Song* song = library.findSongByID(snapshot.songIDs[i]);
+
+        /* Skip songs removed from the library since the checkpoint */
+        if (song == nullptr)
+        {
+            continue;
+        }
+
+        /* The first surviving song at or after the saved position is current */
+        if (i >= snapshot.currentIndex && currentIndex == static_cast<size_t>(-1))
+        {
+            currentIndex = queue.size();
+        }
+
+        queue.addSong(*song);
+    }
+
+    queue.setCurrentIndex(currentIndex);
+}
+
+void MusicPlayer::recordOperation(JournalOp op, int arg)
+{
+    if (batchOpen)
+    {
+        batchRecords.push_back({ op, arg });
+        return;
+    }
+
+    sessionJournal.append(op, arg);
+
+    if (sessionJournal.needsCheckpoint())
+    {
+        checkpointSession();
+    }
+}
+
+SessionSnapshot MusicPlayer::captureSession() const
+{
+    SessionSnapshot snapshot;
+
+    snapshot.playbackQueue = snapshotQueue(playbackQueue);
+    snapshot.baseQueue = snapshotQueue(baseQueue);
+    snapshot.smartQueue = snapshotQueue(smartQueue);
+    drainPlayNextInbox();
+    snapshot.playNextIDs = playNextQueue.getSongIDs();
+
+    for (int id : snapshot.playNextIDs)
+    {
+        snapshot.playNextLanes.push_back(static_cast<int>(playNextQueue.laneOf(id)));
+    }
+
+    snapshot.historyIDs = playbackHistory.getSongIDs();
+    snapshot.currentSongID = currentSong.id;
+    snapshot.hasCurrentSong = hasCurrentSong;
+    snapshot.baseQueueSaved = baseQueueSaved;
+    snapshot.smartPlaylistEnabled = smartPlaylistEnabled;
+    snapshot.shuffleEnabled = shuffleEnabled;
+    snapshot.repeatEnabled = repeatEnabled;
+    snapshot.shuffleMode = static_cast<int>(shuffleMode);
+    snapshot.shuffleSeed = shuffleSeed;
+
+    return snapshot;
+}
+
+void MusicPlayer::checkpointSession()
+{
+    sessionJournal.writeCheckpoint(captureSession());
+}
+
+void MusicPlayer::restoreSession()
+{
+    SessionSnapshot snapshot;
+    std::vector<JournalRecord> records;
+
+    if (sessionJournal.load(snapshot, records))
+    {
+        restoreQueue(snapshot.playbackQueue, library, playbackQueue);
+        restoreQueue(snapshot.baseQueue, library, baseQueue);
+        restoreQueue(snapshot.smartQueue, library, smartQueue);
+
+        /* Checkpoints list the queue in play order, so lanes stay FIFO */
+        for (size_t i = 0; i < snapshot.playNextIDs.size(); ++i)
+        {
+            PlayNextLane lane = (i < snapshot.playNextLanes.size())
+                              ? static_cast<PlayNextLane>(snapshot.playNextLanes[i])
+                              : PlayNextLane::Requested;
+
+            if (Song* song = library.findSongByID(snapshot.playNextIDs[i]))
+            {
+                playNextQueue.push(*song, lane);
+            }
+        }
+
+        for (int id : snapshot.historyIDs)
+        {
+            if (Song* song = library.findSongByID(id))
+            {
+                playbackHistory.pushSong(*song);
+            }
+        }
+
+        Song* current = library.findSongByID(snapshot.currentSongID);
+        hasCurrentSong = snapshot.hasCurrentSong && current != nullptr;
+
+        if (hasCurrentSong)
+        {
+            currentSong = *current;
+        }
+
+        baseQueueSaved = snapshot.baseQueueSaved;
+        smartPlaylistEnabled = snapshot.smartPlaylistEnabled;
+        shuffleEnabled = snapshot.shuffleEnabled;
+        repeatEnabled = snapshot.repeatEnabled;
+
+        /*
+         * The shuffled order itself is the restored playbackQueue; mode
+         * and seed are only kept so getShuffleSeed() reports the seed
+         */
+        shuffleMode = static_cast<ShuffleMode>(snapshot.shuffleMode);
+        shuffleSeed = snapshot.shuffleSeed;
+
+        /* Apply everything that happened after the checkpoint */
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            /* A move is journaled as the song followed by its new position */
+            if (records[i].op == JournalOp::QueueMove && i + 1 < records.size() &&
+                records[i + 1].op == JournalOp::QueueMoveTo)
+            {
+                playbackQueue.moveSong(records[i].arg, static_cast<size_t>(records[i + 1].arg));
+                ++i;
+                continue;
+            }
+
+            replayOperation(records[i]);
+        }
+
+        std::cout << "Session restored (" << records.size() << " journaled operations).\n";
+    }
+
+    /* Compact the replayed journal and open it for new operations */
+    checkpointSession();
+}
+
+void MusicPlayer::replayOperation(const JournalRecord& record)
+{
+    Song* song = nullptr;
+
+    switch (record.op)
+    {
+        case JournalOp::QueueAdd:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                if (shuffleEnabled)
+                {
+                    shuffleSource().addSong(*song);
+                }
+
+                playbackQueue.addSong(*song);
+            }
+            break;
+
+        case JournalOp::QueueInsertAt:
+            /* The preceding QueueAdd appended the song; move it into place */
+            if (!playbackQueue.isEmpty())
+            {
+                Song last = playbackQueue.getQueue().back();
+
+                playbackQueue.removeSongById(last.id);
+                playbackQueue.insertSong(last, static_cast<size_t>(record.arg));
+            }
+            break;
+
+        case JournalOp::QueueRemove:
+            dequeueSong(record.arg);
+            break;
+
+        case JournalOp::QueueAdvance:
+            playbackQueue.playNext();
+            break;
+
+        case JournalOp::PlayNextAdd:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                playNextQueue.push(*song, PlayNextLane::Requested);
+            }
+            break;
+
+        case JournalOp::PlayNextUrgent:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                playNextQueue.push(*song, PlayNextLane::Urgent);
+            }
+            break;
+
+        case JournalOp::PlayNextSuggested:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                playNextQueue.push(*song, PlayNextLane::Suggested);
+            }
+            break;
+
+        case JournalOp::PlayNextCancel:
+            playNextQueue.cancel(record.arg);
+            break;
+
+        case JournalOp::PlayNextPop:
+            if (!playNextQueue.isEmpty())
+            {
+                playNextQueue.playNext();
+            }
+            break;
+
+        case JournalOp::HistoryPush:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                playbackHistory.pushSong(*song);
+            }
+            break;
+
+        case JournalOp::HistoryPop:
+            if (!playbackHistory.isEmpty())
+            {
+                playbackHistory.playPreviousSong();
+            }
+            break;
+
+        case JournalOp::SetCurrent:
+            if ((song = library.findSongByID(record.arg)) != nullptr)
+            {
+                currentSong = *song;
+                hasCurrentSong = true;
+            }
+            break;
+
+        case JournalOp::SetRepeat:
+            repeatEnabled = (record.arg != 0);
+            break;
+
+        default:
+            /* Unknown records come from a newer format; ignore them */
+            break;
+    }
 }
 
 /* =============================================================
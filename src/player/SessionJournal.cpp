@@ -0,0 +1,344 @@
+#include "SessionJournal.h"
+#include <iostream>
+
+/* File identification and format version */
+static constexpr std::uint32_t CHECKPOINT_MAGIC = 0x4B43504D;   /* "MPCK" */
+static constexpr std::uint32_t JOURNAL_MAGIC    = 0x4C4A504D;   /* "MPJL" */
+static constexpr std::uint32_t FORMAT_VERSION   = 5;
+
+/*
+ * Oldest format that can still be read (version 1 has no Play Next
+ * lanes, version 2 no batch records, version 3 no shuffle state;
+ * version 4 also stores an unused shuffle position)
+ */
+static constexpr std::uint32_t MIN_FORMAT_VERSION = 1;
+
+/* =============================================================
+ * BINARY HELPERS
+ * ============================================================= */
+
+template <typename T>
+static bool writeValue(std::FILE* file, const T& value)
+{
+    return std::fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+static bool readValue(std::FILE* file, T& value)
+{
+    return std::fread(&value, sizeof(T), 1, file) == 1;
+}
+
+static bool writeIDs(std::FILE* file, const std::vector<int>& ids)
+{
+    std::uint64_t count = ids.size();
+
+    if (!writeValue(file, count))
+    {
+        return false;
+    }
+
+    return ids.empty() || std::fwrite(ids.data(), sizeof(int), ids.size(), file) == ids.size();
+}
+
+static bool readIDs(std::FILE* file, std::vector<int>& ids)
+{
+    std::uint64_t count = 0;
+
+    if (!readValue(file, count))
+    {
+        return false;
+    }
+
+    /* Reject sizes that could not have been written by this program */
+    if (count > (static_cast<std::uint64_t>(1) << 32))
+    {
+        return false;
+    }
+
+    ids.resize(static_cast<std::size_t>(count));
+
+    return ids.empty() || std::fread(ids.data(), sizeof(int), ids.size(), file) == ids.size();
+}
+
+static bool writeQueue(std::FILE* file, const QueueSnapshot& queue)
+{
+    return writeIDs(file, queue.songIDs) && writeValue(file, queue.currentIndex);
+}
+
+static bool readQueue(std::FILE* file, QueueSnapshot& queue)
+{
+    return readIDs(file, queue.songIDs) && readValue(file, queue.currentIndex);
+}
+
+static std::uint8_t packFlags(const SessionSnapshot& s)
+{
+    return static_cast<std::uint8_t>((s.hasCurrentSong       ? 1 : 0)
+                                   | (s.baseQueueSaved       ? 2 : 0)
+                                   | (s.smartPlaylistEnabled ? 4 : 0)
+                                   | (s.shuffleEnabled       ? 8 : 0)
+                                   | (s.repeatEnabled        ? 16 : 0));
+}
+
+static void unpackFlags(std::uint8_t flags, SessionSnapshot& s)
+{
+    s.hasCurrentSong       = (flags & 1) != 0;
+    s.baseQueueSaved       = (flags & 2) != 0;
+    s.smartPlaylistEnabled = (flags & 4) != 0;
+    s.shuffleEnabled       = (flags & 8) != 0;
+    s.repeatEnabled        = (flags & 16) != 0;
+}
+
+/* =============================================================
+ * CLASS IMPLEMENTATION
+ * ============================================================= */
+
+SessionJournal::SessionJournal(const std::string& journalPath, const std::string& checkpointPath)
+    : journalPath(journalPath), checkpointPath(checkpointPath)
+{
+}
+
+SessionJournal::~SessionJournal()
+{
+    if (journalFile != nullptr)
+    {
+        std::fclose(journalFile);
+    }
+}
+
+bool SessionJournal::readCheckpoint(const std::string& path, SessionSnapshot& snapshot)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t gen = 0;
+    std::uint8_t flags = 0;
+    std::int32_t currentID = 0;
+    std::uint64_t shufflePosition = 0;
+
+    bool ok = readValue(file, magic) && magic == CHECKPOINT_MAGIC
+           && readValue(file, version)
+           && version >= MIN_FORMAT_VERSION && version <= FORMAT_VERSION
+           && readValue(file, gen)
+           && readValue(file, flags)
+           && readValue(file, currentID)
+           && readQueue(file, snapshot.playbackQueue)
+           && readQueue(file, snapshot.baseQueue)
+           && readQueue(file, snapshot.smartQueue)
+           && readIDs(file, snapshot.playNextIDs)
+           && readIDs(file, snapshot.historyIDs)
+           && (version < 2 || readIDs(file, snapshot.playNextLanes))
+           && (version < 4 || (readValue(file, snapshot.shuffleMode)
+                               && readValue(file, snapshot.shuffleSeed)))
+           && (version != 4 || readValue(file, shufflePosition));
+
+    std::fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "[Warning] Ignoring damaged session checkpoint: " << path << "\n";
+        snapshot = SessionSnapshot();
+        return false;
+    }
+
+    unpackFlags(flags, snapshot);
+    snapshot.currentSongID = currentID;
+    generation = gen;
+
+    return true;
+}
+
+bool SessionJournal::load(SessionSnapshot& snapshot, std::vector<JournalRecord>& records)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    records.clear();
+
+    /* Fall back to the temporary file if a replace was interrupted */
+    if (!readCheckpoint(checkpointPath, snapshot) &&
+        !readCheckpoint(checkpointPath + ".tmp", snapshot))
+    {
+        return false;
+    }
+
+    std::FILE* file = std::fopen(journalPath.c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        return true;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t gen = 0;
+
+    /* Records written before the checkpoint are already part of it */
+    if (readValue(file, magic) && magic == JOURNAL_MAGIC &&
+        readValue(file, version) && version >= MIN_FORMAT_VERSION && version <= FORMAT_VERSION &&
+        readValue(file, gen) && gen == generation)
+    {
+        JournalRecord record {};
+
+        /* A short read means a torn tail record, which is dropped */
+        while (readValue(file, record))
+        {
+            if (record.op != JournalOp::BatchBegin)
+            {
+                records.push_back(record);
+                continue;
+            }
+
+            /* A batch counts only if every one of its records was written */
+            size_t first = records.size();
+            bool torn = false;
+
+            for (std::int32_t i = 0; i < record.arg; ++i)
+            {
+                JournalRecord member {};
+
+                if (!readValue(file, member))
+                {
+                    torn = true;
+                    break;
+                }
+
+                records.push_back(member);
+            }
+
+            if (torn)
+            {
+                records.resize(first);
+                break;
+            }
+        }
+    }
+
+    std::fclose(file);
+
+    return true;
+}
+
+void SessionJournal::append(JournalOp op, int arg)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    if (journalFile == nullptr)
+    {
+        return;
+    }
+
+    JournalRecord record { op, arg };
+
+    writeValue(journalFile, record);
+    std::fflush(journalFile);
+
+    ++recordsSinceCheckpoint;
+}
+
+void SessionJournal::appendBatch(const std::vector<JournalRecord>& records)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    if (journalFile == nullptr || records.empty())
+    {
+        return;
+    }
+
+    /* Header and records go out in one write, then one flush */
+    batchBuffer.clear();
+    batchBuffer.reserve(records.size() + 1);
+    batchBuffer.push_back({ JournalOp::BatchBegin, static_cast<std::int32_t>(records.size()) });
+    batchBuffer.insert(batchBuffer.end(), records.begin(), records.end());
+
+    std::fwrite(batchBuffer.data(), sizeof(JournalRecord), batchBuffer.size(), journalFile);
+    std::fflush(journalFile);
+
+    recordsSinceCheckpoint += batchBuffer.size();
+}
+
+void SessionJournal::writeCheckpoint(const SessionSnapshot& snapshot)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+
+    std::uint64_t nextGeneration = generation + 1;
+    std::string tempPath = checkpointPath + ".tmp";
+
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        std::cerr << "[Warning] Unable to write session checkpoint: " << tempPath << "\n";
+        return;
+    }
+
+    std::int32_t currentID = snapshot.currentSongID;
+
+    bool ok = writeValue(file, CHECKPOINT_MAGIC)
+           && writeValue(file, FORMAT_VERSION)
+           && writeValue(file, nextGeneration)
+           && writeValue(file, packFlags(snapshot))
+           && writeValue(file, currentID)
+           && writeQueue(file, snapshot.playbackQueue)
+           && writeQueue(file, snapshot.baseQueue)
+           && writeQueue(file, snapshot.smartQueue)
+           && writeIDs(file, snapshot.playNextIDs)
+           && writeIDs(file, snapshot.historyIDs)
+           && writeIDs(file, snapshot.playNextLanes)
+           && writeValue(file, snapshot.shuffleMode)
+           && writeValue(file, snapshot.shuffleSeed);
+
+    ok = (std::fclose(file) == 0) && ok;
+
+    if (!ok)
+    {
+        std::cerr << "[Warning] Failed to write session checkpoint.\n";
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    /* rename() does not overwrite on Windows, so drop the old file first */
+    if (std::rename(tempPath.c_str(), checkpointPath.c_str()) != 0)
+    {
+        std::remove(checkpointPath.c_str());
+
+        if (std::rename(tempPath.c_str(), checkpointPath.c_str()) != 0)
+        {
+            std::cerr << "[Warning] Unable to replace session checkpoint.\n";
+            return;
+        }
+    }
+
+    generation = nextGeneration;
+
+    /* Start a fresh journal tagged with the new generation */
+    if (journalFile != nullptr)
+    {
+        std::fclose(journalFile);
+    }
+
+    journalFile = std::fopen(journalPath.c_str(), "wb");
+
+    if (journalFile == nullptr)
+    {
+        std::cerr << "[Warning] Unable to open session journal: " << journalPath << "\n";
+        return;
+    }
+
+    writeValue(journalFile, JOURNAL_MAGIC);
+    writeValue(journalFile, FORMAT_VERSION);
+    writeValue(journalFile, generation);
+    std::fflush(journalFile);
+
+    recordsSinceCheckpoint = 0;
+}
+
+bool SessionJournal::needsCheckpoint() const
+{
+    return recordsSinceCheckpoint >= CHECKPOINT_INTERVAL;
+}